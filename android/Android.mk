@@ -416,6 +416,7 @@ LOCAL_SRC_FILES := \
 	bluez/android/hal-audio.c \
 	bluez/android/hal-audio-sbc.c \
 	bluez/android/hal-audio-aptx.c \
+	bluez/android/hal-audio-pcm.c \
 
 LOCAL_C_INCLUDES = \
 	$(LOCAL_PATH)/bluez \
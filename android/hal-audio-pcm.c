@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright (C) 2013 Intel Corporation
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <endian.h>
+#include <sys/types.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "audio-msg.h"
+#include "hal-audio.h"
+
+/*
+ * Mono sample is the average of left and right samples truncated towards
+ * zero, this is what (l + r) / 2 does in C so vectorized and scalar paths
+ * produce the same output.
+ */
+static inline int16_t downmix_sample(int16_t l, int16_t r)
+{
+	return (l + r) / 2;
+}
+
+static size_t downmix_scalar(const uint8_t *in, uint8_t *out, size_t frames)
+{
+	size_t i;
+
+	for (i = 0; i < frames; i++) {
+		int16_t l = in[i * 4] | in[i * 4 + 1] << 8;
+		int16_t r = in[i * 4 + 2] | in[i * 4 + 3] << 8;
+		int16_t m = downmix_sample(l, r);
+
+		out[i * 2] = m & 0xff;
+		out[i * 2 + 1] = (uint16_t) m >> 8;
+	}
+
+	return frames;
+}
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN && defined(__SSE2__)
+
+/* Process 8 frames per iteration, returns number of frames processed */
+static size_t downmix_simd(const uint8_t *in, uint8_t *out, size_t frames)
+{
+	size_t i;
+
+	for (i = 0; i + 8 <= frames; i += 8) {
+		__m128i a, b, la, ra, lb, rb, sa, sb;
+
+		a = _mm_loadu_si128((const __m128i *) (in + i * 4));
+		b = _mm_loadu_si128((const __m128i *) (in + i * 4 + 16));
+
+		/* Sign extend left (low) and right (high) half of each frame */
+		la = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+		ra = _mm_srai_epi32(a, 16);
+		lb = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+		rb = _mm_srai_epi32(b, 16);
+
+		sa = _mm_add_epi32(la, ra);
+		sb = _mm_add_epi32(lb, rb);
+
+		/* Round towards zero as C division does */
+		sa = _mm_srai_epi32(_mm_add_epi32(sa, _mm_srli_epi32(sa, 31)),
+									1);
+		sb = _mm_srai_epi32(_mm_add_epi32(sb, _mm_srli_epi32(sb, 31)),
+									1);
+
+		_mm_storeu_si128((__m128i *) (out + i * 2),
+						_mm_packs_epi32(sa, sb));
+	}
+
+	return i;
+}
+
+#elif __BYTE_ORDER == __LITTLE_ENDIAN && defined(__ARM_NEON)
+
+/* Process 8 frames per iteration, returns number of frames processed */
+static size_t downmix_simd(const uint8_t *in, uint8_t *out, size_t frames)
+{
+	size_t i;
+
+	for (i = 0; i + 8 <= frames; i += 8) {
+		int16x8x2_t lr = vld2q_s16((const int16_t *) (in + i * 4));
+		int32x4_t lo, hi;
+
+		lo = vaddl_s16(vget_low_s16(lr.val[0]), vget_low_s16(lr.val[1]));
+		hi = vaddl_s16(vget_high_s16(lr.val[0]),
+						vget_high_s16(lr.val[1]));
+
+		/* Round towards zero as C division does */
+		lo = vaddq_s32(lo, vreinterpretq_s32_u32(vshrq_n_u32(
+					vreinterpretq_u32_s32(lo), 31)));
+		hi = vaddq_s32(hi, vreinterpretq_s32_u32(vshrq_n_u32(
+					vreinterpretq_u32_s32(hi), 31)));
+
+		vst1q_s16((int16_t *) (out + i * 2),
+				vcombine_s16(vshrn_n_s32(lo, 1),
+						vshrn_n_s32(hi, 1)));
+	}
+
+	return i;
+}
+
+#else
+
+static size_t downmix_simd(const uint8_t *in, uint8_t *out, size_t frames)
+{
+	return 0;
+}
+
+#endif
+
+void pcm_downmix_to_mono(const void *input, void *output, size_t frames)
+{
+	const uint8_t *in = input;
+	uint8_t *out = output;
+	size_t done;
+
+	done = downmix_simd(in, out, frames);
+
+	downmix_scalar(in + done * 4, out + done * 2, frames - done);
+}
@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
@@ -111,6 +112,7 @@ struct audio_endpoint {
 	uint16_t seq;
 	uint32_t samples;
 	struct timespec start;
+	int sndbuf;
 
 	bool resync;
 };
@@ -480,6 +482,7 @@ static bool open_endpoint(struct audio_endpoint **epp,
 	const struct audio_codec *codec;
 	uint16_t mtu;
 	uint16_t payload_len;
+	socklen_t len;
 	int fd;
 	size_t i;
 	uint8_t ep_id = 0;
@@ -512,6 +515,10 @@ static bool open_endpoint(struct audio_endpoint **epp,
 
 	ep->fd = fd;
 
+	len = sizeof(ep->sndbuf);
+	if (getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &ep->sndbuf, &len) < 0)
+		ep->sndbuf = 0;
+
 	codec = ep->codec;
 	codec->init(preset, payload_len, &ep->codec_data);
 	codec->get_config(ep->codec_data, cfg);
@@ -571,19 +578,9 @@ static bool resume_endpoint(struct audio_endpoint *ep)
 static void downmix_to_mono(struct a2dp_stream_out *out, const uint8_t *buffer,
 								size_t bytes)
 {
-	const int16_t *input = (const void *) buffer;
-	int16_t *output = (void *) out->downmix_buf;
-	size_t i, frames;
-
 	/* PCM 16bit stereo */
-	frames = bytes / (2 * sizeof(int16_t));
-
-	for (i = 0; i < frames; i++) {
-		int16_t l = get_le16(&input[i * 2]);
-		int16_t r = get_le16(&input[i * 2 + 1]);
-
-		put_le16((l + r) / 2, &output[i]);
-	}
+	pcm_downmix_to_mono(buffer, out->downmix_buf,
+					bytes / (2 * sizeof(int16_t)));
 }
 
 static bool wait_for_endpoint(struct audio_endpoint *ep, bool *writable)
@@ -963,17 +960,41 @@ static char *out_get_parameters(const struct audio_stream *stream,
 	return strdup("");
 }
 
+/*
+ * Returns duration of media still queued in the transport socket, based on
+ * send buffer usage and size of full media packets so this is an estimate.
+ */
+static uint64_t get_queued_us(struct audio_endpoint *ep)
+{
+	size_t pkt_duration;
+	int space;
+
+	if (ep->fd < 0 || ep->sndbuf <= 0 || !ep->mp_data_len)
+		return 0;
+
+	/* For Bluetooth sockets TIOCOUTQ returns free space in send buffer */
+	if (ioctl(ep->fd, TIOCOUTQ, &space) < 0 || space >= ep->sndbuf)
+		return 0;
+
+	pkt_duration = ep->codec->get_mediapacket_duration(ep->codec_data);
+
+	return (uint64_t) (ep->sndbuf - space) * pkt_duration /
+							ep->mp_data_len;
+}
+
 static uint32_t out_get_latency(const struct audio_stream_out *stream)
 {
 	struct a2dp_stream_out *out = (struct a2dp_stream_out *) stream;
 	struct audio_endpoint *ep = out->ep;
 	size_t pkt_duration;
+	uint64_t queued;
 
 	DBG("");
 
 	pkt_duration = ep->codec->get_mediapacket_duration(ep->codec_data);
+	queued = get_queued_us(ep);
 
-	return FIXED_A2DP_PLAYBACK_LATENCY_MS + pkt_duration / 1000;
+	return FIXED_A2DP_PLAYBACK_LATENCY_MS + (pkt_duration + queued) / 1000;
 }
 
 static int out_set_volume(struct audio_stream_out *stream, float left,
@@ -987,8 +1008,21 @@ static int out_set_volume(struct audio_stream_out *stream, float left,
 static int out_get_render_position(const struct audio_stream_out *stream,
 							uint32_t *dsp_frames)
 {
+	struct a2dp_stream_out *out = (struct a2dp_stream_out *) stream;
+	struct audio_endpoint *ep = out->ep;
+	uint64_t queued;
+
 	DBG("");
-	return -ENOSYS;
+
+	if (!ep || out->audio_state != AUDIO_A2DP_STATE_STARTED)
+		return -ENOSYS;
+
+	/* Samples written minus samples still queued in the socket */
+	queued = get_queued_us(ep) * out->cfg.rate / 1000000;
+
+	*dsp_frames = queued < ep->samples ? ep->samples - queued : 0;
+
+	return 0;
 }
 
 static int out_add_audio_effect(const struct audio_stream *stream,
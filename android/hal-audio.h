@@ -89,3 +89,6 @@ typedef const struct audio_codec * (*audio_codec_get_t) (void);
 
 const struct audio_codec *codec_sbc(void);
 const struct audio_codec *codec_aptx(void);
+
+/* Downmix 16bit stereo PCM to mono, input and output may not overlap */
+void pcm_downmix_to_mono(const void *input, void *output, size_t frames);
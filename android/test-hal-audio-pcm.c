@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+/*
+ *
+ *  BlueZ - Bluetooth protocol stack for Linux
+ *
+ *  Copyright (C) 2013  Intel Corporation. All rights reserved.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "src/shared/util.h"
+#include "android/audio-msg.h"
+#include "android/hal-audio.h"
+
+/* Not multiple of the vector width so the scalar tail is exercised too */
+#define TEST_FRAMES	4099
+#define BENCH_FRAMES	4096
+#define BENCH_ROUNDS	10000
+
+static void downmix_reference(const int16_t *input, int16_t *output,
+								size_t frames)
+{
+	size_t i;
+
+	for (i = 0; i < frames; i++) {
+		int16_t l = get_le16(&input[i * 2]);
+		int16_t r = get_le16(&input[i * 2 + 1]);
+
+		put_le16((l + r) / 2, &output[i]);
+	}
+}
+
+static void fill_input(int16_t *input, size_t frames)
+{
+	size_t i;
+
+	for (i = 0; i < frames * 2; i++)
+		input[i] = g_random_int_range(INT16_MIN, INT16_MAX + 1);
+
+	/* Make sure extremes and odd negative sums are covered */
+	input[0] = INT16_MIN;
+	input[1] = INT16_MIN;
+	input[2] = INT16_MAX;
+	input[3] = INT16_MAX;
+	input[4] = -1;
+	input[5] = 0;
+}
+
+static void test_downmix(gconstpointer data)
+{
+	int16_t *input, *output, *expected;
+
+	input = g_new(int16_t, TEST_FRAMES * 2);
+	output = g_new(int16_t, TEST_FRAMES);
+	expected = g_new(int16_t, TEST_FRAMES);
+
+	fill_input(input, TEST_FRAMES);
+
+	downmix_reference(input, expected, TEST_FRAMES);
+	pcm_downmix_to_mono(input, output, TEST_FRAMES);
+
+	g_assert(memcmp(output, expected, TEST_FRAMES * sizeof(int16_t)) == 0);
+
+	g_free(input);
+	g_free(output);
+	g_free(expected);
+}
+
+static void test_downmix_bench(gconstpointer data)
+{
+	int16_t *input, *output;
+	double reference, kernel;
+	unsigned int i;
+
+	input = g_new(int16_t, BENCH_FRAMES * 2);
+	output = g_new(int16_t, BENCH_FRAMES);
+
+	fill_input(input, BENCH_FRAMES);
+
+	g_test_timer_start();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		downmix_reference(input, output, BENCH_FRAMES);
+	reference = g_test_timer_elapsed();
+
+	g_test_timer_start();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		pcm_downmix_to_mono(input, output, BENCH_FRAMES);
+	kernel = g_test_timer_elapsed();
+
+	g_test_message("downmix %u frames x %u: reference %.3fs kernel %.3fs",
+				BENCH_FRAMES, BENCH_ROUNDS, reference, kernel);
+
+	g_free(input);
+	g_free(output);
+}
+
+int main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_data_func("/android_hal_audio/downmix", NULL, test_downmix);
+
+	if (g_test_perf())
+		g_test_add_data_func("/android_hal_audio/downmix_bench", NULL,
+							test_downmix_bench);
+
+	return g_test_run();
+}
@@ -24,6 +24,7 @@
 
 #include "src/shared/shell.h"
 #include "src/shared/util.h"
+#include "src/shared/timeout.h"
 #include "src/shared/ad.h"
 #include "gdbus/gdbus.h"
 #include "print.h"
@@ -52,7 +53,9 @@ struct adapter {
 	GDBusProxy *proxy;
 	GDBusProxy *ad_proxy;
 	GDBusProxy *adv_monitor_proxy;
-	GList *devices;
+	GQueue devices;
+	GHashTable *devices_by_addr;
+	GHashTable *devices_by_path;
 	GList *sets;
 };
 
@@ -166,6 +169,20 @@ static struct set_discovery_filter_args {
 	.set = true,
 };
 
+#define SUMMARY_MAX_NEW	10
+
+static struct summary {
+	bool enabled;
+	unsigned int interval;
+	unsigned int id;
+	unsigned int added;
+	unsigned int removed;
+	GHashTable *changed;
+	GQueue new_devices;
+} summary = {
+	.interval = 1,
+};
+
 static void print_device(GDBusProxy *proxy, const char *description)
 {
 	DBusMessageIter iter;
@@ -319,8 +336,7 @@ static gboolean service_is_child(GDBusProxy *service)
 	if (!default_ctrl)
 		return FALSE;
 
-	return g_dbus_proxy_lookup(default_ctrl->devices, NULL, device,
-					"org.bluez.Device1") != NULL;
+	return g_hash_table_contains(default_ctrl->devices_by_path, device);
 }
 
 static struct adapter *find_parent(GDBusProxy *proxy)
@@ -376,6 +392,157 @@ static void battery_removed(GDBusProxy *proxy)
 	battery_proxies = g_list_remove(battery_proxies, proxy);
 }
 
+static char *device_address_key(const char *address)
+{
+	return g_ascii_strup(address, -1);
+}
+
+static gboolean device_index_match(gpointer key, gpointer value,
+							gpointer user_data)
+{
+	return value == user_data;
+}
+
+/*
+ * The address index is keyed on the Address the device currently reports,
+ * which may change e.g. once an RPA resolves to the identity address, so
+ * always look the proxy up by pointer rather than by its current Address.
+ */
+static void device_index_set_address(struct adapter *adapter,
+					GDBusProxy *proxy, const char *address)
+{
+	g_hash_table_foreach_remove(adapter->devices_by_addr,
+						device_index_match, proxy);
+
+	if (address)
+		g_hash_table_insert(adapter->devices_by_addr,
+					device_address_key(address), proxy);
+}
+
+static void device_index_add(struct adapter *adapter, GDBusProxy *proxy)
+{
+	DBusMessageIter iter;
+	const char *address;
+
+	g_queue_push_tail(&adapter->devices, proxy);
+	g_hash_table_insert(adapter->devices_by_path,
+				(void *) g_dbus_proxy_get_path(proxy),
+				g_queue_peek_tail_link(&adapter->devices));
+
+	if (g_dbus_proxy_get_property(proxy, "Address", &iter) == FALSE)
+		return;
+
+	dbus_message_iter_get_basic(&iter, &address);
+	device_index_set_address(adapter, proxy, address);
+}
+
+static void device_index_remove(struct adapter *adapter, GDBusProxy *proxy)
+{
+	const char *path = g_dbus_proxy_get_path(proxy);
+	GList *link;
+
+	link = g_hash_table_lookup(adapter->devices_by_path, path);
+	if (!link)
+		return;
+
+	g_hash_table_remove(adapter->devices_by_path, path);
+	g_queue_delete_link(&adapter->devices, link);
+
+	device_index_set_address(adapter, proxy, NULL);
+}
+
+static void summary_device_added(GDBusProxy *proxy)
+{
+	DBusMessageIter iter;
+	const char *address, *name;
+
+	summary.added++;
+
+	/* Only a bounded number of new devices is listed per interval */
+	if (g_queue_get_length(&summary.new_devices) >= SUMMARY_MAX_NEW)
+		return;
+
+	if (g_dbus_proxy_get_property(proxy, "Address", &iter) == FALSE)
+		return;
+
+	dbus_message_iter_get_basic(&iter, &address);
+
+	if (g_dbus_proxy_get_property(proxy, "Alias", &iter) == TRUE)
+		dbus_message_iter_get_basic(&iter, &name);
+	else
+		name = "<unknown>";
+
+	g_queue_push_tail(&summary.new_devices,
+				g_strdup_printf("%s %s", address, name));
+}
+
+static void summary_print(void)
+{
+	unsigned int changed, total;
+	char *str;
+
+	changed = g_hash_table_size(summary.changed);
+
+	if (!summary.added && !summary.removed && !changed)
+		return;
+
+	total = default_ctrl ? g_queue_get_length(&default_ctrl->devices) : 0;
+
+	bt_shell_printf("[SUMMARY] %u devices: %u new, %u updated, %u lost\n",
+				total, summary.added, changed, summary.removed);
+
+	while ((str = g_queue_pop_head(&summary.new_devices))) {
+		bt_shell_printf("[" COLORED_NEW "] Device %s\n", str);
+		g_free(str);
+	}
+
+	if (summary.added > SUMMARY_MAX_NEW)
+		bt_shell_printf("[" COLORED_NEW "] ... and %u more\n",
+					summary.added - SUMMARY_MAX_NEW);
+
+	summary.added = 0;
+	summary.removed = 0;
+	g_hash_table_remove_all(summary.changed);
+}
+
+static bool summary_timeout(void *user_data)
+{
+	summary_print();
+
+	return true;
+}
+
+static void summary_enable(unsigned int interval)
+{
+	if (summary.id)
+		timeout_remove(summary.id);
+
+	if (!summary.changed)
+		summary.changed = g_hash_table_new_full(g_str_hash,
+							g_str_equal,
+							g_free, NULL);
+
+	summary.enabled = true;
+	summary.interval = interval;
+	summary.id = timeout_add_seconds(interval, summary_timeout, NULL,
+									NULL);
+}
+
+static void summary_disable(void)
+{
+	if (!summary.enabled)
+		return;
+
+	summary_print();
+
+	timeout_remove(summary.id);
+	summary.id = 0;
+	summary.enabled = false;
+
+	g_hash_table_destroy(summary.changed);
+	summary.changed = NULL;
+}
+
 static void device_added(GDBusProxy *proxy)
 {
 	DBusMessageIter iter;
@@ -386,8 +553,13 @@ static void device_added(GDBusProxy *proxy)
 		return;
 	}
 
-	adapter->devices = g_list_append(adapter->devices, proxy);
-	print_device(proxy, COLORED_NEW);
+	device_index_add(adapter, proxy);
+
+	if (summary.enabled)
+		summary_device_added(proxy);
+	else
+		print_device(proxy, COLORED_NEW);
+
 	bt_shell_set_env(g_dbus_proxy_get_path(proxy), proxy);
 
 	if (default_dev)
@@ -409,6 +581,12 @@ static struct adapter *adapter_new(GDBusProxy *proxy)
 {
 	struct adapter *adapter = g_malloc0(sizeof(struct adapter));
 
+	g_queue_init(&adapter->devices);
+	adapter->devices_by_addr = g_hash_table_new_full(g_str_hash,
+							g_str_equal,
+							g_free, NULL);
+	adapter->devices_by_path = g_hash_table_new(g_str_hash, g_str_equal);
+
 	ctrl_list = g_list_append(ctrl_list, adapter);
 
 	if (!default_ctrl)
@@ -534,9 +712,13 @@ static void device_removed(GDBusProxy *proxy)
 		return;
 	}
 
-	adapter->devices = g_list_remove(adapter->devices, proxy);
+	device_index_remove(adapter, proxy);
+
+	if (summary.enabled)
+		summary.removed++;
+	else
+		print_device(proxy, COLORED_DEL);
 
-	print_device(proxy, COLORED_DEL);
 	bt_shell_set_env(g_dbus_proxy_get_path(proxy), NULL);
 
 	if (default_dev == proxy)
@@ -560,7 +742,9 @@ static void adapter_removed(GDBusProxy *proxy)
 			}
 
 			ctrl_list = g_list_remove_link(ctrl_list, ll);
-			g_list_free(adapter->devices);
+			g_queue_clear(&adapter->devices);
+			g_hash_table_destroy(adapter->devices_by_addr);
+			g_hash_table_destroy(adapter->devices_by_path);
 			g_list_free(adapter->sets);
 			g_free(adapter);
 			g_list_free(ll);
@@ -650,6 +834,16 @@ static void property_changed(GDBusProxy *proxy, const char *name,
 	interface = g_dbus_proxy_get_interface(proxy);
 
 	if (!strcmp(interface, "org.bluez.Device1")) {
+		if (!strcmp(name, "Address")) {
+			const char *address;
+
+			ctrl = find_parent(proxy);
+			dbus_message_iter_get_basic(iter, &address);
+			if (ctrl && g_hash_table_contains(ctrl->devices_by_path,
+						g_dbus_proxy_get_path(proxy)))
+				device_index_set_address(ctrl, proxy, address);
+		}
+
 		if (default_ctrl && proxy_is_child(proxy,
 					default_ctrl->proxy) == TRUE) {
 			DBusMessageIter addr_iter;
@@ -677,7 +871,12 @@ static void property_changed(GDBusProxy *proxy, const char *name,
 					set_default_device(NULL, NULL);
 			}
 
-			print_iter(str, name, iter);
+			if (summary.enabled)
+				g_hash_table_add(summary.changed, g_strdup(
+						g_dbus_proxy_get_path(proxy)));
+			else
+				print_iter(str, name, iter);
+
 			g_free(str);
 		}
 	} else if (!strcmp(interface, "org.bluez.Adapter1")) {
@@ -771,25 +970,17 @@ static GDBusProxy *find_proxies_by_path(GList *source, const char *path)
 	return NULL;
 }
 
-static GDBusProxy *find_proxy_by_address(GList *source, const char *address)
+static GDBusProxy *find_proxy_by_address(struct adapter *adapter,
+							const char *address)
 {
-	GList *list;
-
-	for (list = g_list_first(source); list; list = g_list_next(list)) {
-		GDBusProxy *proxy = list->data;
-		DBusMessageIter iter;
-		const char *str;
-
-		if (g_dbus_proxy_get_property(proxy, "Address", &iter) == FALSE)
-			continue;
-
-		dbus_message_iter_get_basic(&iter, &str);
+	GDBusProxy *proxy;
+	char *key;
 
-		if (!strcasecmp(str, address))
-			return proxy;
-	}
+	key = device_address_key(address);
+	proxy = g_hash_table_lookup(adapter->devices_by_addr, key);
+	g_free(key);
 
-	return NULL;
+	return proxy;
 }
 
 static gboolean check_default_ctrl(void)
@@ -980,8 +1171,7 @@ static void cmd_devices(int argc, char *argv[])
 	if (check_default_ctrl() == FALSE)
 		return bt_shell_noninteractive_quit(EXIT_SUCCESS);
 
-	for (ll = g_list_first(default_ctrl->devices);
-			ll; ll = g_list_next(ll)) {
+	for (ll = default_ctrl->devices.head; ll; ll = g_list_next(ll)) {
 		GDBusProxy *proxy = ll->data;
 		DBusMessageIter iter;
 		dbus_bool_t status;
@@ -1486,6 +1676,39 @@ static void cmd_scan_filter_discoverable(int argc, char *argv[])
 		set_discovery_filter(false);
 }
 
+static void cmd_scan_summary(int argc, char *argv[])
+{
+	char *endptr = NULL;
+	long interval = summary.interval;
+
+	if (argc < 2 || !strlen(argv[1])) {
+		bt_shell_printf("Summary: %s\n",
+					summary.enabled ? "on" : "off");
+		bt_shell_printf("Interval: %u sec\n", summary.interval);
+		return bt_shell_noninteractive_quit(EXIT_SUCCESS);
+	}
+
+	if (argc > 2) {
+		interval = strtol(argv[2], &endptr, 0);
+		if (!endptr || *endptr != '\0' || interval < 1 ||
+							interval > UINT16_MAX) {
+			bt_shell_printf("Invalid interval: %s\n", argv[2]);
+			return bt_shell_noninteractive_quit(EXIT_FAILURE);
+		}
+	}
+
+	if (!strcmp(argv[1], "on"))
+		summary_enable(interval);
+	else if (!strcmp(argv[1], "off"))
+		summary_disable();
+	else {
+		bt_shell_printf("Invalid option: %s\n", argv[1]);
+		return bt_shell_noninteractive_quit(EXIT_FAILURE);
+	}
+
+	return bt_shell_noninteractive_quit(EXIT_SUCCESS);
+}
+
 static void cmd_scan_filter_pattern(int argc, char *argv[])
 {
 	if (argc < 2 || !strlen(argv[1])) {
@@ -1635,7 +1858,7 @@ static struct GDBusProxy *find_device(int argc, char *argv[])
 	if (check_default_ctrl() == FALSE)
 		return NULL;
 
-	proxy = find_proxy_by_address(default_ctrl->devices, argv[1]);
+	proxy = find_proxy_by_address(default_ctrl, argv[1]);
 	if (!proxy) {
 		bt_shell_printf("Device %s not available\n", argv[1]);
 		return NULL;
@@ -1961,7 +2184,7 @@ static void cmd_remove(int argc, char *argv[])
 	if (strcmp(argv[1], "*") == 0) {
 		GList *list;
 
-		for (list = default_ctrl->devices; list;
+		for (list = default_ctrl->devices.head; list;
 						list = g_list_next(list)) {
 			GDBusProxy *proxy = list->data;
 
@@ -1970,7 +2193,7 @@ static void cmd_remove(int argc, char *argv[])
 		return;
 	}
 
-	proxy = find_proxy_by_address(default_ctrl->devices, argv[1]);
+	proxy = find_proxy_by_address(default_ctrl, argv[1]);
 	if (!proxy) {
 		bt_shell_printf("Device %s not available\n", argv[1]);
 		return bt_shell_noninteractive_quit(EXIT_FAILURE);
@@ -2006,7 +2229,7 @@ static void cmd_connect(int argc, char *argv[])
 	if (check_default_ctrl() == FALSE)
 		return bt_shell_noninteractive_quit(EXIT_FAILURE);
 
-	proxy = find_proxy_by_address(default_ctrl->devices, argv[1]);
+	proxy = find_proxy_by_address(default_ctrl, argv[1]);
 	if (!proxy) {
 		bt_shell_printf("Device %s not available\n", argv[1]);
 		return bt_shell_noninteractive_quit(EXIT_FAILURE);
@@ -2466,7 +2689,8 @@ static char *ctrl_generator(const char *text, int state)
 static char *dev_generator(const char *text, int state)
 {
 	return generic_generator(text, state,
-			default_ctrl ? default_ctrl->devices : NULL, "Address");
+			default_ctrl ? default_ctrl->devices.head : NULL,
+			"Address");
 }
 
 static char *set_generator(const char *text, int state)
@@ -3021,6 +3245,9 @@ static const struct bt_shell_menu scan_menu = {
 	{ "pattern", "[value]", cmd_scan_filter_pattern,
 				"Set/Get pattern filter",
 				NULL },
+	{ "summary", "[on/off] [interval]", cmd_scan_summary,
+				"Set/Get aggregated view of discovered devices",
+				NULL },
 	{ "clear",
 	"[uuids/rssi/pathloss/transport/duplicate-data/discoverable/pattern]",
 				cmd_scan_filter_clear,
@@ -2062,6 +2062,14 @@ struct bt_le *bt_le_ref(struct bt_le *hci)
 	return hci;
 }
 
+struct bt_phy *bt_le_get_phy(struct bt_le *hci)
+{
+	if (!hci)
+		return NULL;
+
+	return hci->phy;
+}
+
 void bt_le_unref(struct bt_le *hci)
 {
 	if (!hci)
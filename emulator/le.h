@@ -12,8 +12,11 @@
 #include <stdbool.h>
 
 struct bt_le;
+struct bt_phy;
 
 struct bt_le *bt_le_new(void);
 
 struct bt_le *bt_le_ref(struct bt_le *le);
 void bt_le_unref(struct bt_le *le);
+
+struct bt_phy *bt_le_get_phy(struct bt_le *le);
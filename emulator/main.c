@@ -16,11 +16,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <inttypes.h>
+#include <signal.h>
 #include <getopt.h>
 #include <sys/uio.h>
 
 #include "src/shared/mainloop.h"
 #include "src/shared/util.h"
+#include "src/shared/queue.h"
 
 #include "serial.h"
 #include "server.h"
@@ -28,14 +31,50 @@
 #include "vhci.h"
 #include "amp.h"
 #include "le.h"
+#include "phy.h"
+
+static struct queue *le_list;
+
+static void print_peer_stats(const struct bt_phy_peer_stats *stats,
+							void *user_data)
+{
+	printf("  peer %016" PRIx64 ": rx %" PRIu64 " lost %" PRIu64
+		" reordered %" PRIu64 " latency min/avg/max %" PRIu64 "/%"
+		PRIu64 "/%" PRIu64 " us\n", stats->id, stats->rx_frames,
+		stats->lost_frames, stats->reordered_frames,
+		stats->latency_min, stats->latency_total / stats->rx_frames,
+		stats->latency_max);
+}
+
+static void print_le_stats(void *data, void *user_data)
+{
+	struct bt_phy *phy = bt_le_get_phy(data);
+	unsigned int *index = user_data;
+	struct bt_phy_stats stats;
+
+	if (!bt_phy_get_stats(phy, &stats))
+		return;
+
+	printf("LE controller %u: tx %" PRIu64 " dropped %" PRIu64
+		" rx %" PRIu64 " invalid %" PRIu64 "\n", (*index)++,
+		stats.tx_frames, stats.tx_dropped, stats.rx_frames,
+		stats.rx_invalid);
+
+	bt_phy_foreach_peer(phy, print_peer_stats, NULL);
+}
 
 static void signal_callback(int signum, void *user_data)
 {
+	unsigned int index = 0;
+
 	switch (signum) {
 	case SIGINT:
 	case SIGTERM:
 		mainloop_quit();
 		break;
+	case SIGUSR2:
+		queue_foreach(le_list, print_le_stats, &index);
+		break;
 	}
 }
 
@@ -54,7 +93,9 @@ static void usage(void)
 		"\t-B                    Create BR/EDR only controller\n"
 		"\t-A                    Create AMP controller\n"
 		"\t-T[num]               Number of test AMP controllers\n"
-		"\t-h, --help            Show help options\n");
+		"\t-h, --help            Show help options\n"
+		"\nSend SIGUSR2 to print PHY statistics of test LE "
+		"controllers\n");
 }
 
 static const struct option main_options[] = {
@@ -161,6 +202,8 @@ int main(int argc, char *argv[])
 
 	printf("Bluetooth emulator ver %s\n", VERSION);
 
+	le_list = queue_new();
+
 	for (i = 0; i < letest_count; i++) {
 		struct bt_le *le;
 
@@ -169,6 +212,8 @@ int main(int argc, char *argv[])
 			fprintf(stderr, "Failed to create LE controller\n");
 			return EXIT_FAILURE;
 		}
+
+		queue_push_tail(le_list, le);
 	}
 
 	for (i = 0; i < amptest_count; i++) {
@@ -14,6 +14,7 @@
 #endif
 
 #define _GNU_SOURCE
+#include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -24,27 +25,63 @@
 #include <time.h>
 
 #include "src/shared/util.h"
+#include "src/shared/queue.h"
 #include "src/shared/mainloop.h"
 
 #include "phy.h"
 
 #define BT_PHY_PORT 45023
+#define BT_PHY_MTU 4096
+#define BT_PHY_BATCH 32
+#define BT_PHY_RCVBUF (1024 * 1024)
+#define BT_PHY_SNDBUF (256 * 1024)
+
+struct bt_phy_hdr {
+	uint64_t id;
+	uint32_t flags;
+	uint16_t type;
+	uint16_t len;
+	uint32_t seq;
+	uint64_t timestamp;
+} __attribute__ ((packed));
+
+struct bt_phy_frame {
+	struct bt_phy_hdr hdr;
+	unsigned char data[BT_PHY_MTU];
+};
+
+struct bt_phy_peer {
+	struct bt_phy_peer_stats stats;
+	uint32_t next_seq;
+};
 
 struct bt_phy {
 	volatile int ref_count;
 	int rx_fd;
 	int tx_fd;
 	uint64_t id;
+	uint32_t seq;
 	bt_phy_callback_func_t callback;
 	void *user_data;
+	struct bt_phy_frame rx_frames[BT_PHY_BATCH];
+	struct bt_phy_frame tx_frames[BT_PHY_BATCH];
+	unsigned int tx_count;
+	struct bt_phy_stats stats;
+	struct queue *peers;
 };
 
-struct bt_phy_hdr {
-	uint64_t id;
-	uint32_t flags;
-	uint16_t type;
-	uint16_t len;
-} __attribute__ ((packed));
+static uint64_t get_timestamp(void)
+{
+	struct timespec ts;
+
+	/*
+	 * Frames may cross hosts so use wall clock time, latency is only
+	 * meaningful if the clocks of the participants are synchronized.
+	 */
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
 
 static bool get_random_bytes(void *buf, size_t num_bytes)
 {
@@ -65,45 +102,185 @@ static bool get_random_bytes(void *buf, size_t num_bytes)
 	return true;
 }
 
+static bool match_peer_id(const void *data, const void *match_data)
+{
+	const struct bt_phy_peer *peer = data;
+	const uint64_t *id = match_data;
+
+	return peer->stats.id == *id;
+}
+
+static void update_peer_stats(struct bt_phy *phy,
+					const struct bt_phy_hdr *hdr,
+					uint64_t now)
+{
+	struct bt_phy_peer *peer;
+	struct bt_phy_peer_stats *stats;
+	uint64_t id = le64_to_cpu(hdr->id);
+	uint32_t seq = le32_to_cpu(hdr->seq);
+	uint64_t timestamp = le64_to_cpu(hdr->timestamp);
+	uint64_t latency;
+	int32_t gap;
+
+	peer = queue_find(phy->peers, match_peer_id, &id);
+	if (!peer) {
+		peer = new0(struct bt_phy_peer, 1);
+		peer->stats.id = id;
+		peer->next_seq = seq;
+		queue_push_tail(phy->peers, peer);
+	}
+
+	stats = &peer->stats;
+
+	/* Sequence numbers are allowed to wrap around */
+	gap = seq - peer->next_seq;
+	if (gap < 0) {
+		stats->reordered_frames++;
+	} else {
+		stats->lost_frames += gap;
+		peer->next_seq = seq + 1;
+	}
+
+	stats->rx_frames++;
+
+	latency = now > timestamp ? now - timestamp : 0;
+
+	if (stats->rx_frames == 1 || latency < stats->latency_min)
+		stats->latency_min = latency;
+
+	if (latency > stats->latency_max)
+		stats->latency_max = latency;
+
+	stats->latency_total += latency;
+}
+
 static void phy_rx_callback(int fd, uint32_t events, void *user_data)
 {
 	struct bt_phy *phy = user_data;
-	struct msghdr msg;
-	struct iovec iov[2];
-	struct bt_phy_hdr hdr;
-	unsigned char buf[4096];
-	ssize_t len;
+	struct mmsghdr msgs[BT_PHY_BATCH];
+	struct iovec iov[BT_PHY_BATCH];
+	uint64_t now;
+	int i, count;
 
 	if (events & (EPOLLERR | EPOLLHUP)) {
 		mainloop_remove_fd(fd);
 		return;
 	}
 
-	iov[0].iov_base = &hdr;
-	iov[0].iov_len = sizeof(hdr);
-	iov[1].iov_base = buf;
-	iov[1].iov_len = sizeof(buf);
+	memset(msgs, 0, sizeof(msgs));
 
-	memset(&msg, 0, sizeof(msg));
-	msg.msg_iov = iov;
-	msg.msg_iovlen = 2;
+	for (i = 0; i < BT_PHY_BATCH; i++) {
+		iov[i].iov_base = &phy->rx_frames[i];
+		iov[i].iov_len = sizeof(phy->rx_frames[i]);
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
 
-	len = recvmsg(phy->rx_fd, &msg, MSG_DONTWAIT);
-	if (len < 0)
+	count = recvmmsg(phy->rx_fd, msgs, BT_PHY_BATCH, MSG_DONTWAIT, NULL);
+	if (count < 0)
 		return;
 
-	if ((size_t) len < sizeof(hdr))
+	now = get_timestamp();
+
+	/* Keep the phy around in case a callback drops the last reference */
+	bt_phy_ref(phy);
+
+	for (i = 0; i < count; i++) {
+		const struct bt_phy_frame *frame = &phy->rx_frames[i];
+		size_t len = msgs[i].msg_len;
+
+		if (len < sizeof(frame->hdr)) {
+			phy->stats.rx_invalid++;
+			continue;
+		}
+
+		if (le64_to_cpu(frame->hdr.id) == phy->id)
+			continue;
+
+		if (len - sizeof(frame->hdr) != le16_to_cpu(frame->hdr.len)) {
+			phy->stats.rx_invalid++;
+			continue;
+		}
+
+		phy->stats.rx_frames++;
+		update_peer_stats(phy, &frame->hdr, now);
+
+		if (phy->callback)
+			phy->callback(le16_to_cpu(frame->hdr.type),
+					frame->data, len - sizeof(frame->hdr),
+					phy->user_data);
+
+		/* Stop if the callback dropped the last external reference */
+		if (phy->ref_count == 1)
+			break;
+	}
+
+	bt_phy_unref(phy);
+}
+
+static void phy_tx_flush(struct bt_phy *phy)
+{
+	struct sockaddr_in addr;
+	struct mmsghdr msgs[BT_PHY_BATCH];
+	struct iovec iov[BT_PHY_BATCH];
+	unsigned int i;
+	int count;
+
+	if (!phy->tx_count)
 		return;
 
-	if (le64_to_cpu(hdr.id) == phy->id)
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(BT_PHY_PORT);
+	addr.sin_addr.s_addr = INADDR_BROADCAST;
+
+	memset(msgs, 0, sizeof(msgs));
+
+	for (i = 0; i < phy->tx_count; i++) {
+		struct bt_phy_frame *frame = &phy->tx_frames[i];
+
+		iov[i].iov_base = frame;
+		iov[i].iov_len = sizeof(frame->hdr) +
+					le16_to_cpu(frame->hdr.len);
+		msgs[i].msg_hdr.msg_name = &addr;
+		msgs[i].msg_hdr.msg_namelen = sizeof(addr);
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	count = sendmmsg(phy->tx_fd, msgs, phy->tx_count, MSG_DONTWAIT);
+	if (count < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return;
+
+		/* Frames that cannot be sent at all are dropped */
+		phy->stats.tx_dropped += phy->tx_count;
+		count = phy->tx_count;
+	} else
+		phy->stats.tx_frames += count;
+
+	phy->tx_count -= count;
+
+	/* Keep the unsent frames and wait for the socket to be writable */
+	if (phy->tx_count) {
+		memmove(phy->tx_frames, phy->tx_frames + count,
+				phy->tx_count * sizeof(struct bt_phy_frame));
 		return;
+	}
 
-	if (len - sizeof(hdr) != le16_to_cpu(hdr.len))
+	mainloop_modify_fd(phy->tx_fd, 0);
+}
+
+static void phy_tx_callback(int fd, uint32_t events, void *user_data)
+{
+	struct bt_phy *phy = user_data;
+
+	if (events & (EPOLLERR | EPOLLHUP)) {
+		mainloop_remove_fd(fd);
 		return;
+	}
 
-	if (phy->callback)
-		phy->callback(le16_to_cpu(hdr.type),
-				buf, len - sizeof(hdr), phy->user_data);
+	phy_tx_flush(phy);
 }
 
 static int create_rx_socket(void)
@@ -120,6 +297,10 @@ static int create_rx_socket(void)
 		return -1;
 	}
 
+	/* Dense traffic needs more than the default buffer, failure is ok */
+	opt = BT_PHY_RCVBUF;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &opt, sizeof(opt));
+
 	memset(&addr, 0, sizeof(addr));
 	addr.sin_family = AF_INET;
 	addr.sin_port = htons(BT_PHY_PORT);
@@ -146,6 +327,9 @@ static int create_tx_socket(void)
 		return -1;
 	}
 
+	opt = BT_PHY_SNDBUF;
+	setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &opt, sizeof(opt));
+
 	return fd;
 }
 
@@ -170,13 +354,20 @@ struct bt_phy *bt_phy_new(void)
 		return NULL;
 	}
 
+	phy->peers = queue_new();
+
 	mainloop_add_fd(phy->rx_fd, EPOLLIN, phy_rx_callback, phy, NULL);
 
+	/* Only polled for writing while there are frames waiting */
+	mainloop_add_fd(phy->tx_fd, 0, phy_tx_callback, phy, NULL);
+
 	if (!get_random_bytes(&phy->id, sizeof(phy->id))) {
 		if (util_getrandom(&phy->id, sizeof(phy->id), 0) < 0) {
+			mainloop_remove_fd(phy->tx_fd);
 			mainloop_remove_fd(phy->rx_fd);
 			close(phy->tx_fd);
 			close(phy->rx_fd);
+			queue_destroy(phy->peers, NULL);
 			free(phy);
 			return NULL;
 		}
@@ -205,11 +396,17 @@ void bt_phy_unref(struct bt_phy *phy)
 	if (__sync_sub_and_fetch(&phy->ref_count, 1))
 		return;
 
+	/* Don't lose frames still waiting for the next flush */
+	phy_tx_flush(phy);
+
+	mainloop_remove_fd(phy->tx_fd);
 	mainloop_remove_fd(phy->rx_fd);
 
 	close(phy->tx_fd);
 	close(phy->rx_fd);
 
+	queue_destroy(phy->peers, free);
+
 	free(phy);
 }
 
@@ -224,62 +421,56 @@ bool bt_phy_send_vector(struct bt_phy *phy, uint16_t type,
 					const void *data2, size_t size2,
 					const void *data3, size_t size3)
 {
-	struct bt_phy_hdr hdr;
-	struct sockaddr_in addr;
-	struct msghdr msg;
-	struct iovec iov[4];
-	ssize_t len;
+	struct bt_phy_frame *frame;
+	size_t len = 0;
 
 	if (!phy)
 		return false;
 
-	memset(&addr, 0, sizeof(addr));
-	addr.sin_family = AF_INET;
-	addr.sin_port = htons(BT_PHY_PORT);
-	addr.sin_addr.s_addr = INADDR_BROADCAST;
+	if (size1 + size2 + size3 > BT_PHY_MTU)
+		return false;
 
-	memset(&msg, 0, sizeof(msg));
-	msg.msg_name = &addr;
-	msg.msg_namelen = sizeof(addr);
-	msg.msg_iov = iov;
-	msg.msg_iovlen = 0;
+	/* Make room by sending what is queued if the batch is full */
+	if (phy->tx_count == BT_PHY_BATCH) {
+		phy_tx_flush(phy);
+
+		if (phy->tx_count == BT_PHY_BATCH) {
+			phy->stats.tx_dropped++;
+			return false;
+		}
+	}
 
-	memset(&hdr, 0, sizeof(hdr));
-	hdr.id = cpu_to_le64(phy->id);
-	hdr.flags = cpu_to_le32(0);
-	hdr.type = cpu_to_le16(type);
-	hdr.len = cpu_to_le16(size1 + size2 + size3);
+	frame = &phy->tx_frames[phy->tx_count];
 
-	iov[msg.msg_iovlen].iov_base = &hdr;
-	iov[msg.msg_iovlen].iov_len = sizeof(hdr);
-	msg.msg_iovlen++;
+	memset(&frame->hdr, 0, sizeof(frame->hdr));
+	frame->hdr.id = cpu_to_le64(phy->id);
+	frame->hdr.flags = cpu_to_le32(0);
+	frame->hdr.type = cpu_to_le16(type);
+	frame->hdr.len = cpu_to_le16(size1 + size2 + size3);
+	frame->hdr.seq = cpu_to_le32(phy->seq++);
+	frame->hdr.timestamp = cpu_to_le64(get_timestamp());
 
 	if (data1 && size1 > 0) {
-		iov[msg.msg_iovlen].iov_base = (void *) data1;
-		iov[msg.msg_iovlen].iov_len = size1;
-		msg.msg_iovlen++;
+		memcpy(frame->data + len, data1, size1);
+		len += size1;
 	}
 
 	if (data2 && size2 > 0) {
-		iov[msg.msg_iovlen].iov_base = (void *) data2;
-		iov[msg.msg_iovlen].iov_len = size2;
-		msg.msg_iovlen++;
+		memcpy(frame->data + len, data2, size2);
+		len += size2;
 	}
 
 	if (data3 && size3 > 0) {
-		iov[msg.msg_iovlen].iov_base = (void *) data3;
-		iov[msg.msg_iovlen].iov_len = size3;
-		msg.msg_iovlen++;
+		memcpy(frame->data + len, data3, size3);
+		len += size3;
 	}
 
-	memset(&addr, 0, sizeof(addr));
-	addr.sin_family = AF_INET;
-	addr.sin_port = htons(BT_PHY_PORT);
-	addr.sin_addr.s_addr = INADDR_BROADCAST;
-
-	len = sendmsg(phy->tx_fd, &msg, MSG_DONTWAIT);
-	if (len < 0)
-		return false;
+	/*
+	 * Frames are sent in batches once the mainloop gets back to polling,
+	 * which happens right away since the socket is normally writable.
+	 */
+	if (!phy->tx_count++)
+		mainloop_modify_fd(phy->tx_fd, EPOLLOUT);
 
 	return true;
 }
@@ -295,3 +486,42 @@ bool bt_phy_register(struct bt_phy *phy, bt_phy_callback_func_t callback,
 
 	return true;
 }
+
+bool bt_phy_get_stats(struct bt_phy *phy, struct bt_phy_stats *stats)
+{
+	if (!phy || !stats)
+		return false;
+
+	*stats = phy->stats;
+
+	return true;
+}
+
+struct foreach_peer_data {
+	bt_phy_peer_func_t func;
+	void *user_data;
+};
+
+static void foreach_peer(void *data, void *user_data)
+{
+	struct bt_phy_peer *peer = data;
+	struct foreach_peer_data *foreach_data = user_data;
+
+	foreach_data->func(&peer->stats, foreach_data->user_data);
+}
+
+bool bt_phy_foreach_peer(struct bt_phy *phy, bt_phy_peer_func_t func,
+							void *user_data)
+{
+	struct foreach_peer_data data;
+
+	if (!phy || !func)
+		return false;
+
+	data.func = func;
+	data.user_data = user_data;
+
+	queue_foreach(phy->peers, foreach_peer, &data);
+
+	return true;
+}
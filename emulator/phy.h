@@ -32,6 +32,32 @@ typedef void (*bt_phy_callback_func_t)(uint16_t type, const void *data,
 bool bt_phy_register(struct bt_phy *phy, bt_phy_callback_func_t callback,
 							void *user_data);
 
+struct bt_phy_stats {
+	uint64_t tx_frames;
+	uint64_t tx_dropped;
+	uint64_t rx_frames;
+	uint64_t rx_invalid;
+};
+
+bool bt_phy_get_stats(struct bt_phy *phy, struct bt_phy_stats *stats);
+
+/* Latencies are in microseconds, based on the timestamp of the sender */
+struct bt_phy_peer_stats {
+	uint64_t id;
+	uint64_t rx_frames;
+	uint64_t lost_frames;
+	uint64_t reordered_frames;
+	uint64_t latency_min;
+	uint64_t latency_max;
+	uint64_t latency_total;
+};
+
+typedef void (*bt_phy_peer_func_t)(const struct bt_phy_peer_stats *stats,
+							void *user_data);
+
+bool bt_phy_foreach_peer(struct bt_phy *phy, bt_phy_peer_func_t func,
+							void *user_data);
+
 #define BT_PHY_PKT_NULL		0x0000
 
 #define BT_PHY_PKT_ADV		0x0001
@@ -52,6 +52,8 @@ struct GDBusClient {
 	GDBusPropertyFunction property_changed;
 	void *user_data;
 	GList *proxy_list;
+	GList *proxy_tail;
+	GHashTable *proxy_index;
 };
 
 struct GDBusProxy {
@@ -523,6 +525,89 @@ static gboolean properties_changed(DBusConnection *conn, DBusMessage *msg,
 	return TRUE;
 }
 
+static char *proxy_index_key(const char *path, const char *interface)
+{
+	/* Object paths cannot contain spaces so use it as separator */
+	return g_strconcat(path, " ", interface, NULL);
+}
+
+static GList *proxy_index_lookup(GDBusClient *client, const char *path,
+						const char *interface)
+{
+	char *key;
+	GList *link;
+
+	if (!path || !interface)
+		return NULL;
+
+	key = proxy_index_key(path, interface);
+	link = g_hash_table_lookup(client->proxy_index, key);
+	g_free(key);
+
+	return link;
+}
+
+static GDBusProxy *proxy_find(GDBusClient *client, const char *path,
+						const char *interface)
+{
+	GList *link;
+
+	link = proxy_index_lookup(client, path, interface);
+	if (!link)
+		return NULL;
+
+	return link->data;
+}
+
+static void proxy_list_append(GDBusClient *client, GDBusProxy *proxy)
+{
+	GList *link;
+
+	/* Append at the tail so it doesn't have to walk the whole list */
+	link = g_list_alloc();
+	link->data = proxy;
+	link->prev = client->proxy_tail;
+
+	if (client->proxy_tail)
+		client->proxy_tail->next = link;
+	else
+		client->proxy_list = link;
+
+	client->proxy_tail = link;
+
+	g_hash_table_replace(client->proxy_index,
+			proxy_index_key(proxy->obj_path, proxy->interface),
+			link);
+}
+
+static void proxy_list_delete_link(GDBusClient *client, GList *link)
+{
+	GDBusProxy *proxy = link->data;
+	char *key;
+
+	key = proxy_index_key(proxy->obj_path, proxy->interface);
+	g_hash_table_remove(client->proxy_index, key);
+	g_free(key);
+
+	if (client->proxy_tail == link)
+		client->proxy_tail = link->prev;
+
+	client->proxy_list = g_list_delete_link(client->proxy_list, link);
+}
+
+static void proxy_free(gpointer data);
+
+static void proxy_list_free(GDBusClient *client)
+{
+	GList *list = client->proxy_list;
+
+	client->proxy_list = NULL;
+	client->proxy_tail = NULL;
+	g_hash_table_remove_all(client->proxy_index);
+
+	g_list_free_full(list, proxy_free);
+}
+
 static GDBusProxy *proxy_new(GDBusClient *client, const char *path,
 						const char *interface)
 {
@@ -546,7 +631,7 @@ static GDBusProxy *proxy_new(GDBusClient *client, const char *path,
 							proxy, NULL);
 	proxy->pending = TRUE;
 
-	client->proxy_list = g_list_append(client->proxy_list, proxy);
+	proxy_list_append(client, proxy);
 
 	return g_dbus_proxy_ref(proxy);
 }
@@ -583,20 +668,16 @@ static void proxy_free(gpointer data)
 static void proxy_remove(GDBusClient *client, const char *path,
 						const char *interface)
 {
-	GList *list;
+	GList *link;
+	GDBusProxy *proxy;
 
-	for (list = g_list_first(client->proxy_list); list;
-						list = g_list_next(list)) {
-		GDBusProxy *proxy = list->data;
+	link = proxy_index_lookup(client, path, interface);
+	if (!link)
+		return;
 
-		if (g_str_equal(proxy->interface, interface) == TRUE &&
-				g_str_equal(proxy->obj_path, path) == TRUE) {
-			client->proxy_list =
-				g_list_delete_link(client->proxy_list, list);
-			proxy_free(proxy);
-			break;
-		}
-	}
+	proxy = link->data;
+	proxy_list_delete_link(client, link);
+	proxy_free(proxy);
 }
 
 static void start_service(GDBusProxy *proxy)
@@ -628,8 +709,7 @@ GDBusProxy *g_dbus_proxy_new(GDBusClient *client, const char *path,
 	if (client == NULL)
 		return NULL;
 
-	proxy = g_dbus_proxy_lookup(client->proxy_list, NULL,
-						path, interface);
+	proxy = proxy_find(client, path, interface);
 	if (proxy)
 		return g_dbus_proxy_ref(proxy);
 
@@ -1068,8 +1148,7 @@ static void parse_properties(GDBusClient *client, const char *path,
 	if (g_str_equal(interface, DBUS_INTERFACE_PROPERTIES) == TRUE)
 		return;
 
-	proxy = g_dbus_proxy_lookup(client->proxy_list, NULL,
-						path, interface);
+	proxy = proxy_find(client, path, interface);
 	if (proxy && !proxy->pending) {
 		update_properties(proxy, iter, FALSE);
 		return;
@@ -1297,8 +1376,7 @@ static void service_disconnect(DBusConnection *conn, void *user_data)
 
 	client->connected = FALSE;
 
-	g_list_free_full(client->proxy_list, proxy_free);
-	client->proxy_list = NULL;
+	proxy_list_free(client);
 
 	if (client->disconn_func)
 		client->disconn_func(conn, client->disconn_data);
@@ -1365,6 +1443,9 @@ GDBusClient *g_dbus_client_new_full(DBusConnection *connection,
 	client->root_path = g_strdup(root_path);
 	client->connected = FALSE;
 
+	client->proxy_index = g_hash_table_new_full(g_str_hash, g_str_equal,
+								g_free, NULL);
+
 	client->match_rules = g_ptr_array_sized_new(1);
 	g_ptr_array_set_free_func(client->match_rules, g_free);
 
@@ -1440,7 +1521,8 @@ void g_dbus_client_unref(GDBusClient *client)
 	dbus_connection_remove_filter(client->dbus_conn,
 						message_filter, client);
 
-	g_list_free_full(client->proxy_list, proxy_free);
+	proxy_list_free(client);
+	g_hash_table_destroy(client->proxy_index);
 
 	/*
 	 * Don't call disconn_func twice if disconnection
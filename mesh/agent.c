@@ -35,9 +35,14 @@ typedef enum {
 	MESH_AGENT_REQUEST_CAPABILITIES,
 } agent_request_type_t;
 
+struct mesh_agent;
+
 struct agent_request {
+	struct mesh_agent *agent;
 	agent_request_type_t type;
+	uint32_t id;
 	struct l_dbus_message *msg;
+	l_dbus_message_func_t reply_cb;
 	void *cb;
 	void *user_data;
 };
@@ -46,7 +51,7 @@ struct mesh_agent {
 	char *path;
 	char *owner;
 	struct mesh_agent_prov_caps caps;
-	struct agent_request *req;
+	struct l_queue *reqs;
 };
 
 struct prov_action {
@@ -179,49 +184,59 @@ static bool parse_properties(struct mesh_agent *agent,
 	return true;
 }
 
-static void agent_free(void *agent_data)
+static void request_cancel(void *data)
 {
-	struct mesh_agent *agent = agent_data;
-	int err;
+	struct agent_request *req = data;
 	mesh_agent_cb_t simple_cb;
 	mesh_agent_key_cb_t key_cb;
 	mesh_agent_number_cb_t number_cb;
+	int err = MESH_ERROR_DOES_NOT_EXIST;
 
-	err = MESH_ERROR_DOES_NOT_EXIST;
-
-	if (agent->req && agent->req->cb) {
-		struct agent_request *req = agent->req;
+	if (req->msg)
+		l_dbus_message_unref(req->msg);
+	else
+		l_dbus_cancel(dbus_get_bus(), req->id);
 
-		switch (req->type) {
-		case MESH_AGENT_REQUEST_PUSH:
-		case MESH_AGENT_REQUEST_TWIST:
-		case MESH_AGENT_REQUEST_IN_NUMERIC:
-			number_cb = req->cb;
-			number_cb(req->user_data, err, 0);
-			break;
-		case MESH_AGENT_REQUEST_IN_ALPHA:
-		case MESH_AGENT_REQUEST_STATIC_OOB:
-		case MESH_AGENT_REQUEST_PRIVATE_KEY:
-		case MESH_AGENT_REQUEST_PUBLIC_KEY:
-			key_cb = req->cb;
-			key_cb(req->user_data, err, NULL, 0);
-			break;
-		case MESH_AGENT_REQUEST_BLINK:
-		case MESH_AGENT_REQUEST_BEEP:
-		case MESH_AGENT_REQUEST_VIBRATE:
-		case MESH_AGENT_REQUEST_OUT_NUMERIC:
-		case MESH_AGENT_REQUEST_OUT_ALPHA:
-		case MESH_AGENT_REQUEST_CAPABILITIES:
-			simple_cb = agent->req->cb;
-			simple_cb(req->user_data, err);
-		default:
-			break;
-		}
+	if (!req->cb)
+		goto done;
 
-		l_dbus_message_unref(req->msg);
-		l_free(req);
+	switch (req->type) {
+	case MESH_AGENT_REQUEST_PUSH:
+	case MESH_AGENT_REQUEST_TWIST:
+	case MESH_AGENT_REQUEST_IN_NUMERIC:
+		number_cb = req->cb;
+		number_cb(req->user_data, err, 0);
+		break;
+	case MESH_AGENT_REQUEST_IN_ALPHA:
+	case MESH_AGENT_REQUEST_STATIC_OOB:
+	case MESH_AGENT_REQUEST_PRIVATE_KEY:
+	case MESH_AGENT_REQUEST_PUBLIC_KEY:
+		key_cb = req->cb;
+		key_cb(req->user_data, err, NULL, 0);
+		break;
+	case MESH_AGENT_REQUEST_BLINK:
+	case MESH_AGENT_REQUEST_BEEP:
+	case MESH_AGENT_REQUEST_VIBRATE:
+	case MESH_AGENT_REQUEST_OUT_NUMERIC:
+	case MESH_AGENT_REQUEST_OUT_ALPHA:
+	case MESH_AGENT_REQUEST_CAPABILITIES:
+		simple_cb = req->cb;
+		simple_cb(req->user_data, err);
+	default:
+		break;
 	}
 
+done:
+	l_free(req);
+}
+
+static void agent_free(void *agent_data)
+{
+	struct mesh_agent *agent = agent_data;
+
+	/* Several provisioning sessions may be waiting on the agent */
+	l_queue_destroy(agent->reqs, request_cancel);
+
 	l_free(agent->path);
 	l_free(agent->owner);
 	l_free(agent);
@@ -266,6 +281,7 @@ struct mesh_agent *mesh_agent_create(const char *path, const char *owner,
 		return NULL;
 	}
 
+	agent->reqs = l_queue_new();
 	l_queue_push_tail(agents, agent);
 
 	return agent;
@@ -279,17 +295,67 @@ struct mesh_agent_prov_caps *mesh_agent_get_caps(struct mesh_agent *agent)
 	return &agent->caps;
 }
 
-static struct agent_request *create_request(agent_request_type_t type,
+static struct agent_request *create_request(struct mesh_agent *agent,
+						agent_request_type_t type,
 						void *cb, void *data)
 {
 	struct agent_request *req;
 
 	req = l_new(struct agent_request, 1);
 
+	req->agent = agent;
 	req->type = type;
 	req->cb = cb;
 	req->user_data = data;
 
+	l_queue_push_tail(agent->reqs, req);
+
+	return req;
+}
+
+/*
+ * Agents handle one request at a time, e.g. tools/mesh rejects a prompt
+ * while another one is pending, so requests of concurrent provisioning
+ * sessions are queued and sent one after the other.
+ */
+static void send_request(struct agent_request *req, struct l_dbus_message *msg,
+					l_dbus_message_func_t reply_cb)
+{
+	if (l_queue_peek_head(req->agent->reqs) != req) {
+		req->msg = msg;
+		req->reply_cb = reply_cb;
+		return;
+	}
+
+	req->id = l_dbus_send_with_reply(dbus_get_bus(), msg, reply_cb, req,
+									NULL);
+}
+
+static void send_next_request(struct mesh_agent *agent)
+{
+	struct agent_request *req = l_queue_peek_head(agent->reqs);
+	struct l_dbus_message *msg;
+
+	if (!req || !req->msg)
+		return;
+
+	msg = req->msg;
+	req->msg = NULL;
+
+	req->id = l_dbus_send_with_reply(dbus_get_bus(), msg, req->reply_cb,
+								req, NULL);
+}
+
+static struct agent_request *complete_request(void *user_data)
+{
+	struct agent_request *req = user_data;
+
+	/* Detach before the callback, which may tear down the agent */
+	if (!l_queue_remove(req->agent->reqs, req))
+		return NULL;
+
+	send_next_request(req->agent);
+
 	return req;
 }
 
@@ -309,16 +375,16 @@ static int get_reply_error(struct l_dbus_message *reply)
 
 static void properties_reply(struct l_dbus_message *reply, void *user_data)
 {
-	struct mesh_agent *agent = user_data;
-	struct agent_request *req;
+	struct agent_request *req = complete_request(user_data);
+	struct mesh_agent *agent;
 	mesh_agent_cb_t cb;
 	struct l_dbus_message_iter properties;
 	int err;
 
-	if (!l_queue_find(agents, simple_match, agent) || !agent->req)
+	if (!req)
 		return;
 
-	req = agent->req;
+	agent = req->agent;
 
 	err = get_reply_error(reply);
 
@@ -339,9 +405,7 @@ done:
 		cb(req->user_data, err);
 	}
 
-	l_dbus_message_unref(req->msg);
 	l_free(req);
-	agent->req = NULL;
 }
 
 void mesh_agent_refresh(struct mesh_agent *agent, mesh_agent_cb_t cb,
@@ -350,9 +414,10 @@ void mesh_agent_refresh(struct mesh_agent *agent, mesh_agent_cb_t cb,
 	struct l_dbus *dbus = dbus_get_bus();
 	struct l_dbus_message *msg;
 	struct l_dbus_message_builder *builder;
+	struct agent_request *req;
 
-	agent->req = create_request(MESH_AGENT_REQUEST_CAPABILITIES, (void *)cb,
-								user_data);
+	req = create_request(agent, MESH_AGENT_REQUEST_CAPABILITIES,
+							(void *) cb, user_data);
 
 	msg = l_dbus_message_new_method_call(dbus, agent->owner, agent->path,
 						L_DBUS_INTERFACE_PROPERTIES,
@@ -364,51 +429,39 @@ void mesh_agent_refresh(struct mesh_agent *agent, mesh_agent_cb_t cb,
 	l_dbus_message_builder_finalize(builder);
 	l_dbus_message_builder_destroy(builder);
 
-	l_dbus_send_with_reply(dbus_get_bus(), msg, properties_reply, agent,
-									NULL);
-
-	agent->req->msg = l_dbus_message_ref(msg);
+	send_request(req, msg, properties_reply);
 }
 
 
 static void simple_reply(struct l_dbus_message *reply, void *user_data)
 {
-	struct mesh_agent *agent = user_data;
-	struct agent_request *req;
+	struct agent_request *req = complete_request(user_data);
 	mesh_agent_cb_t cb;
 	int err;
 
-	if (!l_queue_find(agents, simple_match, agent) || !agent->req)
+	if (!req)
 		return;
 
-	req = agent->req;
-
 	err = get_reply_error(reply);
 
-	l_dbus_message_unref(req->msg);
-
 	if (req->cb) {
 		cb = req->cb;
 		cb(req->user_data, err);
 	}
 
 	l_free(req);
-	agent->req = NULL;
 }
 
 static void numeric_reply(struct l_dbus_message *reply, void *user_data)
 {
-	struct mesh_agent *agent = user_data;
-	struct agent_request *req;
+	struct agent_request *req = complete_request(user_data);
 	mesh_agent_number_cb_t cb;
 	uint32_t count;
 	int err;
 
-	if (!l_queue_find(agents, simple_match, agent) || !agent->req)
+	if (!req)
 		return;
 
-	req = agent->req;
-
 	err = get_reply_error(reply);
 
 	count = 0;
@@ -420,32 +473,26 @@ static void numeric_reply(struct l_dbus_message *reply, void *user_data)
 		}
 	}
 
-	l_dbus_message_unref(req->msg);
-
 	if (req->cb) {
 		cb = req->cb;
 		cb(req->user_data, err, count);
 	}
 
 	l_free(req);
-	agent->req = NULL;
 }
 
 static void key_reply(struct l_dbus_message *reply, void *user_data)
 {
-	struct mesh_agent *agent = user_data;
-	struct agent_request *req;
+	struct agent_request *req = complete_request(user_data);
 	mesh_agent_key_cb_t cb;
 	struct l_dbus_message_iter iter_array;
 	uint32_t n = 0, expected_len = 0;
 	uint8_t *buf = NULL;
 	int err;
 
-	if (!l_queue_find(agents, simple_match, agent) || !agent->req)
+	if (!req)
 		return;
 
-	req = agent->req;
-
 	err = get_reply_error(reply);
 
 	if (err != MESH_ERROR_NONE)
@@ -482,10 +529,7 @@ done:
 		cb(req->user_data, err, buf, n);
 	}
 
-	l_dbus_message_unref(req->msg);
-
 	l_free(req);
-	agent->req = NULL;
 }
 
 static int output_request(struct mesh_agent *agent, const char *action,
@@ -495,14 +539,12 @@ static int output_request(struct mesh_agent *agent, const char *action,
 	struct l_dbus *dbus = dbus_get_bus();
 	struct l_dbus_message *msg;
 	struct l_dbus_message_builder *builder;
+	struct agent_request *req;
 
 	if (!l_queue_find(agents, simple_match, agent))
 		return MESH_ERROR_DOES_NOT_EXIST;
 
-	if (agent->req)
-		return MESH_ERROR_BUSY;
-
-	agent->req = create_request(type, cb, user_data);
+	req = create_request(agent, type, cb, user_data);
 	msg = l_dbus_message_new_method_call(dbus, agent->owner, agent->path,
 						MESH_PROVISION_AGENT_INTERFACE,
 						"DisplayNumeric");
@@ -516,10 +558,7 @@ static int output_request(struct mesh_agent *agent, const char *action,
 	l_debug("Send DisplayNumeric request to %s %s",
 						agent->owner, agent->path);
 
-	l_dbus_send_with_reply(dbus_get_bus(), msg, simple_reply, agent,
-									NULL);
-
-	agent->req->msg = l_dbus_message_ref(msg);
+	send_request(req, msg, simple_reply);
 
 	return MESH_ERROR_NONE;
 }
@@ -533,14 +572,12 @@ static int prompt_input(struct mesh_agent *agent, const char *action,
 	struct l_dbus_message_builder *builder;
 	const char *method_name;
 	l_dbus_message_func_t reply_cb;
+	struct agent_request *req;
 
 	if (!l_queue_find(agents, simple_match, agent))
 		return MESH_ERROR_DOES_NOT_EXIST;
 
-	if (agent->req)
-		return MESH_ERROR_BUSY;
-
-	agent->req = create_request(type, cb, user_data);
+	req = create_request(agent, type, cb, user_data);
 
 	method_name = numeric ? "PromptNumeric" : "PromptStatic";
 
@@ -559,9 +596,7 @@ static int prompt_input(struct mesh_agent *agent, const char *action,
 
 	reply_cb = numeric ? numeric_reply : key_reply;
 
-	l_dbus_send_with_reply(dbus_get_bus(), msg, reply_cb, agent, NULL);
-
-	agent->req->msg = l_dbus_message_ref(msg);
+	send_request(req, msg, reply_cb);
 
 	return MESH_ERROR_NONE;
 }
@@ -573,14 +608,12 @@ static int request_key(struct mesh_agent *agent,
 	struct l_dbus *dbus = dbus_get_bus();
 	struct l_dbus_message *msg;
 	const char *method_name;
+	struct agent_request *req;
 
 	if (!l_queue_find(agents, simple_match, agent))
 		return MESH_ERROR_DOES_NOT_EXIST;
 
-	if (agent->req)
-		return MESH_ERROR_BUSY;
-
-	agent->req = create_request(type, cb, user_data);
+	req = create_request(agent, type, cb, user_data);
 
 	method_name = (type == MESH_AGENT_REQUEST_PRIVATE_KEY) ?
 						"PrivateKey" : "PublicKey";
@@ -594,9 +627,7 @@ static int request_key(struct mesh_agent *agent,
 
 	l_debug("Send key request to %s %s", agent->owner, agent->path);
 
-	l_dbus_send_with_reply(dbus_get_bus(), msg, key_reply, agent, NULL);
-
-	agent->req->msg = l_dbus_message_ref(msg);
+	send_request(req, msg, key_reply);
 
 	return MESH_ERROR_NONE;
 }
@@ -607,15 +638,13 @@ int mesh_agent_display_string(struct mesh_agent *agent, const char *str,
 	struct l_dbus *dbus = dbus_get_bus();
 	struct l_dbus_message *msg;
 	struct l_dbus_message_builder *builder;
+	struct agent_request *req;
 
 	if (!l_queue_find(agents, simple_match, agent))
 		return MESH_ERROR_DOES_NOT_EXIST;
 
-	if (agent->req)
-		return MESH_ERROR_BUSY;
-
-	agent->req = create_request(MESH_AGENT_REQUEST_OUT_ALPHA,
-								cb, user_data);
+	req = create_request(agent, MESH_AGENT_REQUEST_OUT_ALPHA, cb,
+								user_data);
 	msg = l_dbus_message_new_method_call(dbus, agent->owner, agent->path,
 						MESH_PROVISION_AGENT_INTERFACE,
 						"DisplayString");
@@ -628,10 +657,7 @@ int mesh_agent_display_string(struct mesh_agent *agent, const char *str,
 	l_debug("Send DisplayString request to %s %s",
 						agent->owner, agent->path);
 
-	l_dbus_send_with_reply(dbus_get_bus(), msg, simple_reply, agent,
-									NULL);
-
-	agent->req->msg = l_dbus_message_ref(msg);
+	send_request(req, msg, simple_reply);
 
 	return MESH_ERROR_NONE;
 
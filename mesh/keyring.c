@@ -26,61 +26,74 @@
 
 #include "mesh/mesh-defs.h"
 
+#include "mesh/util.h"
 #include "mesh/dbus.h"
 #include "mesh/node.h"
 #include "mesh/keyring.h"
 
+static const char *keyring_file = "/keyring";
 static const char *dev_key_dir = "/dev_keys";
 static const char *app_key_dir = "/app_keys";
 static const char *net_key_dir = "/net_keys";
 
-static int open_key_file(struct mesh_node *node, const char *key_dir,
-							uint16_t idx, int flags)
-{
-	const char *node_path;
-	char fname[PATH_MAX];
-	int ret;
+#define RECORD_NET_KEY	0x01
+#define RECORD_APP_KEY	0x02
+#define RECORD_DEV_KEY	0x03
 
-	if (!node)
-		return -1;
+#define NET_KEY_RECORD_LEN	(1 + 2 + 1 + 16 + 16)
+#define APP_KEY_RECORD_LEN	(1 + 2 + 2 + 16 + 16)
+#define DEV_KEY_RECORD_LEN	(1 + 2 + 16)
 
-	node_path = node_get_storage_dir(node);
+/*
+ * Keys of a node are kept in memory and written out as a whole to a single
+ * keyring file. Writes are deferred to idle so that a burst of updates, e.g.
+ * mass key refresh or provisioning, results in a single file replacement.
+ *
+ * As a consequence a successful put or delete only means the in-memory
+ * keyring was updated: the keys are not on disk yet when it returns, and a
+ * failure to write them is only logged once the deferred write runs.
+ */
+struct keyring {
+	struct mesh_node *node;
+	struct l_hashmap *net_keys;
+	struct l_hashmap *app_keys;
+	struct l_hashmap *dev_keys;
+	struct l_idle *save;
+};
 
-	if (flags & O_CREAT) {
-		ret = snprintf(fname, PATH_MAX, "%s%s", node_path, key_dir);
-		if (ret < 0)
-			return -1;
+static struct l_queue *keyrings;
 
-		if (mkdir(fname, 0755) != 0 && errno != EEXIST)
-			l_error("Failed to create dir(%d): %s", errno, fname);
-	}
+static bool match_node(const void *a, const void *b)
+{
+	const struct keyring *keyring = a;
+
+	return keyring->node == b;
+}
 
-	ret = snprintf(fname, PATH_MAX, "%s%s/%3.3x", node_path, key_dir, idx);
-	if (ret < 0)
-		return -1;
+static void replace_key(struct l_hashmap *keys, uint16_t idx, void *key)
+{
+	void *old_key = NULL;
 
-	if (flags & O_CREAT)
-		return open(fname, flags, 0600);
-	else
-		return open(fname, flags);
+	l_hashmap_replace(keys, L_UINT_TO_PTR(idx), key, &old_key);
+	l_free(old_key);
 }
 
-bool keyring_put_net_key(struct mesh_node *node, uint16_t net_idx,
-						struct keyring_net_key *key)
+static bool read_key_file(const char *node_path, const char *key_dir,
+					const char *name, void *key, ssize_t sz)
 {
+	char fname[PATH_MAX];
 	bool result = false;
 	int fd;
 
-	if (!key)
+	if (snprintf(fname, PATH_MAX, "%s%s/%s", node_path, key_dir,
+								name) < 0)
 		return false;
 
-	fd = open_key_file(node, net_key_dir, net_idx,
-					O_WRONLY | O_CREAT | O_TRUNC);
-
+	fd = open(fname, O_RDONLY);
 	if (fd < 0)
 		return false;
 
-	if (write(fd, key, sizeof(*key)) == sizeof(*key))
+	if (read(fd, key, sz) == sz)
 		result = true;
 
 	close(fd);
@@ -88,257 +101,602 @@ bool keyring_put_net_key(struct mesh_node *node, uint16_t net_idx,
 	return result;
 }
 
-bool keyring_put_app_key(struct mesh_node *node, uint16_t app_idx,
-				uint16_t net_idx, struct keyring_app_key *key)
+static bool import_key_dir(struct keyring *keyring, const char *node_path,
+							const char *key_dir)
 {
-	bool result = false;
-	int fd;
+	char dir_path[PATH_MAX];
+	struct dirent *entry;
+	bool found = false;
+	DIR *dir;
 
-	if (!key)
+	if (snprintf(dir_path, PATH_MAX, "%s%s", node_path, key_dir) < 0)
 		return false;
 
-	fd = open_key_file(node, app_key_dir, app_idx, O_RDWR);
+	dir = opendir(dir_path);
+	if (!dir)
+		return false;
+
+	while ((entry = readdir(dir)) != NULL) {
+		struct keyring_net_key net_key;
+		struct keyring_app_key app_key;
+		uint8_t dev_key[16];
+		unsigned int idx;
+
+		if (entry->d_type != DT_REG)
+			continue;
 
-	if (fd >= 0) {
-		struct keyring_app_key old_key;
+		if (sscanf(entry->d_name, "%x", &idx) != 1 || idx > 0xffff)
+			continue;
 
-		if (read(fd, &old_key, sizeof(old_key)) == sizeof(old_key)) {
-			if (old_key.net_idx != net_idx) {
-				close(fd);
-				return false;
-			}
+		if (key_dir == net_key_dir) {
+			if (!read_key_file(node_path, key_dir, entry->d_name,
+						&net_key, sizeof(net_key)))
+				continue;
+
+			replace_key(keyring->net_keys, net_key.net_idx,
+					l_memdup(&net_key, sizeof(net_key)));
+		} else if (key_dir == app_key_dir) {
+			if (!read_key_file(node_path, key_dir, entry->d_name,
+						&app_key, sizeof(app_key)))
+				continue;
+
+			replace_key(keyring->app_keys, app_key.app_idx,
+					l_memdup(&app_key, sizeof(app_key)));
+		} else {
+			if (!read_key_file(node_path, key_dir, entry->d_name,
+							dev_key, 16))
+				continue;
+
+			replace_key(keyring->dev_keys, idx,
+						l_memdup(dev_key, 16));
 		}
 
-		lseek(fd, 0, SEEK_SET);
-	} else
-		fd = open_key_file(node, app_key_dir, app_idx,
-						O_WRONLY | O_CREAT | O_TRUNC);
+		found = true;
+	}
 
-	if (fd < 0)
-		return false;
+	closedir(dir);
 
-	if (write(fd, key, sizeof(*key)) == sizeof(*key))
-		result = true;
+	return found;
+}
 
+/*
+ * Returns -ENOENT if the node has no keyring file yet. Any other error means
+ * the file exists but could not be used, and must not be overwritten.
+ */
+static int load_keyring(struct keyring *keyring, const char *node_path)
+{
+	char fname[PATH_MAX];
+	uint8_t *buf, *ptr, *end;
+	struct stat st;
+	int result = -EIO;
+	int fd;
+
+	if (snprintf(fname, PATH_MAX, "%s%s", node_path, keyring_file) < 0)
+		return -EINVAL;
+
+	fd = open(fname, O_RDONLY);
+	if (fd < 0) {
+		if (errno == ENOENT)
+			return -ENOENT;
+
+		l_error("Failed to open keyring(%d): %s", errno, fname);
+		return -EIO;
+	}
+
+	if (fstat(fd, &st) < 0) {
+		l_error("Failed to stat keyring(%d): %s", errno, fname);
+		close(fd);
+		return -EIO;
+	}
+
+	if (!st.st_size) {
+		close(fd);
+		return 0;
+	}
+
+	buf = l_malloc(st.st_size);
+
+	if (read(fd, buf, st.st_size) != st.st_size) {
+		l_error("Failed to read keyring: %s", fname);
+		goto done;
+	}
+
+	ptr = buf;
+	end = buf + st.st_size;
+
+	while (ptr < end) {
+		struct keyring_net_key net_key;
+		struct keyring_app_key app_key;
+		uint16_t unicast;
+
+		switch (ptr[0]) {
+		case RECORD_NET_KEY:
+			if (end - ptr < NET_KEY_RECORD_LEN)
+				goto corrupt;
+
+			memset(&net_key, 0, sizeof(net_key));
+			net_key.net_idx = l_get_le16(ptr + 1);
+			net_key.phase = ptr[3];
+			memcpy(net_key.old_key, ptr + 4, 16);
+			memcpy(net_key.new_key, ptr + 20, 16);
+
+			replace_key(keyring->net_keys, net_key.net_idx,
+					l_memdup(&net_key, sizeof(net_key)));
+			ptr += NET_KEY_RECORD_LEN;
+			break;
+
+		case RECORD_APP_KEY:
+			if (end - ptr < APP_KEY_RECORD_LEN)
+				goto corrupt;
+
+			memset(&app_key, 0, sizeof(app_key));
+			app_key.app_idx = l_get_le16(ptr + 1);
+			app_key.net_idx = l_get_le16(ptr + 3);
+			memcpy(app_key.old_key, ptr + 5, 16);
+			memcpy(app_key.new_key, ptr + 21, 16);
+
+			replace_key(keyring->app_keys, app_key.app_idx,
+					l_memdup(&app_key, sizeof(app_key)));
+			ptr += APP_KEY_RECORD_LEN;
+			break;
+
+		case RECORD_DEV_KEY:
+			if (end - ptr < DEV_KEY_RECORD_LEN)
+				goto corrupt;
+
+			unicast = l_get_le16(ptr + 1);
+
+			replace_key(keyring->dev_keys, unicast,
+						l_memdup(ptr + 3, 16));
+			ptr += DEV_KEY_RECORD_LEN;
+			break;
+
+		default:
+			goto corrupt;
+		}
+	}
+
+	result = 0;
+	goto done;
+
+corrupt:
+	l_error("Corrupted keyring: %s", fname);
+	result = -EBADMSG;
+
+done:
+	l_free(buf);
 	close(fd);
 
 	return result;
 }
 
-static void finalize(int dir_fd, const char *fname, uint16_t net_idx)
+struct keyring_buf {
+	uint8_t *data;
+	size_t len;
+};
+
+static void write_net_key(const void *key, void *value, void *user_data)
+{
+	const struct keyring_net_key *net_key = value;
+	struct keyring_buf *buf = user_data;
+	uint8_t *ptr = buf->data + buf->len;
+
+	ptr[0] = RECORD_NET_KEY;
+	l_put_le16(net_key->net_idx, ptr + 1);
+	ptr[3] = net_key->phase;
+	memcpy(ptr + 4, net_key->old_key, 16);
+	memcpy(ptr + 20, net_key->new_key, 16);
+
+	buf->len += NET_KEY_RECORD_LEN;
+}
+
+static void write_app_key(const void *key, void *value, void *user_data)
+{
+	const struct keyring_app_key *app_key = value;
+	struct keyring_buf *buf = user_data;
+	uint8_t *ptr = buf->data + buf->len;
+
+	ptr[0] = RECORD_APP_KEY;
+	l_put_le16(app_key->app_idx, ptr + 1);
+	l_put_le16(app_key->net_idx, ptr + 3);
+	memcpy(ptr + 5, app_key->old_key, 16);
+	memcpy(ptr + 21, app_key->new_key, 16);
+
+	buf->len += APP_KEY_RECORD_LEN;
+}
+
+static void write_dev_key(const void *key, void *value, void *user_data)
 {
-	struct keyring_app_key key;
+	struct keyring_buf *buf = user_data;
+	uint8_t *ptr = buf->data + buf->len;
+
+	ptr[0] = RECORD_DEV_KEY;
+	l_put_le16(L_PTR_TO_UINT(key), ptr + 1);
+	memcpy(ptr + 3, value, 16);
+
+	buf->len += DEV_KEY_RECORD_LEN;
+}
+
+static bool save_keyring(struct keyring *keyring)
+{
+	const char *node_path = node_get_storage_dir(keyring->node);
+	char fname[PATH_MAX], fname_tmp[PATH_MAX];
+	struct keyring_buf buf;
+	bool result = false;
+	size_t size;
 	int fd;
 
-	fd = openat(dir_fd, fname, O_RDWR);
+	if (!node_path)
+		return false;
 
-	if (fd < 0)
-		return;
+	if (snprintf(fname, PATH_MAX, "%s%s", node_path, keyring_file) < 0 ||
+			snprintf(fname_tmp, PATH_MAX, "%s%s.tmp", node_path,
+							keyring_file) < 0)
+		return false;
+
+	size = l_hashmap_size(keyring->net_keys) * NET_KEY_RECORD_LEN +
+		l_hashmap_size(keyring->app_keys) * APP_KEY_RECORD_LEN +
+		l_hashmap_size(keyring->dev_keys) * DEV_KEY_RECORD_LEN;
+
+	buf.data = l_malloc(size ? size : 1);
+	buf.len = 0;
 
-	if (read(fd, &key, sizeof(key)) != sizeof(key) ||
-						key.net_idx != net_idx)
+	l_hashmap_foreach(keyring->net_keys, write_net_key, &buf);
+	l_hashmap_foreach(keyring->app_keys, write_app_key, &buf);
+	l_hashmap_foreach(keyring->dev_keys, write_dev_key, &buf);
+
+	fd = open(fname_tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		l_error("Failed to create keyring(%d): %s", errno, fname_tmp);
+		goto done;
+	}
+
+	/* Replace the keyring only once the new contents are on disk */
+	if (write(fd, buf.data, buf.len) != (ssize_t) buf.len ||
+							fsync(fd) < 0) {
+		l_error("Failed to write keyring(%d): %s", errno, fname_tmp);
+		close(fd);
+		remove(fname_tmp);
 		goto done;
+	}
 
-	l_debug("Finalize %s", fname);
-	memcpy(key.old_key, key.new_key, 16);
-	lseek(fd, 0, SEEK_SET);
+	close(fd);
 
-	if (write(fd, &key, sizeof(key)) != sizeof(key))
+	if (rename(fname_tmp, fname) < 0) {
+		l_error("Failed to replace keyring(%d): %s", errno, fname);
+		remove(fname_tmp);
 		goto done;
+	}
+
+	result = true;
 
 done:
-	close(fd);
+	l_free(buf.data);
+
+	return result;
 }
 
-bool keyring_finalize_app_keys(struct mesh_node *node, uint16_t net_idx)
+static void remove_key_dirs(const char *node_path)
+{
+	const char *key_dirs[] = { net_key_dir, app_key_dir, dev_key_dir };
+	char dir_path[PATH_MAX];
+	size_t i;
+
+	for (i = 0; i < L_ARRAY_SIZE(key_dirs); i++) {
+		if (snprintf(dir_path, PATH_MAX, "%s%s", node_path,
+							key_dirs[i]) < 0)
+			continue;
+
+		del_path(dir_path);
+	}
+}
+
+static void keyring_free(void *data)
 {
+	struct keyring *keyring = data;
+
+	l_idle_remove(keyring->save);
+	l_hashmap_destroy(keyring->net_keys, l_free);
+	l_hashmap_destroy(keyring->app_keys, l_free);
+	l_hashmap_destroy(keyring->dev_keys, l_free);
+	l_free(keyring);
+}
+
+static struct keyring *get_keyring(struct mesh_node *node)
+{
+	struct keyring *keyring;
 	const char *node_path;
-	char key_dir[PATH_MAX];
-	DIR *dir;
-	int ret, dir_fd;
-	struct dirent *entry;
+	int err;
 
 	if (!node)
-		return false;
+		return NULL;
+
+	keyring = l_queue_find(keyrings, match_node, node);
+	if (keyring)
+		return keyring;
 
 	node_path = node_get_storage_dir(node);
+	if (!node_path)
+		return NULL;
 
-	ret = snprintf(key_dir, PATH_MAX, "%s%s", node_path, app_key_dir);
-	if (ret < 0)
-		return false;
+	keyring = l_new(struct keyring, 1);
+	keyring->node = node;
+	keyring->net_keys = l_hashmap_new();
+	keyring->app_keys = l_hashmap_new();
+	keyring->dev_keys = l_hashmap_new();
 
-	dir = opendir(key_dir);
-	if (!dir) {
-		if (errno == ENOENT)
-			return true;
+	err = load_keyring(keyring, node_path);
+	if (err == -ENOENT) {
+		bool found;
 
-		l_error("Failed to open AppKey storage directory: %s", key_dir);
-		return false;
+		/* Convert keys stored in one file per key */
+		found = import_key_dir(keyring, node_path, net_key_dir);
+		found |= import_key_dir(keyring, node_path, app_key_dir);
+		found |= import_key_dir(keyring, node_path, dev_key_dir);
+
+		if (found && save_keyring(keyring)) {
+			l_debug("Converted keyring of %s", node_path);
+			remove_key_dirs(node_path);
+		}
+	} else if (err < 0) {
+		/* Writing anything now would replace the stored keys */
+		keyring_free(keyring);
+		return NULL;
 	}
 
-	dir_fd = dirfd(dir);
+	if (!keyrings)
+		keyrings = l_queue_new();
 
-	while ((entry = readdir(dir)) != NULL) {
-		/* AppKeys are stored in regular files */
-		if (entry->d_type == DT_REG)
-			finalize(dir_fd, entry->d_name, net_idx);
+	l_queue_push_tail(keyrings, keyring);
+
+	return keyring;
+}
+
+static void idle_save_keyring(struct l_idle *idle, void *user_data)
+{
+	struct keyring *keyring = user_data;
+
+	l_idle_remove(keyring->save);
+	keyring->save = NULL;
+
+	save_keyring(keyring);
+}
+
+static void schedule_save(struct keyring *keyring)
+{
+	if (keyring->save)
+		return;
+
+	keyring->save = l_idle_create(idle_save_keyring, keyring, NULL);
+	if (!keyring->save)
+		save_keyring(keyring);
+}
+
+static void release_keyring(struct mesh_node *node, bool save)
+{
+	struct keyring *keyring;
+
+	keyring = l_queue_remove_if(keyrings, match_node, node);
+	if (!keyring)
+		return;
+
+	if (save && keyring->save)
+		save_keyring(keyring);
+
+	keyring_free(keyring);
+
+	if (l_queue_isempty(keyrings)) {
+		l_queue_destroy(keyrings, NULL);
+		keyrings = NULL;
 	}
+}
 
-	closedir(dir);
+void keyring_release(struct mesh_node *node)
+{
+	release_keyring(node, true);
+}
 
-	return true;
+/* Drop the keyring without writing out pending changes */
+void keyring_discard(struct mesh_node *node)
+{
+	release_keyring(node, false);
 }
 
-bool keyring_put_remote_dev_key(struct mesh_node *node, uint16_t unicast,
-					uint8_t count, uint8_t dev_key[16])
+bool keyring_put_net_key(struct mesh_node *node, uint16_t net_idx,
+						struct keyring_net_key *key)
 {
-	const char *node_path;
-	char key_file[PATH_MAX];
-	bool result = true;
-	int ret, fd, i;
+	struct keyring *keyring;
 
-	if (!IS_UNICAST_RANGE(unicast, count))
+	if (!key)
 		return false;
 
-	if (!node)
+	keyring = get_keyring(node);
+	if (!keyring)
 		return false;
 
-	node_path = node_get_storage_dir(node);
+	replace_key(keyring->net_keys, net_idx, l_memdup(key, sizeof(*key)));
+	schedule_save(keyring);
+
+	return true;
+}
 
-	ret = snprintf(key_file, PATH_MAX, "%s%s", node_path, dev_key_dir);
-	if (ret < 0)
+bool keyring_put_app_key(struct mesh_node *node, uint16_t app_idx,
+				uint16_t net_idx, struct keyring_app_key *key)
+{
+	struct keyring *keyring;
+	struct keyring_app_key *old_key;
+
+	if (!key)
 		return false;
 
-	if (mkdir(key_file, 0755) != 0 && errno != EEXIST)
-		l_error("Failed to create dir(%d): %s", errno, key_file);
+	keyring = get_keyring(node);
+	if (!keyring)
+		return false;
 
-	for (i = 0; i < count; i++) {
-		ret = snprintf(key_file, PATH_MAX, "%s%s/%4.4x", node_path,
-						dev_key_dir, unicast + i);
-		if (ret < 0)
-			return false;
+	old_key = l_hashmap_lookup(keyring->app_keys, L_UINT_TO_PTR(app_idx));
+	if (old_key && old_key->net_idx != net_idx)
+		return false;
 
-		l_debug("Put Dev Key %s", key_file);
+	replace_key(keyring->app_keys, app_idx, l_memdup(key, sizeof(*key)));
+	schedule_save(keyring);
 
-		fd = open(key_file, O_WRONLY | O_CREAT | O_TRUNC, 0600);
-		if (fd >= 0) {
-			if (write(fd, dev_key, 16) != 16)
-				result = false;
+	return true;
+}
 
-			close(fd);
-		} else
-			result = false;
-	}
+struct finalize_data {
+	uint16_t net_idx;
+	bool changed;
+};
 
-	return result;
+static void finalize(const void *key, void *value, void *user_data)
+{
+	struct keyring_app_key *app_key = value;
+	struct finalize_data *data = user_data;
+
+	if (app_key->net_idx != data->net_idx)
+		return;
+
+	l_debug("Finalize %3.3x", app_key->app_idx);
+	memcpy(app_key->old_key, app_key->new_key, 16);
+	data->changed = true;
 }
 
-static bool get_key(struct mesh_node *node, const char *key_dir,
-					uint16_t key_idx, void *key, ssize_t sz)
+bool keyring_finalize_app_keys(struct mesh_node *node, uint16_t net_idx)
 {
-	bool result = false;
-	int fd;
+	struct keyring *keyring;
+	struct finalize_data data = { .net_idx = net_idx };
 
-	if (!key)
+	keyring = get_keyring(node);
+	if (!keyring)
 		return false;
 
-	fd = open_key_file(node, key_dir, key_idx, O_RDONLY);
+	l_hashmap_foreach(keyring->app_keys, finalize, &data);
 
-	if (fd >= 0) {
-		if (read(fd, key, sz) == sz)
-			result = true;
+	if (data.changed)
+		schedule_save(keyring);
 
-		close(fd);
+	return true;
+}
+
+bool keyring_put_remote_dev_key(struct mesh_node *node, uint16_t unicast,
+					uint8_t count, uint8_t dev_key[16])
+{
+	struct keyring *keyring;
+	int i;
+
+	if (!IS_UNICAST_RANGE(unicast, count))
+		return false;
+
+	keyring = get_keyring(node);
+	if (!keyring)
+		return false;
+
+	for (i = 0; i < count; i++) {
+		l_debug("Put Dev Key %4.4x", unicast + i);
+
+		replace_key(keyring->dev_keys, unicast + i,
+						l_memdup(dev_key, 16));
 	}
 
-	return result;
+	schedule_save(keyring);
+
+	return true;
 }
 
 bool keyring_get_net_key(struct mesh_node *node, uint16_t net_idx,
 						struct keyring_net_key *key)
 {
-	return get_key(node, net_key_dir, net_idx, key, sizeof(*key));
+	struct keyring *keyring;
+	const struct keyring_net_key *net_key;
+
+	if (!key)
+		return false;
+
+	keyring = get_keyring(node);
+	if (!keyring)
+		return false;
+
+	net_key = l_hashmap_lookup(keyring->net_keys, L_UINT_TO_PTR(net_idx));
+	if (!net_key)
+		return false;
+
+	memcpy(key, net_key, sizeof(*key));
+
+	return true;
 }
 
 bool keyring_get_app_key(struct mesh_node *node, uint16_t app_idx,
 						struct keyring_app_key *key)
 {
-	return get_key(node, app_key_dir, app_idx, key, sizeof(*key));
+	struct keyring *keyring;
+	const struct keyring_app_key *app_key;
+
+	if (!key)
+		return false;
+
+	keyring = get_keyring(node);
+	if (!keyring)
+		return false;
+
+	app_key = l_hashmap_lookup(keyring->app_keys, L_UINT_TO_PTR(app_idx));
+	if (!app_key)
+		return false;
+
+	memcpy(key, app_key, sizeof(*key));
+
+	return true;
 }
 
 bool keyring_get_remote_dev_key(struct mesh_node *node, uint16_t unicast,
 							uint8_t dev_key[16])
 {
-	const char *node_path;
-	char key_file[PATH_MAX];
-	bool result = false;
-	int ret, fd;
+	struct keyring *keyring;
+	const uint8_t *key;
 
 	if (!IS_UNICAST(unicast))
 		return false;
 
-	if (!node)
+	keyring = get_keyring(node);
+	if (!keyring)
 		return false;
 
-	node_path = node_get_storage_dir(node);
-
-	ret = snprintf(key_file, PATH_MAX, "%s%s/%4.4x", node_path, dev_key_dir,
-								unicast);
-	if (ret < 0)
+	key = l_hashmap_lookup(keyring->dev_keys, L_UINT_TO_PTR(unicast));
+	if (!key)
 		return false;
 
-	fd = open(key_file, O_RDONLY);
-	if (fd >= 0) {
-		if (read(fd, dev_key, 16) == 16)
-			result = true;
-
-		close(fd);
-	}
+	memcpy(dev_key, key, 16);
 
-	return result;
+	return true;
 }
 
 bool keyring_del_net_key(struct mesh_node *node, uint16_t net_idx)
 {
-	const char *node_path;
-	char key_file[PATH_MAX];
-	int ret;
+	struct keyring *keyring;
 
-	if (!node)
-		return false;
-
-	node_path = node_get_storage_dir(node);
-	ret = snprintf(key_file, PATH_MAX, "%s%s/%3.3x", node_path, net_key_dir,
-								net_idx);
-	if (ret < 0)
+	keyring = get_keyring(node);
+	if (!keyring)
 		return false;
 
-	l_debug("RM Net Key %s", key_file);
-	remove(key_file);
+	l_debug("RM Net Key %3.3x", net_idx);
+	l_free(l_hashmap_remove(keyring->net_keys, L_UINT_TO_PTR(net_idx)));
+	schedule_save(keyring);
 
 	/* TODO: See if it is easiest to delete all bound App keys here */
-	/* TODO: see nftw() */
 
 	return true;
 }
 
 bool keyring_del_app_key(struct mesh_node *node, uint16_t app_idx)
 {
-	const char *node_path;
-	char key_file[PATH_MAX];
-	int ret;
-
-	if (!node)
-		return false;
+	struct keyring *keyring;
 
-	node_path = node_get_storage_dir(node);
-	ret = snprintf(key_file, PATH_MAX, "%s%s/%3.3x", node_path, app_key_dir,
-								app_idx);
-	if (ret < 0)
+	keyring = get_keyring(node);
+	if (!keyring)
 		return false;
 
-	l_debug("RM App Key %s", key_file);
-	remove(key_file);
+	l_debug("RM App Key %3.3x", app_idx);
+	l_free(l_hashmap_remove(keyring->app_keys, L_UINT_TO_PTR(app_idx)));
+	schedule_save(keyring);
 
 	return true;
 }
@@ -346,28 +704,24 @@ bool keyring_del_app_key(struct mesh_node *node, uint16_t app_idx)
 bool keyring_del_remote_dev_key(struct mesh_node *node, uint16_t unicast,
 								uint8_t count)
 {
-	const char *node_path;
-	char key_file[PATH_MAX];
-	int ret, i;
+	struct keyring *keyring;
+	int i;
 
 	if (!IS_UNICAST_RANGE(unicast, count))
 		return false;
 
-	if (!node)
+	keyring = get_keyring(node);
+	if (!keyring)
 		return false;
 
-	node_path = node_get_storage_dir(node);
-
 	for (i = 0; i < count; i++) {
-		ret = snprintf(key_file, PATH_MAX, "%s%s/%4.4x", node_path,
-						dev_key_dir, unicast + i);
-		if (ret < 0)
-			return false;
-
-		l_debug("RM Dev Key %s", key_file);
-		remove(key_file);
+		l_debug("RM Dev Key %4.4x", unicast + i);
+		l_free(l_hashmap_remove(keyring->dev_keys,
+						L_UINT_TO_PTR(unicast + i)));
 	}
 
+	schedule_save(keyring);
+
 	return true;
 }
 
@@ -393,37 +747,6 @@ bool keyring_del_remote_dev_key_all(struct mesh_node *node, uint16_t unicast)
 	return true;
 }
 
-static DIR *open_key_dir(const char *node_path, const char *key_dir_name)
-{
-	char dir_path[PATH_MAX];
-	DIR *key_dir;
-	int ret;
-
-	ret = snprintf(dir_path, PATH_MAX, "%s%s", node_path, key_dir_name);
-	if (ret < 0)
-		return NULL;
-
-	key_dir = opendir(dir_path);
-	if (!key_dir)
-		l_error("Failed to open keyring storage directory: %s",
-								dir_path);
-
-	return key_dir;
-}
-
-static int open_key_dir_entry(int dir_fd, struct dirent *entry,
-							uint8_t fname_len)
-{
-	if (entry->d_type != DT_REG)
-		return -1;
-
-	/* Check the file name length */
-	if (strlen(entry->d_name) != fname_len)
-		return -1;
-
-	return openat(dir_fd, entry->d_name, O_RDONLY);
-}
-
 static void append_old_key(struct l_dbus_message_builder *builder,
 							const uint8_t key[16])
 {
@@ -435,131 +758,111 @@ static void append_old_key(struct l_dbus_message_builder *builder,
 	l_dbus_message_builder_leave_dict(builder);
 }
 
-static void build_app_keys_reply(const char *node_path,
-					struct l_dbus_message_builder *builder,
-					uint16_t net_idx, uint8_t phase)
+struct app_keys_reply {
+	struct l_dbus_message_builder *builder;
+	uint16_t net_idx;
+	uint8_t phase;
+};
+
+static void build_app_key_entry(const void *key, void *value,
+							void *user_data)
 {
-	DIR *key_dir;
-	int key_dir_fd;
-	struct dirent *entry;
+	const struct keyring_app_key *app_key = value;
+	struct app_keys_reply *reply = user_data;
+	struct l_dbus_message_builder *builder = reply->builder;
 
-	key_dir = open_key_dir(node_path, app_key_dir);
-	if (!key_dir)
+	if (app_key->net_idx != reply->net_idx)
 		return;
 
-	key_dir_fd = dirfd(key_dir);
+	l_dbus_message_builder_enter_struct(builder, "qaya{sv}");
+
+	l_dbus_message_builder_append_basic(builder, 'q', &app_key->app_idx);
+	dbus_append_byte_array(builder, app_key->new_key, 16);
+
+	l_dbus_message_builder_enter_array(builder, "{sv}");
+
+	if (reply->phase != KEY_REFRESH_PHASE_NONE)
+		append_old_key(builder, app_key->old_key);
+
+	l_dbus_message_builder_leave_array(builder);
+	l_dbus_message_builder_leave_struct(builder);
+}
+
+static void build_app_keys_reply(struct keyring *keyring,
+					struct l_dbus_message_builder *builder,
+					uint16_t net_idx, uint8_t phase)
+{
+	struct app_keys_reply reply = {
+		.builder = builder,
+		.net_idx = net_idx,
+		.phase = phase,
+	};
 
 	l_dbus_message_builder_enter_dict(builder, "sv");
 	l_dbus_message_builder_append_basic(builder, 's', "AppKeys");
 	l_dbus_message_builder_enter_variant(builder, "a(qaya{sv})");
 	l_dbus_message_builder_enter_array(builder, "(qaya{sv})");
 
-	while ((entry = readdir(key_dir)) != NULL) {
-		struct keyring_app_key key;
-		int fd = open_key_dir_entry(key_dir_fd, entry, 3);
+	l_hashmap_foreach(keyring->app_keys, build_app_key_entry, &reply);
 
-		if (fd < 0)
-			continue;
+	l_dbus_message_builder_leave_array(builder);
+	l_dbus_message_builder_leave_variant(builder);
+	l_dbus_message_builder_leave_dict(builder);
+}
 
-		if (read(fd, &key, sizeof(key)) != sizeof(key) ||
-						key.net_idx != net_idx) {
-			close(fd);
-			continue;
-		}
+struct net_keys_reply {
+	struct keyring *keyring;
+	struct l_dbus_message_builder *builder;
+};
 
-		close(fd);
+static void build_net_key_entry(const void *key, void *value,
+							void *user_data)
+{
+	const struct keyring_net_key *net_key = value;
+	struct net_keys_reply *reply = user_data;
+	struct l_dbus_message_builder *builder = reply->builder;
+	uint8_t phase = net_key->phase;
 
-		l_dbus_message_builder_enter_struct(builder, "qaya{sv}");
+	if (phase == KEY_REFRESH_PHASE_THREE)
+		return;
 
-		l_dbus_message_builder_append_basic(builder, 'q', &key.app_idx);
-		dbus_append_byte_array(builder, key.new_key, 16);
+	l_dbus_message_builder_enter_struct(builder, "qaya{sv}");
 
-		l_dbus_message_builder_enter_array(builder, "{sv}");
+	l_dbus_message_builder_append_basic(builder, 'q', &net_key->net_idx);
+	dbus_append_byte_array(builder, net_key->new_key, 16);
 
-		if (phase != KEY_REFRESH_PHASE_NONE)
-			append_old_key(builder, key.old_key);
+	l_dbus_message_builder_enter_array(builder, "{sv}");
 
-		l_dbus_message_builder_leave_array(builder);
-		l_dbus_message_builder_leave_struct(builder);
+	if (phase != KEY_REFRESH_PHASE_NONE) {
+		dbus_append_dict_entry_basic(builder, "Phase", "y", &phase);
+		append_old_key(builder, net_key->old_key);
 	}
 
-	l_dbus_message_builder_leave_array(builder);
-	l_dbus_message_builder_leave_variant(builder);
-	l_dbus_message_builder_leave_dict(builder);
+	build_app_keys_reply(reply->keyring, builder, net_key->net_idx,
+									phase);
 
-	closedir(key_dir);
+	l_dbus_message_builder_leave_array(builder);
+	l_dbus_message_builder_leave_struct(builder);
 }
 
-static bool build_net_keys_reply(const char *node_path,
+static void build_net_keys_reply(struct keyring *keyring,
 					struct l_dbus_message_builder *builder)
 {
-	DIR *key_dir;
-	int key_dir_fd;
-	struct dirent *entry;
-	bool result = false;
-
-	key_dir = open_key_dir(node_path, net_key_dir);
-	if (!key_dir)
-		return false;
-
-	key_dir_fd = dirfd(key_dir);
+	struct net_keys_reply reply = {
+		.keyring = keyring,
+		.builder = builder,
+	};
 
 	l_dbus_message_builder_enter_dict(builder, "sv");
 	l_dbus_message_builder_append_basic(builder, 's', "NetKeys");
 	l_dbus_message_builder_enter_variant(builder, "a(qaya{sv})");
 	l_dbus_message_builder_enter_array(builder, "(qaya{sv})");
 
-	while ((entry = readdir(key_dir)) != NULL) {
-		struct keyring_net_key key;
-		int fd = open_key_dir_entry(key_dir_fd, entry, 3);
-
-		if (fd < 0)
-			continue;
-
-		if (read(fd, &key, sizeof(key)) != sizeof(key)) {
-			close(fd);
-			goto done;
-		}
-
-		close(fd);
-
-		/*
-		 * If network key is stuck in phase 3, keyring
-		 * write failed and this key info is unreliable.
-		 */
-		if (key.phase == KEY_REFRESH_PHASE_THREE)
-			continue;
-
-		l_dbus_message_builder_enter_struct(builder, "qaya{sv}");
-
-		l_dbus_message_builder_append_basic(builder, 'q', &key.net_idx);
-		dbus_append_byte_array(builder, key.new_key, 16);
-
-		l_dbus_message_builder_enter_array(builder, "{sv}");
-
-		if (key.phase != KEY_REFRESH_PHASE_NONE) {
-			dbus_append_dict_entry_basic(builder, "Phase", "y",
-								&key.phase);
-			append_old_key(builder, key.old_key);
-		}
-
-		build_app_keys_reply(node_path, builder, key.net_idx,
-								key.phase);
-
-		l_dbus_message_builder_leave_array(builder);
-		l_dbus_message_builder_leave_struct(builder);
-	}
+	l_hashmap_foreach(keyring->net_keys, build_net_key_entry, &reply);
 
 	l_dbus_message_builder_leave_array(builder);
 	l_dbus_message_builder_leave_variant(builder);
 	l_dbus_message_builder_leave_dict(builder);
-
-	result = true;
-done:
-	closedir(key_dir);
-
-	return result;
-
 }
 
 struct dev_key_entry {
@@ -575,6 +878,25 @@ static bool match_key_value(const void *a, const void *b)
 	return (memcmp(key->value, value, 16) == 0);
 }
 
+static void collect_dev_key(const void *key, void *value, void *user_data)
+{
+	struct l_queue *keys = user_data;
+	uint16_t unicast = L_PTR_TO_UINT(key);
+	struct dev_key_entry *entry;
+
+	entry = l_queue_find(keys, match_key_value, value);
+	if (entry) {
+		if (entry->unicast > unicast)
+			entry->unicast = unicast;
+		return;
+	}
+
+	entry = l_new(struct dev_key_entry, 1);
+	entry->unicast = unicast;
+	memcpy(entry->value, value, 16);
+	l_queue_push_tail(keys, entry);
+}
+
 static void build_dev_key_entry(void *a, void *b)
 {
 	struct dev_key_entry *key = a;
@@ -586,59 +908,21 @@ static void build_dev_key_entry(void *a, void *b)
 	l_dbus_message_builder_leave_struct(builder);
 }
 
-static bool build_dev_keys_reply(const char *node_path,
+static bool build_dev_keys_reply(struct keyring *keyring,
 					struct l_dbus_message_builder *builder)
 {
-	DIR *key_dir;
-	int key_dir_fd;
-	struct dirent *entry;
 	struct l_queue *keys;
-	bool result = false;
 
-	key_dir = open_key_dir(node_path, dev_key_dir);
 	/*
 	 * There is always at least one device key present for a local node.
-	 * Therefore, return false, if the directory does not exist.
+	 * Therefore, return false, if there is none.
 	 */
-	if (!key_dir)
+	if (l_hashmap_isempty(keyring->dev_keys))
 		return false;
 
-	key_dir_fd = dirfd(key_dir);
-
 	keys = l_queue_new();
 
-	while ((entry = readdir(key_dir)) != NULL) {
-		uint8_t buf[16];
-		uint16_t unicast;
-		struct dev_key_entry *key;
-		int fd = open_key_dir_entry(key_dir_fd, entry, 4);
-
-		if (fd < 0)
-			continue;
-
-		if (read(fd, buf, 16) != 16) {
-			close(fd);
-			goto done;
-		}
-
-		close(fd);
-
-		if (sscanf(entry->d_name, "%04hx", &unicast) != 1)
-			goto done;
-
-		key = l_queue_find(keys, match_key_value, buf);
-
-		if (key) {
-			if (key->unicast > unicast)
-				key->unicast = unicast;
-			continue;
-		}
-
-		key = l_new(struct dev_key_entry, 1);
-		key->unicast = unicast;
-		memcpy(key->value, buf, 16);
-		l_queue_push_tail(keys, key);
-	}
+	l_hashmap_foreach(keyring->dev_keys, collect_dev_key, keys);
 
 	l_dbus_message_builder_enter_dict(builder, "sv");
 	l_dbus_message_builder_append_basic(builder, 's', "DevKeys");
@@ -651,26 +935,21 @@ static bool build_dev_keys_reply(const char *node_path,
 	l_dbus_message_builder_leave_variant(builder);
 	l_dbus_message_builder_leave_dict(builder);
 
-	result = true;
-done:
 	l_queue_destroy(keys, l_free);
-	closedir(key_dir);
 
-	return result;
+	return true;
 }
 
 bool keyring_build_export_keys_reply(struct mesh_node *node,
 					struct l_dbus_message_builder *builder)
 {
-	const char *node_path;
+	struct keyring *keyring;
 
-	if (!node)
+	keyring = get_keyring(node);
+	if (!keyring)
 		return false;
 
-	node_path = node_get_storage_dir(node);
-
-	if (!build_net_keys_reply(node_path, builder))
-		return false;
+	build_net_keys_reply(keyring, builder);
 
-	return build_dev_keys_reply(node_path, builder);
+	return build_dev_keys_reply(keyring, builder);
 }
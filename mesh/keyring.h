@@ -42,3 +42,5 @@ bool keyring_del_remote_dev_key(struct mesh_node *node, uint16_t unicast,
 bool keyring_del_remote_dev_key_all(struct mesh_node *node, uint16_t unicast);
 bool keyring_build_export_keys_reply(struct mesh_node *node,
 					struct l_dbus_message_builder *builder);
+void keyring_release(struct mesh_node *node);
+void keyring_discard(struct mesh_node *node);
@@ -54,7 +54,7 @@ struct scan_req {
 };
 
 static struct l_queue *scans;
-static struct prov_remote_data *prov_pending;
+static struct l_queue *prov_pending;
 static const uint8_t prvb[2] = {MESH_AD_TYPE_BEACON, 0x00};
 
 static bool by_scan(const void *a, const void *b)
@@ -110,31 +110,41 @@ static void scan_cancel(struct l_timeout *timeout, void *user_data)
 	l_free(req);
 }
 
-static void free_pending_add_call(void)
+static bool by_pending(const void *a, const void *b)
 {
-	if (!prov_pending)
+	return a == b;
+}
+
+static bool is_pending(struct prov_remote_data *pending)
+{
+	return l_queue_find(prov_pending, by_pending, pending) != NULL;
+}
+
+static void free_pending_add_call(struct prov_remote_data *pending)
+{
+	if (!l_queue_remove(prov_pending, pending))
 		return;
 
-	if (prov_pending->disc_watch)
-		l_dbus_remove_watch(dbus_get_bus(),
-						prov_pending->disc_watch);
+	if (pending->disc_watch)
+		l_dbus_remove_watch(dbus_get_bus(), pending->disc_watch);
 
-	if (prov_pending->msg)
-		l_dbus_message_unref(prov_pending->msg);
+	if (pending->msg)
+		l_dbus_message_unref(pending->msg);
 
-	l_free(prov_pending);
-	prov_pending = NULL;
+	l_free(pending);
 }
 
 static void prov_disc_cb(struct l_dbus *bus, void *user_data)
 {
-	if (!prov_pending)
+	struct prov_remote_data *pending = user_data;
+
+	if (!is_pending(pending))
 		return;
 
-	initiator_cancel(prov_pending);
-	prov_pending->disc_watch = 0;
+	initiator_cancel(pending);
+	pending->disc_watch = 0;
 
-	free_pending_add_call();
+	free_pending_add_call(pending);
 }
 
 static void append_dict_entry_basic(struct l_dbus_message_builder *builder,
@@ -152,26 +162,27 @@ static void append_dict_entry_basic(struct l_dbus_message_builder *builder,
 	l_dbus_message_builder_leave_dict(builder);
 }
 
-static void send_add_failed(const char *owner, const char *path,
-							uint8_t status)
+static void send_add_failed(struct prov_remote_data *pending, uint8_t status)
 {
 	struct l_dbus *dbus = dbus_get_bus();
 	struct l_dbus_message_builder *builder;
 	struct l_dbus_message *msg;
+	struct mesh_node *node = pending->node;
 
-	msg = l_dbus_message_new_method_call(dbus, owner, path,
+	msg = l_dbus_message_new_method_call(dbus, node_get_owner(node),
+						node_get_app_path(node),
 						MESH_PROVISIONER_INTERFACE,
 						"AddNodeFailed");
 
 	builder = l_dbus_message_builder_new(msg);
-	dbus_append_byte_array(builder, prov_pending->uuid, 16);
+	dbus_append_byte_array(builder, pending->uuid, 16);
 	l_dbus_message_builder_append_basic(builder, 's',
 						mesh_prov_status_str(status));
 	l_dbus_message_builder_finalize(builder);
 	l_dbus_message_builder_destroy(builder);
 	l_dbus_send(dbus, msg);
 
-	free_pending_add_call();
+	free_pending_add_call(pending);
 }
 
 static bool add_cmplt(void *user_data, uint8_t status,
@@ -184,12 +195,11 @@ static bool add_cmplt(void *user_data, uint8_t status,
 	struct l_dbus_message *msg;
 	bool result;
 
-	if (pending != prov_pending)
+	if (!is_pending(pending))
 		return false;
 
 	if (status != PROV_ERR_SUCCESS) {
-		send_add_failed(node_get_owner(node), node_get_app_path(node),
-									status);
+		send_add_failed(pending, status);
 		return false;
 	}
 
@@ -202,8 +212,7 @@ static bool add_cmplt(void *user_data, uint8_t status,
 					info->num_ele, info->device_key);
 
 	if (!result) {
-		send_add_failed(node_get_owner(node), node_get_app_path(node),
-						PROV_ERR_CANT_ASSIGN_ADDR);
+		send_add_failed(pending, PROV_ERR_CANT_ASSIGN_ADDR);
 		return false;
 	}
 
@@ -237,7 +246,7 @@ static bool add_cmplt(void *user_data, uint8_t status,
 
 	l_dbus_send(dbus, msg);
 
-	free_pending_add_call();
+	free_pending_add_call(pending);
 
 	return true;
 }
@@ -248,7 +257,7 @@ static void mgr_prov_data (struct l_dbus_message *reply, void *user_data)
 	uint16_t net_idx;
 	uint16_t primary;
 
-	if (pending != prov_pending)
+	if (!is_pending(pending))
 		return;
 
 	if (l_dbus_message_is_error(reply))
@@ -278,7 +287,7 @@ static bool add_data_get(void *user_data, uint8_t num_ele)
 	const char *app_path;
 	const char *sender;
 
-	if (pending != prov_pending)
+	if (!is_pending(pending))
 		return false;
 
 	dbus = dbus_get_bus();
@@ -310,20 +319,28 @@ static bool add_data_get(void *user_data, uint8_t num_ele)
 
 static void add_start(void *user_data, int err)
 {
+	struct prov_remote_data *pending = user_data;
 	struct l_dbus_message *reply;
 
 	l_debug("Start callback");
 
+	if (!is_pending(pending) || !pending->msg)
+		return;
+
 	if (err == MESH_ERROR_NONE)
-		reply = l_dbus_message_new_method_return(prov_pending->msg);
+		reply = l_dbus_message_new_method_return(pending->msg);
 	else
-		reply = dbus_error(prov_pending->msg, MESH_ERROR_FAILED,
+		reply = dbus_error(pending->msg, MESH_ERROR_FAILED,
 				"Failed to start provisioning initiator");
 
 	l_dbus_send(dbus_get_bus(), reply);
-	l_dbus_message_unref(prov_pending->msg);
+	l_dbus_message_unref(pending->msg);
 
-	prov_pending->msg = NULL;
+	pending->msg = NULL;
+
+	/* The initiator has already dropped a session it failed to start */
+	if (err != MESH_ERROR_NONE)
+		free_pending_add_call(pending);
 }
 
 static struct l_dbus_message *reprovision_call(struct l_dbus *dbus,
@@ -333,6 +350,7 @@ static struct l_dbus_message *reprovision_call(struct l_dbus *dbus,
 	struct mesh_node *node = user_data;
 	struct l_dbus_message_iter options, var;
 	struct l_dbus_message *reply;
+	struct prov_remote_data *pending;
 	struct mesh_net *net = node_get_net(node);
 	const char *key;
 	uint16_t subidx;
@@ -376,33 +394,41 @@ static struct l_dbus_message *reprovision_call(struct l_dbus *dbus,
 	manager_scan_cancel(node);
 
 	/* Invoke Prov Initiator */
-	prov_pending = l_new(struct prov_remote_data, 1);
+	pending = l_new(struct prov_remote_data, 1);
 
-	prov_pending->transport = nppi;
-	prov_pending->node = node;
-	prov_pending->original = server;
-	prov_pending->agent = node_get_agent(node);
+	pending->transport = nppi;
+	pending->node = node;
+	pending->original = server;
+	pending->agent = node_get_agent(node);
 
-	if (!node_is_provisioner(node) || (prov_pending->agent == NULL)) {
+	if (!node_is_provisioner(node) || (pending->agent == NULL)) {
 		reply = dbus_error(msg, MESH_ERROR_NOT_AUTHORIZED,
 							"Missing Interfaces");
 		goto fail;
 	}
 
-	prov_pending->msg = l_dbus_message_ref(msg);
-	initiator_start(prov_pending->transport, server, subidx, NULL, 99, 60,
-					prov_pending->agent, add_start,
+	if (!prov_pending)
+		prov_pending = l_queue_new();
+
+	l_queue_push_tail(prov_pending, pending);
+
+	if (!initiator_start(pending->transport, server, subidx, NULL, 99, 60,
+					pending->agent, add_start,
 					add_data_get, add_cmplt, node,
-					prov_pending);
+					pending)) {
+		l_queue_remove(prov_pending, pending);
+		reply = dbus_error(msg, MESH_ERROR_BUSY, NULL);
+		goto fail;
+	}
 
-	prov_pending->disc_watch = l_dbus_add_disconnect_watch(dbus,
+	pending->msg = l_dbus_message_ref(msg);
+	pending->disc_watch = l_dbus_add_disconnect_watch(dbus,
 						node_get_owner(node),
-						prov_disc_cb, NULL, NULL);
+						prov_disc_cb, pending, NULL);
 
 	return NULL;
 fail:
-	l_free(prov_pending);
-	prov_pending = NULL;
+	l_free(pending);
 	return reply;
 }
 
@@ -413,6 +439,7 @@ static struct l_dbus_message *add_node_call(struct l_dbus *dbus,
 	struct mesh_node *node = user_data;
 	struct l_dbus_message_iter iter_uuid, options, var;
 	struct l_dbus_message *reply;
+	struct prov_remote_data *pending;
 	struct mesh_net *net = node_get_net(node);
 	const char *key;
 	uint8_t *uuid;
@@ -473,39 +500,47 @@ static struct l_dbus_message *add_node_call(struct l_dbus *dbus,
 	manager_scan_cancel(node);
 
 	/* Invoke Prov Initiator */
-	prov_pending = l_new(struct prov_remote_data, 1);
+	pending = l_new(struct prov_remote_data, 1);
 
 	if (n)
-		memcpy(prov_pending->uuid, uuid, 16);
+		memcpy(pending->uuid, uuid, 16);
 	else
 		uuid = NULL;
 
-	prov_pending->transport = PB_ADV;
-	prov_pending->node = node;
-	prov_pending->agent = node_get_agent(node);
+	pending->transport = PB_ADV;
+	pending->node = node;
+	pending->agent = node_get_agent(node);
 
-	if (!node_is_provisioner(node) || (prov_pending->agent == NULL)) {
+	if (!node_is_provisioner(node) || (pending->agent == NULL)) {
 		l_debug("Provisioner: %d", node_is_provisioner(node));
-		l_debug("Agent: %p", prov_pending->agent);
+		l_debug("Agent: %p", pending->agent);
 		reply = dbus_error(msg, MESH_ERROR_NOT_AUTHORIZED,
 							"Missing Interfaces");
 		goto fail;
 	}
 
-	prov_pending->msg = l_dbus_message_ref(msg);
-	initiator_start(PB_ADV, server, subidx, uuid, 99, sec,
-					prov_pending->agent, add_start,
+	if (!prov_pending)
+		prov_pending = l_queue_new();
+
+	l_queue_push_tail(prov_pending, pending);
+
+	if (!initiator_start(PB_ADV, server, subidx, uuid, 99, sec,
+					pending->agent, add_start,
 					add_data_get, add_cmplt, node,
-					prov_pending);
+					pending)) {
+		l_queue_remove(prov_pending, pending);
+		reply = dbus_error(msg, MESH_ERROR_BUSY, NULL);
+		goto fail;
+	}
 
-	prov_pending->disc_watch = l_dbus_add_disconnect_watch(dbus,
+	pending->msg = l_dbus_message_ref(msg);
+	pending->disc_watch = l_dbus_add_disconnect_watch(dbus,
 						node_get_owner(node),
-						prov_disc_cb, NULL, NULL);
+						prov_disc_cb, pending, NULL);
 
 	return NULL;
 fail:
-	l_free(prov_pending);
-	prov_pending = NULL;
+	l_free(pending);
 	return reply;
 }
 
@@ -13,6 +13,7 @@
 #endif
 
 #include <errno.h>
+#include <inttypes.h>
 #include <string.h>
 #include <sys/time.h>
 #include <ell/ell.h>
@@ -35,6 +36,7 @@ struct mesh_io_private {
 	struct l_timeout *tx_timeout;
 	struct l_queue *tx_pkts;
 	struct tx_pkt *tx;
+	unsigned int tx_seqs;
 	uint16_t interval;
 	bool sending;
 	bool active;
@@ -421,6 +423,16 @@ static bool dev_init(struct mesh_io *io, void *opts, void *user_data)
 	return true;
 }
 
+static void print_cmd_stats(const struct bt_hci_cmd_stats *stats,
+							void *user_data)
+{
+	l_debug("HCI command 0x%04x: %u sent, round trip avg %" PRIu64
+			" us min %" PRIu64 " us max %" PRIu64 " us",
+			stats->opcode, stats->count,
+			stats->total_us / stats->count, stats->min_us,
+			stats->max_us);
+}
+
 static bool dev_destroy(struct mesh_io *io)
 {
 	struct mesh_io_private *pvt = io->pvt;
@@ -428,6 +440,7 @@ static bool dev_destroy(struct mesh_io *io)
 	if (!pvt)
 		return true;
 
+	bt_hci_foreach_cmd_stats(pvt->hci, print_cmd_stats, NULL);
 	bt_hci_unref(pvt->hci);
 	l_timeout_remove(pvt->tx_timeout);
 	l_queue_remove_if(pvt->tx_pkts, simple_match, pvt->tx);
@@ -488,45 +501,13 @@ static void send_cancel(struct mesh_io_private *pvt)
 				send_cancel_done, pvt, NULL);
 }
 
-static void set_send_adv_enable(const void *buf, uint8_t size,
-							void *user_data)
+static void tx_release(struct mesh_io_private *pvt)
 {
-	struct mesh_io_private *pvt = user_data;
-	struct bt_hci_cmd_le_set_adv_enable cmd;
-
-	if (!pvt)
-		return;
+	struct tx_pkt *tx = pvt->tx;
 
-	pvt->sending = true;
-	cmd.enable = 0x01;	/* Enable advertising */
-	bt_hci_send(pvt->hci, BT_HCI_CMD_LE_SET_ADV_ENABLE,
-				&cmd, sizeof(cmd), NULL, NULL, NULL);
-}
-
-static void set_send_adv_data(const void *buf, uint8_t size,
-							void *user_data)
-{
-	struct mesh_io_private *pvt = user_data;
-	struct tx_pkt *tx;
-	struct bt_hci_cmd_le_set_adv_data cmd;
-
-	if (!pvt || !pvt->tx)
+	if (!tx)
 		return;
 
-	tx = pvt->tx;
-	if (tx->len >= sizeof(cmd.data))
-		goto done;
-
-	memset(&cmd, 0, sizeof(cmd));
-
-	cmd.len = tx->len + 1;
-	cmd.data[0] = tx->len;
-	memcpy(cmd.data + 1, tx->pkt, tx->len);
-
-	bt_hci_send(pvt->hci, BT_HCI_CMD_LE_SET_ADV_DATA,
-					&cmd, sizeof(cmd),
-					set_send_adv_enable, pvt, NULL);
-done:
 	if (tx->delete) {
 		l_queue_remove_if(pvt->tx_pkts, simple_match, tx);
 		l_free(tx);
@@ -535,35 +516,29 @@ done:
 	pvt->tx = NULL;
 }
 
-static void set_send_adv_params(const void *buf, uint8_t size,
-							void *user_data)
+static void send_pkt_done(uint16_t opcode, uint8_t status, void *user_data)
 {
 	struct mesh_io_private *pvt = user_data;
-	struct bt_hci_cmd_le_set_adv_parameters cmd;
-	uint16_t hci_interval;
 
-	if (!pvt)
+	if (status)
+		l_debug("HCI command 0x%04x failed: 0x%02x", opcode, status);
+
+	/* Wait for the sequence carrying the most recent packet */
+	if (--pvt->tx_seqs)
 		return;
 
-	hci_interval = (pvt->interval * 16) / 10;
-	cmd.min_interval = L_CPU_TO_LE16(hci_interval);
-	cmd.max_interval = L_CPU_TO_LE16(hci_interval);
-	cmd.type = 0x03; /* ADV_NONCONN_IND */
-	cmd.own_addr_type = 0x01; /* ADDR_TYPE_RANDOM */
-	cmd.direct_addr_type = 0x00;
-	memset(cmd.direct_addr, 0, 6);
-	cmd.channel_map = 0x07;
-	cmd.filter_policy = 0x03;
-
-	bt_hci_send(pvt->hci, BT_HCI_CMD_LE_SET_ADV_PARAMETERS,
-				&cmd, sizeof(cmd),
-				set_send_adv_data, pvt, NULL);
+	tx_release(pvt);
 }
 
 static void send_pkt(struct mesh_io_private *pvt, struct tx_pkt *tx,
 							uint16_t interval)
 {
-	struct bt_hci_cmd_le_set_adv_enable cmd;
+	struct bt_hci_cmd_le_set_adv_enable disable, enable;
+	struct bt_hci_cmd_le_set_adv_parameters params;
+	struct bt_hci_cmd_le_set_adv_data data;
+	struct bt_hci_seq_cmd cmds[4];
+	unsigned int num_cmds = 0;
+	uint16_t hci_interval;
 
 	/* Delete superseded packet in favor of new packet */
 	if (pvt->tx && pvt->tx != tx && pvt->tx->delete) {
@@ -574,15 +549,56 @@ static void send_pkt(struct mesh_io_private *pvt, struct tx_pkt *tx,
 	pvt->tx = tx;
 	pvt->interval = interval;
 
-	if (!pvt->sending) {
-		set_send_adv_params(NULL, 0, pvt);
+	if (tx->len >= sizeof(data.data)) {
+		if (!pvt->tx_seqs)
+			tx_release(pvt);
+
 		return;
 	}
 
-	cmd.enable = 0x00;	/* Disable advertising */
-	bt_hci_send(pvt->hci, BT_HCI_CMD_LE_SET_ADV_ENABLE,
-				&cmd, sizeof(cmd),
-				set_send_adv_params, pvt, NULL);
+	/*
+	 * Submit the whole chain at once so that the commands are pipelined
+	 * instead of waiting a round trip for each of them.
+	 */
+	if (pvt->sending) {
+		disable.enable = 0x00;	/* Disable advertising */
+		cmds[num_cmds].opcode = BT_HCI_CMD_LE_SET_ADV_ENABLE;
+		cmds[num_cmds].data = &disable;
+		cmds[num_cmds++].size = sizeof(disable);
+	}
+
+	hci_interval = (pvt->interval * 16) / 10;
+	params.min_interval = L_CPU_TO_LE16(hci_interval);
+	params.max_interval = L_CPU_TO_LE16(hci_interval);
+	params.type = 0x03; /* ADV_NONCONN_IND */
+	params.own_addr_type = 0x01; /* ADDR_TYPE_RANDOM */
+	params.direct_addr_type = 0x00;
+	memset(params.direct_addr, 0, 6);
+	params.channel_map = 0x07;
+	params.filter_policy = 0x03;
+	cmds[num_cmds].opcode = BT_HCI_CMD_LE_SET_ADV_PARAMETERS;
+	cmds[num_cmds].data = &params;
+	cmds[num_cmds++].size = sizeof(params);
+
+	memset(&data, 0, sizeof(data));
+	data.len = tx->len + 1;
+	data.data[0] = tx->len;
+	memcpy(data.data + 1, tx->pkt, tx->len);
+	cmds[num_cmds].opcode = BT_HCI_CMD_LE_SET_ADV_DATA;
+	cmds[num_cmds].data = &data;
+	cmds[num_cmds++].size = sizeof(data);
+
+	enable.enable = 0x01;	/* Enable advertising */
+	cmds[num_cmds].opcode = BT_HCI_CMD_LE_SET_ADV_ENABLE;
+	cmds[num_cmds].data = &enable;
+	cmds[num_cmds++].size = sizeof(enable);
+
+	if (!bt_hci_send_seq(pvt->hci, cmds, num_cmds, send_pkt_done, pvt,
+									NULL))
+		return;
+
+	pvt->tx_seqs++;
+	pvt->sending = true;
 }
 
 static void tx_to(struct l_timeout *timeout, void *user_data)
@@ -34,6 +34,7 @@
 #define DEFAULT_PROV_TIMEOUT 60
 #define DEFAULT_CRPL 100
 #define DEFAULT_FRIEND_QUEUE_SZ 32
+#define DEFAULT_PROV_SESSIONS 1
 
 #define DEFAULT_ALGORITHMS 0x0001
 
@@ -57,6 +58,7 @@ struct bt_mesh {
 	uint16_t algorithms;
 	uint16_t req_index;
 	uint8_t friend_queue_sz;
+	uint8_t prov_sessions;
 	uint8_t max_filters;
 	bool initialized;
 };
@@ -84,6 +86,7 @@ static struct bt_mesh mesh = {
 	.proxy_support = false,
 	.crpl = DEFAULT_CRPL,
 	.friend_queue_sz = DEFAULT_FRIEND_QUEUE_SZ,
+	.prov_sessions = DEFAULT_PROV_SESSIONS,
 	.initialized = false
 };
 
@@ -203,6 +206,11 @@ uint8_t mesh_get_friend_queue_size(void)
 	return mesh.friend_queue_sz;
 }
 
+uint8_t mesh_get_prov_sessions(void)
+{
+	return mesh.prov_sessions;
+}
+
 static void parse_settings(const char *mesh_conf_fname)
 {
 	struct l_settings *settings;
@@ -245,6 +253,10 @@ static void parse_settings(const char *mesh_conf_fname)
 	if (l_settings_get_uint(settings, "General", "ProvTimeout", &value))
 		mesh.prov_timeout = value;
 
+	if (l_settings_get_uint(settings, "General", "ProvSessions", &value)
+						&& value && value <= 16)
+		mesh.prov_sessions = value;
+
 done:
 	l_settings_free(settings);
 }
@@ -794,8 +794,9 @@ static int add_sub(struct mesh_net *net, struct mesh_model *mod,
 }
 
 static void send_dev_key_msg_rcvd(struct mesh_node *node, uint8_t ele_idx,
-					uint16_t src, uint16_t app_idx,
-					uint16_t net_idx, uint16_t size,
+					uint16_t src, uint16_t dst,
+					uint16_t app_idx, uint16_t net_idx,
+					uint8_t ttl, uint16_t size,
 					const uint8_t *data)
 {
 	struct l_dbus *dbus = dbus_get_bus();
@@ -805,6 +806,11 @@ static void send_dev_key_msg_rcvd(struct mesh_node *node, uint8_t ele_idx,
 	const char *path;
 	bool remote = (app_idx != APP_IDX_DEV_LOCAL);
 
+	/* Prefer the application's message socket, if it acquired one */
+	if (node_msg_sock_rcvd(node, ele_idx, src, dst, NULL, app_idx,
+						net_idx, ttl, size, data))
+		return;
+
 	owner = node_get_owner(node);
 	path = node_get_element_path(node, ele_idx);
 	if (!path || !owner)
@@ -832,8 +838,9 @@ static void send_dev_key_msg_rcvd(struct mesh_node *node, uint8_t ele_idx,
 static void send_msg_rcvd(struct mesh_node *node, uint8_t ele_idx,
 					uint16_t src, uint16_t dst,
 					const struct mesh_virtual *virt,
-					uint16_t app_idx,
-					uint16_t size, const uint8_t *data)
+					uint16_t app_idx, uint16_t net_idx,
+					uint8_t ttl, uint16_t size,
+					const uint8_t *data)
 {
 	struct l_dbus *dbus = dbus_get_bus();
 	struct l_dbus_message *msg;
@@ -841,6 +848,11 @@ static void send_msg_rcvd(struct mesh_node *node, uint8_t ele_idx,
 	const char *owner;
 	const char *path;
 
+	if (node_msg_sock_rcvd(node, ele_idx, src, dst,
+					virt ? virt->label : NULL, app_idx,
+					net_idx, ttl, size, data))
+		return;
+
 	owner = node_get_owner(node);
 	path = node_get_element_path(node, ele_idx);
 	if (!path || !owner)
@@ -875,9 +887,9 @@ static void send_msg_rcvd(struct mesh_node *node, uint8_t ele_idx,
 }
 
 bool mesh_model_rx(struct mesh_node *node, bool szmict, uint32_t seq0,
-			uint32_t iv_index, uint16_t net_idx, uint16_t src,
-			uint16_t dst, uint8_t key_aid, const uint8_t *data,
-								uint16_t size)
+			uint32_t iv_index, uint16_t net_idx, uint8_t ttl,
+			uint16_t src, uint16_t dst, uint8_t key_aid,
+			const uint8_t *data, uint16_t size)
 {
 	uint8_t *clear_text;
 	struct mod_forward forward = {
@@ -967,13 +979,13 @@ bool mesh_model_rx(struct mesh_node *node, bool szmict, uint32_t seq0,
 		if (forward.has_dst && !forward.done) {
 			if ((decrypt_idx & APP_IDX_MASK) == decrypt_idx)
 				send_msg_rcvd(node, i, src, dst, decrypt_virt,
-						forward.app_idx, forward.size,
-						forward.data);
+						forward.app_idx, net_idx, ttl,
+						forward.size, forward.data);
 			else if (decrypt_idx == APP_IDX_DEV_REMOTE ||
 				 decrypt_idx == APP_IDX_DEV_LOCAL)
-				send_dev_key_msg_rcvd(node, i, src, decrypt_idx,
-							net_idx, forward.size,
-								forward.data);
+				send_dev_key_msg_rcvd(node, i, src, dst,
+						decrypt_idx, net_idx, ttl,
+						forward.size, forward.data);
 		}
 
 		/*
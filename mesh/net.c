@@ -1795,8 +1795,8 @@ not_for_friend:
 	if (msg_check_replay_cache(net, src, crpl, seq, iv_index))
 		return false;
 
-	if (!mesh_model_rx(net->node, szmic, seqAuth, iv_index, net_idx, src,
-						dst, key_aid, data, size))
+	if (!mesh_model_rx(net->node, szmic, seqAuth, iv_index, net_idx, ttl,
+					src, dst, key_aid, data, size))
 		return false;
 
 	/* If message has been handled by us, add to RPL */
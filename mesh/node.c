@@ -16,6 +16,9 @@
 #include <dirent.h>
 #include <limits.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
 #include <sys/time.h>
 
 #include <ell/ell.h>
@@ -50,6 +53,18 @@
 /* Default element location: unknown */
 #define DEFAULT_LOCATION 0x0000
 
+/* Framed message socket, see AcquireMessageSocket in doc/mesh-api.txt */
+#define MSG_SOCK_MTU		4096
+#define MSG_SOCK_HDR_LEN	12
+#define MSG_SOCK_MAX_PENDING	32
+
+#define MSG_SOCK_TYPE_APP	0x00
+#define MSG_SOCK_TYPE_DEV	0x01
+
+#define MSG_SOCK_FLAG_REMOTE	0x01
+#define MSG_SOCK_FLAG_VIRTUAL	0x02
+#define MSG_SOCK_FLAG_SEGMENTED	0x04
+
 enum request_type {
 	REQUEST_TYPE_JOIN,
 	REQUEST_TYPE_ATTACH,
@@ -64,6 +79,19 @@ struct node_element {
 	uint8_t idx;
 };
 
+struct msg_sock_pkt {
+	uint16_t len;
+	uint8_t data[MSG_SOCK_MTU];
+};
+
+struct msg_sock {
+	struct l_io *io;
+	struct l_idle *flush;
+	struct msg_sock_pkt *cur;
+	struct l_queue *pending;
+	uint32_t dropped;
+};
+
 struct node_composition {
 	uint16_t cid;
 	uint16_t pid;
@@ -79,6 +107,7 @@ struct mesh_node {
 	char *owner;
 	char *obj_path;
 	struct mesh_agent *agent;
+	struct msg_sock *msg_sock;
 	struct mesh_config *cfg;
 	char *storage_dir;
 	uint32_t disc_watch;
@@ -252,11 +281,31 @@ static void element_free(void *data)
 	l_free(element);
 }
 
+static void release_msg_sock(struct mesh_node *node)
+{
+	struct msg_sock *sock = node->msg_sock;
+
+	if (!sock)
+		return;
+
+	l_debug("Release message socket (dropped %u)", sock->dropped);
+
+	node->msg_sock = NULL;
+
+	l_idle_remove(sock->flush);
+	l_io_destroy(sock->io);
+	l_queue_destroy(sock->pending, l_free);
+	l_free(sock->cur);
+	l_free(sock);
+}
+
 static void free_node_dbus_resources(struct mesh_node *node)
 {
 	if (!node)
 		return;
 
+	release_msg_sock(node);
+
 	if (node->disc_watch) {
 		l_dbus_remove_watch(dbus_get_bus(), node->disc_watch);
 		node->disc_watch = 0;
@@ -300,6 +349,7 @@ static void free_node_resources(void *data)
 	l_queue_destroy(node->elements, element_free);
 	l_queue_destroy(node->pages, l_free);
 	mesh_agent_remove(node->agent);
+	keyring_release(node);
 	mesh_config_release(node->cfg);
 	mesh_net_free(node->net);
 	l_free(node->storage_dir);
@@ -317,6 +367,8 @@ void node_remove(struct mesh_node *node)
 
 	l_queue_remove(nodes, node);
 
+	/* The storage goes away, so pending keyring changes are moot */
+	keyring_discard(node);
 	mesh_config_destroy_nvm(node->cfg);
 
 	free_node_resources(node);
@@ -2114,6 +2166,261 @@ static struct l_dbus_message *dev_key_send_call(struct l_dbus *dbus,
 	return l_dbus_message_new_method_return(msg);
 }
 
+static bool msg_sock_write(struct msg_sock *sock)
+{
+	int fd = l_io_get_fd(sock->io);
+	struct msg_sock_pkt *pkt;
+
+	while ((pkt = l_queue_peek_head(sock->pending))) {
+		if (send(fd, pkt->data, pkt->len,
+					MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return false;
+
+			l_error("Message socket write failed: %s",
+							strerror(errno));
+			sock->dropped++;
+		}
+
+		l_free(l_queue_pop_head(sock->pending));
+	}
+
+	return true;
+}
+
+static bool msg_sock_can_write(struct l_io *io, void *user_data)
+{
+	struct msg_sock *sock = user_data;
+
+	/* Stay armed until the backlog has been drained */
+	return !msg_sock_write(sock);
+}
+
+static void msg_sock_flush(struct msg_sock *sock)
+{
+	l_idle_remove(sock->flush);
+	sock->flush = NULL;
+
+	if (sock->cur) {
+		if (l_queue_length(sock->pending) < MSG_SOCK_MAX_PENDING)
+			l_queue_push_tail(sock->pending, sock->cur);
+		else {
+			sock->dropped++;
+			l_free(sock->cur);
+		}
+
+		sock->cur = NULL;
+	}
+
+	if (!msg_sock_write(sock))
+		l_io_set_write_handler(sock->io, msg_sock_can_write, sock,
+									NULL);
+}
+
+static void msg_sock_flush_idle(struct l_idle *idle, void *user_data)
+{
+	msg_sock_flush(user_data);
+}
+
+bool node_msg_sock_rcvd(struct mesh_node *node, uint8_t ele_idx,
+					uint16_t src, uint16_t dst,
+					const uint8_t *label, uint16_t app_idx,
+					uint16_t net_idx, uint8_t ttl,
+					uint16_t size, const uint8_t *data)
+{
+	struct msg_sock *sock = node->msg_sock;
+	size_t len = MSG_SOCK_HDR_LEN + (label ? 16 : 0) + size;
+	uint16_t key_idx = app_idx;
+	uint8_t type = MSG_SOCK_TYPE_APP;
+	uint8_t flags = 0;
+	uint8_t *frame;
+
+	if (!sock || len > MSG_SOCK_MTU)
+		return false;
+
+	if (app_idx == APP_IDX_DEV_LOCAL || app_idx == APP_IDX_DEV_REMOTE) {
+		type = MSG_SOCK_TYPE_DEV;
+		key_idx = net_idx;
+
+		if (app_idx == APP_IDX_DEV_REMOTE)
+			flags |= MSG_SOCK_FLAG_REMOTE;
+	}
+
+	if (label)
+		flags |= MSG_SOCK_FLAG_VIRTUAL;
+
+	/* Frames are batched until idle or until the packet is full */
+	if (sock->cur && sock->cur->len + len > MSG_SOCK_MTU)
+		msg_sock_flush(sock);
+
+	if (!sock->cur)
+		sock->cur = l_new(struct msg_sock_pkt, 1);
+
+	frame = sock->cur->data + sock->cur->len;
+	frame[0] = type;
+	frame[1] = ele_idx;
+	l_put_le16(src, frame + 2);
+	l_put_le16(dst, frame + 4);
+	l_put_le16(key_idx, frame + 6);
+	frame[8] = ttl;
+	frame[9] = flags;
+	l_put_le16(size, frame + 10);
+	frame += MSG_SOCK_HDR_LEN;
+
+	if (label) {
+		memcpy(frame, label, 16);
+		frame += 16;
+	}
+
+	memcpy(frame, data, size);
+	sock->cur->len += len;
+
+	if (!sock->flush)
+		sock->flush = l_idle_create(msg_sock_flush_idle, sock, NULL);
+
+	return true;
+}
+
+static bool msg_sock_send(struct mesh_node *node, const uint8_t *frame,
+					uint16_t size, const uint8_t *data)
+{
+	uint8_t ele_idx = frame[1];
+	uint16_t dst = l_get_le16(frame + 4);
+	uint16_t key_idx = l_get_le16(frame + 6);
+	uint8_t ttl = frame[8];
+	uint8_t flags = frame[9];
+	uint16_t app_idx, net_idx, src;
+	bool remote;
+
+	if (ele_idx >= node->num_ele || !size || size > MAX_MSG_LEN)
+		return false;
+
+	if (ttl != DEFAULT_TTL && ttl > TTL_MASK)
+		return false;
+
+	switch (frame[0]) {
+	case MSG_SOCK_TYPE_APP:
+		if (key_idx & ~APP_IDX_MASK)
+			return false;
+
+		app_idx = key_idx;
+		net_idx = appkey_net_idx(node->net, app_idx);
+		if (net_idx == NET_IDX_INVALID)
+			return false;
+
+		break;
+
+	case MSG_SOCK_TYPE_DEV:
+		remote = !!(flags & MSG_SOCK_FLAG_REMOTE);
+
+		/* Loopbacks to local servers must use *remote* addressing */
+		if (!remote && mesh_net_is_local_address(node->net, dst, 1))
+			return false;
+
+		app_idx = remote ? APP_IDX_DEV_REMOTE : APP_IDX_DEV_LOCAL;
+		net_idx = key_idx;
+		break;
+
+	default:
+		return false;
+	}
+
+	src = node_get_primary(node) + ele_idx;
+
+	return mesh_model_send(node, src, dst, app_idx, net_idx, ttl,
+					!!(flags & MSG_SOCK_FLAG_SEGMENTED),
+					size, data);
+}
+
+static bool msg_sock_read(struct l_io *io, void *user_data)
+{
+	struct mesh_node *node = user_data;
+	uint8_t buf[MSG_SOCK_MTU];
+	const uint8_t *frame = buf;
+	ssize_t len;
+	uint16_t size;
+
+	len = recv(l_io_get_fd(io), buf, sizeof(buf), MSG_DONTWAIT);
+	if (len <= 0)
+		return true;
+
+	/* A single packet may carry several frames back to back */
+	while (len >= MSG_SOCK_HDR_LEN) {
+		size = l_get_le16(frame + 10);
+
+		/* Without a usable length the next frame cannot be found */
+		if (size > len - MSG_SOCK_HDR_LEN) {
+			l_error("Truncated message socket frame");
+			break;
+		}
+
+		if (frame[9] & MSG_SOCK_FLAG_VIRTUAL)
+			l_debug("Virtual label in socket frame to %4.4x",
+						l_get_le16(frame + 4));
+		else if (!msg_sock_send(node, frame, size,
+						frame + MSG_SOCK_HDR_LEN))
+			l_debug("Failed to send socket frame to %4.4x",
+						l_get_le16(frame + 4));
+
+		frame += MSG_SOCK_HDR_LEN + size;
+		len -= MSG_SOCK_HDR_LEN + size;
+	}
+
+	return true;
+}
+
+static void msg_sock_disconnect(struct l_io *io, void *user_data)
+{
+	struct mesh_node *node = user_data;
+
+	l_debug("Message socket closed by application");
+
+	release_msg_sock(node);
+}
+
+static struct l_dbus_message *acquire_msg_sock_call(struct l_dbus *dbus,
+						struct l_dbus_message *msg,
+						void *user_data)
+{
+	struct mesh_node *node = user_data;
+	struct l_dbus_message *reply;
+	struct msg_sock *sock;
+	const char *sender;
+	int fds[2];
+
+	l_debug("AcquireMessageSocket");
+
+	sender = l_dbus_message_get_sender(msg);
+
+	if (strcmp(sender, node->owner))
+		return dbus_error(msg, MESH_ERROR_NOT_AUTHORIZED, NULL);
+
+	if (node->msg_sock)
+		return dbus_error(msg, MESH_ERROR_ALREADY_EXISTS, NULL);
+
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC,
+								0, fds) < 0)
+		return dbus_error(msg, MESH_ERROR_FAILED,
+						"Unable to create socket");
+
+	sock = l_new(struct msg_sock, 1);
+	sock->pending = l_queue_new();
+	sock->io = l_io_new(fds[0]);
+	l_io_set_close_on_destroy(sock->io, true);
+	l_io_set_read_handler(sock->io, msg_sock_read, node, NULL);
+	l_io_set_disconnect_handler(sock->io, msg_sock_disconnect, node, NULL);
+
+	node->msg_sock = sock;
+
+	reply = l_dbus_message_new_method_return(msg);
+	l_dbus_message_set_arguments(reply, "h", fds[1]);
+
+	/* The message holds its own duplicate of the descriptor */
+	close(fds[1]);
+
+	return reply;
+}
+
 static struct l_dbus_message *add_netkey_call(struct l_dbus *dbus,
 						struct l_dbus_message *msg,
 						void *user_data)
@@ -2429,6 +2736,8 @@ static void setup_node_interface(struct l_dbus_interface *iface)
 						"oqbqa{sv}ay", "element_path",
 						"destination", "remote",
 						"net_index", "options", "data");
+	l_dbus_interface_method(iface, "AcquireMessageSocket", 0,
+					acquire_msg_sock_call, "h", "", "fd");
 	l_dbus_interface_method(iface, "AddNetKey", 0, add_netkey_call, "",
 					"oqqqb", "element_path", "destination",
 					"subnet_index", "net_index", "update");
@@ -112,22 +112,50 @@ struct scan_req {
 	int count;
 };
 
-static struct mesh_prov_initiator *prov = NULL;
+struct prov_server {
+	struct mesh_node *node;
+	uint16_t addr;
+};
+
+static struct l_queue *provs;
 static struct l_queue *scans;
 
-static void initiator_free(void)
+static bool match_prov(const void *a, const void *b)
 {
-	if (prov) {
-		l_timeout_remove(prov->timeout);
+	return a == b;
+}
 
-		if (!prov->server)
-			mesh_send_cancel(&pkt_filter, sizeof(pkt_filter));
-	}
+static bool match_caller(const void *a, const void *b)
+{
+	const struct mesh_prov_initiator *prov = a;
+
+	return prov->caller_data == b;
+}
+
+static bool match_server(const void *a, const void *b)
+{
+	const struct mesh_prov_initiator *prov = a;
+	const struct prov_server *server = b;
+
+	return prov->node == server->node && prov->server == server->addr;
+}
+
+static bool valid_prov(struct mesh_prov_initiator *prov)
+{
+	return l_queue_find(provs, match_prov, prov) != NULL;
+}
+
+static void initiator_free(struct mesh_prov_initiator *prov)
+{
+	l_queue_remove(provs, prov);
+	l_timeout_remove(prov->timeout);
+
+	if (!prov->server)
+		mesh_send_cancel(&pkt_filter, sizeof(pkt_filter));
 
 	pb_adv_unreg(prov);
 
 	l_free(prov);
-	prov = NULL;
 }
 
 static void int_prov_close(void *user_data, uint8_t reason)
@@ -146,7 +174,7 @@ static void int_prov_close(void *user_data, uint8_t reason)
 
 	if (reason != PROV_ERR_SUCCESS) {
 		prov->complete_cb(prov->caller_data, reason, NULL);
-		initiator_free();
+		initiator_free(prov);
 		return;
 	}
 
@@ -156,7 +184,7 @@ static void int_prov_close(void *user_data, uint8_t reason)
 	info.num_ele = prov->conf_inputs.caps.num_ele;
 
 	prov->complete_cb(prov->caller_data, PROV_ERR_SUCCESS, &info);
-	initiator_free();
+	initiator_free(prov);
 }
 
 static void swap_u256_bytes(uint8_t *u256)
@@ -174,11 +202,10 @@ static void swap_u256_bytes(uint8_t *u256)
 static void int_prov_open(void *user_data, prov_trans_tx_t trans_tx,
 				void *trans_data, uint8_t transport)
 {
-	struct mesh_prov_initiator *rx_prov = user_data;
+	struct mesh_prov_initiator *prov = user_data;
 	struct prov_invite_msg msg = { PROV_INVITE, { 30 }};
 
-	/* Only one provisioning session may be open at a time */
-	if (rx_prov != prov)
+	if (!valid_prov(prov))
 		return;
 
 	/* Only one provisioning session may be open at a time */
@@ -285,7 +312,8 @@ static uint32_t digit_mod(uint8_t power)
 	return ret;
 }
 
-static void calc_local_material(const uint8_t *random)
+static void calc_local_material(struct mesh_prov_initiator *prov,
+							const uint8_t *random)
 {
 	/* Calculate SessionKey while the data is fresh */
 	mesh_crypto_prov_prov_salt(prov->salt,
@@ -314,10 +342,10 @@ static void send_confirm(struct mesh_prov_initiator *prov)
 
 static void number_cb(void *user_data, int err, uint32_t number)
 {
-	struct mesh_prov_initiator *rx_prov = user_data;
+	struct mesh_prov_initiator *prov = user_data;
 	struct prov_fail_msg msg;
 
-	if (prov != rx_prov)
+	if (!valid_prov(prov))
 		return;
 
 	if (err) {
@@ -336,10 +364,10 @@ static void number_cb(void *user_data, int err, uint32_t number)
 
 static void static_cb(void *user_data, int err, uint8_t *key, uint32_t len)
 {
-	struct mesh_prov_initiator *rx_prov = user_data;
+	struct mesh_prov_initiator *prov = user_data;
 	struct prov_fail_msg msg;
 
-	if (prov != rx_prov)
+	if (!valid_prov(prov))
 		return;
 
 	if (err || !key || len != 16) {
@@ -367,11 +395,11 @@ static void send_pub_key(struct mesh_prov_initiator *prov)
 
 static void pub_key_cb(void *user_data, int err, uint8_t *key, uint32_t len)
 {
-	struct mesh_prov_initiator *rx_prov = user_data;
+	struct mesh_prov_initiator *prov = user_data;
 	struct prov_fail_msg msg;
 	uint8_t fail_code[2];
 
-	if (prov != rx_prov)
+	if (!valid_prov(prov))
 		return;
 
 	if (err || !key || len != 64) {
@@ -410,6 +438,7 @@ static void send_random(struct mesh_prov_initiator *prov)
 
 void initiator_prov_data(uint16_t net_idx, uint16_t primary, void *caller_data)
 {
+	struct mesh_prov_initiator *prov;
 	struct prov_data_msg prov_data;
 	struct prov_fail_msg prov_fail;
 	struct keyring_net_key key;
@@ -417,7 +446,8 @@ void initiator_prov_data(uint16_t net_idx, uint16_t primary, void *caller_data)
 	uint32_t iv_index;
 	uint8_t snb_flags;
 
-	if (!prov || caller_data != prov->caller_data)
+	prov = l_queue_find(provs, match_caller, caller_data);
+	if (!prov)
 		return;
 
 	if (prov->state != INT_PROV_RAND_ACKED)
@@ -525,7 +555,7 @@ static void get_random_key(struct mesh_prov_initiator *prov, uint8_t action,
 	l_put_be32(oob_key, prov->rand_auth_workspace + 44);
 }
 
-static void int_prov_auth(void)
+static void int_prov_auth(struct mesh_prov_initiator *prov)
 {
 	uint8_t fail_code[2];
 	uint32_t oob_key;
@@ -652,13 +682,13 @@ static void int_prov_start_auth(const struct mesh_agent_prov_caps *prov_caps,
 
 static void int_prov_rx(void *user_data, const void *dptr, uint16_t len)
 {
-	struct mesh_prov_initiator *rx_prov = user_data;
+	struct mesh_prov_initiator *prov = user_data;
 	const uint8_t *data = dptr;
 	uint8_t *out;
 	uint8_t type = *data++;
 	uint8_t fail_code[2];
 
-	if (rx_prov != prov || !prov->trans_tx)
+	if (!valid_prov(prov) || !prov->trans_tx)
 		return;
 
 	l_debug("Provisioning packet received type: %2.2x (%u octets)",
@@ -749,7 +779,7 @@ static void int_prov_rx(void *user_data, const void *dptr, uint16_t len)
 			goto failure;
 		}
 
-		int_prov_auth();
+		int_prov_auth(prov);
 		break;
 
 	case PROV_INP_CMPLT: /* Provisioning Input Complete */
@@ -783,7 +813,7 @@ static void int_prov_rx(void *user_data, const void *dptr, uint16_t len)
 		}
 
 		/* RXed Device Confirmation */
-		calc_local_material(data);
+		calc_local_material(prov, data);
 		memcpy(prov->rand_auth_workspace + 16, data, 16);
 		print_packet("RandomDevice", data, 16);
 
@@ -829,7 +859,8 @@ static void int_prov_rx(void *user_data, const void *dptr, uint16_t len)
 		goto failure;
 	}
 
-	if (prov)
+	/* The session is gone if the PDU completed or failed it */
+	if (valid_prov(prov))
 		prov->previous = type;
 
 	return;
@@ -843,9 +874,9 @@ failure:
 
 static void int_prov_ack(void *user_data, uint8_t msg_num)
 {
-	struct mesh_prov_initiator *rx_prov = user_data;
+	struct mesh_prov_initiator *prov = user_data;
 
-	if (rx_prov != prov || !prov->trans_tx)
+	if (!valid_prov(prov) || !prov->trans_tx)
 		return;
 
 	switch (prov->state) {
@@ -861,7 +892,7 @@ static void int_prov_ack(void *user_data, uint8_t msg_num)
 
 	case INT_PROV_KEY_SENT:
 		if (prov->conf_inputs.start.pub_key)
-			int_prov_auth();
+			int_prov_auth(prov);
 		break;
 
 	case INT_PROV_IDLE:
@@ -881,11 +912,12 @@ static void int_prov_ack(void *user_data, uint8_t msg_num)
 
 static void initiator_open_cb(void *user_data, int err)
 {
+	struct mesh_prov_initiator *prov = user_data;
 	uint8_t msg[20];
 	int n;
 	bool result;
 
-	if (!prov)
+	if (!valid_prov(prov))
 		return;
 
 	if (err != MESH_ERROR_NONE)
@@ -919,19 +951,19 @@ static void initiator_open_cb(void *user_data, int err)
 	return;
 fail:
 	prov->start_cb(prov->caller_data, err);
-	initiator_free();
+	initiator_free(prov);
 }
 
 static void initiate_to(struct l_timeout *timeout, void *user_data)
 {
-	struct mesh_prov_initiator *rx_prov = user_data;
+	struct mesh_prov_initiator *prov = user_data;
 
-	if (rx_prov != prov) {
+	if (!valid_prov(prov)) {
 		l_timeout_remove(timeout);
 		return;
 	}
 
-	int_prov_close(user_data, PROV_ERR_TIMEOUT);
+	int_prov_close(prov, PROV_ERR_TIMEOUT);
 }
 
 bool initiator_start(uint8_t transport, uint16_t server, uint16_t svr_idx,
@@ -942,11 +974,24 @@ bool initiator_start(uint8_t transport, uint16_t server, uint16_t svr_idx,
 		mesh_prov_initiator_complete_func_t complete_cb,
 		void *node, void *caller_data)
 {
+	struct mesh_prov_initiator *prov;
+	struct prov_server key = { node, server };
+
 	/* Invoked from Add() method in mesh-api.txt, to add a
 	 * remote unprovisioned device network.
 	 */
 
-	if (prov)
+	if (!provs)
+		provs = l_queue_new();
+
+	/*
+	 * Sessions run in parallel up to the configured limit, but a
+	 * Remote Provisioning Server only supports a single link.
+	 */
+	if (l_queue_length(provs) >= mesh_get_prov_sessions())
+		return false;
+
+	if (l_queue_find(provs, match_server, &key))
 		return false;
 
 	prov = l_new(struct mesh_prov_initiator, 1);
@@ -964,6 +1009,8 @@ bool initiator_start(uint8_t transport, uint16_t server, uint16_t svr_idx,
 	prov->timeout = l_timeout_create(timeout, initiate_to, prov, NULL);
 	memcpy(prov->uuid, uuid, 16);
 
+	l_queue_push_tail(provs, prov);
+
 	mesh_agent_refresh(prov->agent, initiator_open_cb, prov);
 
 	return true;
@@ -971,7 +1018,11 @@ bool initiator_start(uint8_t transport, uint16_t server, uint16_t svr_idx,
 
 void initiator_cancel(void *user_data)
 {
-	initiator_free();
+	struct mesh_prov_initiator *prov;
+
+	prov = l_queue_find(provs, match_caller, user_data);
+	if (prov)
+		initiator_free(prov);
 }
 
 static void rpr_tx(void *user_data, const void *data, uint16_t len)
@@ -1004,6 +1055,8 @@ static bool remprv_cli_pkt(uint16_t src, uint16_t unicast, uint16_t app_idx,
 					uint16_t size, const void *user_data)
 {
 	struct mesh_node *node = (struct mesh_node *) user_data;
+	struct prov_server key = { node, src };
+	struct mesh_prov_initiator *prov;
 	const uint8_t *pkt = data;
 	struct scan_req *req;
 	uint32_t opcode;
@@ -1026,8 +1079,7 @@ static bool remprv_cli_pkt(uint16_t src, uint16_t unicast, uint16_t app_idx,
 	if (app_idx == APP_IDX_DEV_LOCAL && unicast != src)
 		return true;
 
-	if (prov && (prov->server != src || prov->node != node))
-		return true;
+	prov = l_queue_find(provs, match_server, &key);
 
 	n = 0;
 
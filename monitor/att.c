@@ -22,6 +22,7 @@
 #include <inttypes.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <time.h>
 #include <linux/limits.h>
 #include <sys/stat.h>
 
@@ -54,15 +55,36 @@ struct att_read {
 	struct iovec *iov;
 };
 
+#define ATT_HANDLE_CACHE_SIZE	64
+
+struct att_handle_cache {
+	unsigned int version;
+	uint16_t handle;
+	struct gatt_db_attribute *attr;
+	const struct gatt_handler *handler;
+};
+
+/* Database shared by all connections using the same settings file */
+struct att_db {
+	char *filename;
+	struct gatt_db *db;
+	struct timespec mtim;
+	time_t checked;
+	unsigned int version;
+	int ref_count;
+	struct att_handle_cache cache[ATT_HANDLE_CACHE_SIZE];
+};
+
 struct att_conn_data {
-	struct gatt_db *ldb;
-	struct timespec ldb_mtim;
-	struct gatt_db *rdb;
-	struct timespec rdb_mtim;
+	struct att_db *ldb;
+	struct att_db *rdb;
+	time_t checked;
 	struct queue *reads;
 	uint16_t mtu;
 };
 
+static struct queue *att_dbs;
+
 static void print_uuid(const char *label, const void *data, uint16_t size)
 {
 	const char *str;
@@ -397,12 +419,85 @@ static const struct bitfield_data chrc_prop_table[] = {
 	{ }
 };
 
+static time_t att_get_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec;
+}
+
+static bool match_db_filename(const void *data, const void *match_data)
+{
+	const struct att_db *db = data;
+	const char *filename = match_data;
+
+	return !strcmp(db->filename, filename);
+}
+
+static struct att_db *att_db_get(const char *filename)
+{
+	struct att_db *db;
+
+	db = queue_find(att_dbs, match_db_filename, filename);
+	if (db) {
+		/* Don't carry attributes learned from an earlier connection
+		 * over unless they came from the settings file.
+		 */
+		if (!db->ref_count && !db->mtim.tv_sec && !db->mtim.tv_nsec) {
+			gatt_db_clear(db->db);
+			db->version++;
+		}
+
+		db->ref_count++;
+		return db;
+	}
+
+	if (!att_dbs)
+		att_dbs = queue_new();
+
+	db = new0(struct att_db, 1);
+	db->filename = strdup(filename);
+	db->db = gatt_db_new();
+	db->version = 1;
+	db->ref_count = 1;
+
+	queue_push_tail(att_dbs, db);
+
+	return db;
+}
+
+static void att_db_put(struct att_db *db)
+{
+	if (!db)
+		return;
+
+	/* Keep the entry around so reconnections reuse the loaded file */
+	db->ref_count--;
+}
+
+static void att_db_free(void *data)
+{
+	struct att_db *db = data;
+
+	gatt_db_unref(db->db);
+	free(db->filename);
+	free(db);
+}
+
+void att_cleanup(void)
+{
+	queue_destroy(att_dbs, att_db_free);
+	att_dbs = NULL;
+}
+
 static void att_conn_data_free(void *data)
 {
 	struct att_conn_data *att_data = data;
 
-	gatt_db_unref(att_data->rdb);
-	gatt_db_unref(att_data->ldb);
+	att_db_put(att_data->rdb);
+	att_db_put(att_data->ldb);
 	queue_destroy(att_data->reads, free);
 	free(att_data);
 }
@@ -420,34 +515,48 @@ static struct att_conn_data *att_get_conn_data(struct packet_conn_data *conn)
 		return data;
 
 	data = new0(struct att_conn_data, 1);
-	data->rdb = gatt_db_new();
-	data->ldb = gatt_db_new();
 	conn->data = data;
 	conn->destroy = att_conn_data_free;
 
 	return data;
 }
 
-static void gatt_load_db(struct gatt_db *db, const char *filename,
-						struct timespec *mtim)
+static void gatt_load_db(struct att_db *db, time_t now)
 {
 	struct stat st;
 
-	if (lstat(filename, &st))
+	/* Files are only checked for modifications once per second */
+	if (db->checked == now)
+		return;
+
+	db->checked = now;
+
+	if (lstat(db->filename, &st))
 		return;
 
-	if (!gatt_db_isempty(db)) {
+	if (!gatt_db_isempty(db->db)) {
 		/* Check if file has been modified since last time */
-		if (st.st_mtim.tv_sec == mtim->tv_sec &&
-				    st.st_mtim.tv_nsec == mtim->tv_nsec)
+		if (st.st_mtim.tv_sec == db->mtim.tv_sec &&
+				    st.st_mtim.tv_nsec == db->mtim.tv_nsec)
 			return;
 		/* Clear db before reloading */
-		gatt_db_clear(db);
+		gatt_db_clear(db->db);
 	}
 
-	*mtim = st.st_mtim;
+	db->mtim = st.st_mtim;
+	db->version++;
+
+	btd_settings_gatt_db_load(db->db, db->filename);
+}
+
+static struct att_db *att_db_update(struct att_db *db, const char *filename)
+{
+	if (db && !strcmp(db->filename, filename))
+		return db;
+
+	att_db_put(db);
 
-	btd_settings_gatt_db_load(db, filename);
+	return att_db_get(filename);
 }
 
 static void load_gatt_db(struct packet_conn_data *conn)
@@ -457,6 +566,13 @@ static void load_gatt_db(struct packet_conn_data *conn)
 	char local[18];
 	char peer[18];
 	uint8_t id[6], id_type;
+	time_t now = att_get_time();
+
+	/* Peer identity and files are only looked up once per second */
+	if (data->ldb && data->rdb && data->checked == now)
+		return;
+
+	data->checked = now;
 
 	ba2str((bdaddr_t *)conn->src, local);
 
@@ -466,17 +582,18 @@ static void load_gatt_db(struct packet_conn_data *conn)
 		ba2str((bdaddr_t *)conn->dst, peer);
 
 	create_filename(filename, PATH_MAX, "/%s/attributes", local);
-	gatt_load_db(data->ldb, filename, &data->ldb_mtim);
+	data->ldb = att_db_update(data->ldb, filename);
+	gatt_load_db(data->ldb, now);
 
 	create_filename(filename, PATH_MAX, "/%s/cache/%s", local, peer);
-	gatt_load_db(data->rdb, filename, &data->rdb_mtim);
+	data->rdb = att_db_update(data->rdb, filename);
+	gatt_load_db(data->rdb, now);
 }
 
-static struct gatt_db *get_db(const struct l2cap_frame *frame, bool rsp)
+static struct att_db *get_att_db(const struct l2cap_frame *frame, bool rsp)
 {
 	struct packet_conn_data *conn;
 	struct att_conn_data *data;
-	struct gatt_db *db;
 
 	conn = packet_get_conn_data(frame->handle);
 	if (!conn)
@@ -491,17 +608,29 @@ static struct gatt_db *get_db(const struct l2cap_frame *frame, bool rsp)
 
 	if (frame->in) {
 		if (rsp)
-			db = data->rdb;
+			return data->rdb;
 		else
-			db = data->ldb;
+			return data->ldb;
 	} else {
 		if (rsp)
-			db = data->ldb;
+			return data->ldb;
 		else
-			db = data->rdb;
+			return data->rdb;
 	}
+}
 
-	return db;
+/* Returns the database to be modified invalidating its handle cache */
+static struct gatt_db *get_db(const struct l2cap_frame *frame, bool rsp)
+{
+	struct att_db *db;
+
+	db = get_att_db(frame, rsp);
+	if (!db)
+		return NULL;
+
+	db->version++;
+
+	return db->db;
 }
 
 static struct gatt_db_attribute *insert_chrc(const struct l2cap_frame *frame,
@@ -4279,16 +4408,39 @@ static void att_find_by_type_val_rsp(const struct l2cap_frame *frame)
 	packet_hexdump(ptr, len);
 }
 
-static struct gatt_db_attribute *get_attribute(const struct l2cap_frame *frame,
-						uint16_t handle, bool rsp)
+static struct gatt_db_attribute *get_attribute_handler(
+					const struct l2cap_frame *frame,
+					uint16_t handle, bool rsp,
+					const struct gatt_handler **handler)
 {
-	struct gatt_db *db;
+	struct att_handle_cache *entry;
+	struct att_db *db;
 
-	db = get_db(frame, rsp);
+	db = get_att_db(frame, rsp);
 	if (!db)
 		return NULL;
 
-	return gatt_db_get_attribute(db, handle);
+	/* Resolving the handler means scanning the whole handler table so
+	 * keep the last result for each handle slot.
+	 */
+	entry = &db->cache[handle % ATT_HANDLE_CACHE_SIZE];
+	if (entry->version != db->version || entry->handle != handle) {
+		entry->version = db->version;
+		entry->handle = handle;
+		entry->attr = gatt_db_get_attribute(db->db, handle);
+		entry->handler = entry->attr ? get_handler(entry->attr) : NULL;
+	}
+
+	if (handler)
+		*handler = entry->handler;
+
+	return entry->attr;
+}
+
+static struct gatt_db_attribute *get_attribute(const struct l2cap_frame *frame,
+						uint16_t handle, bool rsp)
+{
+	return get_attribute_handler(frame, handle, rsp, NULL);
 }
 
 static void queue_read(const struct l2cap_frame *frame, bt_uuid_t *uuid,
@@ -4301,12 +4453,11 @@ static void queue_read(const struct l2cap_frame *frame, bt_uuid_t *uuid,
 	const struct gatt_handler *handler;
 
 	if (handle) {
-		attr = get_attribute(frame, handle, false);
+		attr = get_attribute_handler(frame, handle, false, &handler);
 		if (!attr)
 			return;
-	}
-
-	handler = attr ? get_handler(attr) : get_handler_uuid(uuid);
+	} else
+		handler = get_handler_uuid(uuid);
 
 	conn = packet_get_conn_data(frame->handle);
 	data = att_get_conn_data(conn);
@@ -4553,11 +4704,10 @@ static void print_write(const struct l2cap_frame *frame, uint16_t handle,
 
 	print_hex_field("  Data", frame->data, len);
 
-	attr = get_attribute(frame, handle, false);
+	attr = get_attribute_handler(frame, handle, false, &handler);
 	if (!attr)
 		return;
 
-	handler = get_handler(attr);
 	if (!handler || !handler->write)
 		return;
 
@@ -4629,11 +4779,10 @@ static void print_notify(const struct l2cap_frame *frame, uint16_t handle,
 		return;
 	}
 
-	attr = get_attribute(frame, handle, true);
+	attr = get_attribute_handler(frame, handle, true, &handler);
 	if (!attr)
 		return;
 
-	handler = get_handler(attr);
 	if (!handler)
 		return;
 
@@ -14,3 +14,4 @@
 
 void att_packet(uint16_t index, bool in, uint16_t handle, uint16_t cid,
 					const void *data, uint16_t size);
+void att_cleanup(void);
@@ -1532,6 +1532,9 @@ void control_reader(const char *path, bool pager)
 		break;
 	}
 
+	/* Print before the pager, if any, closes the output */
+	packet_print_annotation_stats();
+
 	if (pager)
 		close_pager();
 
@@ -15,6 +15,7 @@
 
 #define _GNU_SOURCE
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "hwdb.h"
@@ -22,23 +23,48 @@
 #ifdef HAVE_UDEV
 #include <libudev.h>
 
+/* Annotating addresses happens for nearly every decoded packet, so keep the
+ * database open and remember the company of recently seen OUIs.
+ */
+#define OUI_CACHE_SIZE	256
+
+struct oui_entry {
+	bool valid;
+	uint32_t oui;
+	char *company;
+};
+
+static struct udev *udev;
+static struct udev_hwdb *hwdb;
+static struct oui_entry oui_cache[OUI_CACHE_SIZE];
+static unsigned long oui_hits;
+static unsigned long oui_misses;
+
+static bool hwdb_unavailable;
+
+static struct udev_hwdb *get_hwdb(void)
+{
+	if (hwdb || hwdb_unavailable)
+		return hwdb;
+
+	udev = udev_new();
+	if (udev)
+		hwdb = udev_hwdb_new(udev);
+
+	/* Don't retry opening a database that isn't there */
+	if (!hwdb)
+		hwdb_unavailable = true;
+
+	return hwdb;
+}
+
 bool hwdb_get_vendor_model(const char *modalias, char **vendor, char **model)
 {
-	struct udev *udev;
-	struct udev_hwdb *hwdb;
 	struct udev_list_entry *head, *entry;
-	bool result;
 
-	udev = udev_new();
-	if (!udev)
+	if (!get_hwdb())
 		return false;
 
-	hwdb = udev_hwdb_new(udev);
-	if (!hwdb) {
-		result = false;
-		goto done;
-	}
-
 	*vendor = NULL;
 	*model = NULL;
 
@@ -56,39 +82,35 @@ bool hwdb_get_vendor_model(const char *modalias, char **vendor, char **model)
 			*model = strdup(udev_list_entry_get_value(entry));
 	}
 
-	hwdb = udev_hwdb_unref(hwdb);
-
-	result = true;
-
-done:
-	udev = udev_unref(udev);
-
-	return result;
+	return true;
 }
 
 bool hwdb_get_company(const uint8_t *bdaddr, char **company)
 {
-	struct udev *udev;
-	struct udev_hwdb *hwdb;
 	struct udev_list_entry *head, *entry;
+	struct oui_entry *cache;
 	char modalias[11];
-	bool result;
+	uint32_t oui;
 
 	if (!bdaddr[2] && !bdaddr[1] && !bdaddr[0])
 		return false;
 
-	sprintf(modalias, "OUI:%2.2X%2.2X%2.2X",
-				bdaddr[5], bdaddr[4], bdaddr[3]);
+	oui = bdaddr[5] << 16 | bdaddr[4] << 8 | bdaddr[3];
 
-	udev = udev_new();
-	if (!udev)
+	cache = &oui_cache[(oui ^ (oui >> 8) ^ (oui >> 16)) % OUI_CACHE_SIZE];
+	if (cache->valid && cache->oui == oui) {
+		oui_hits++;
+		*company = cache->company ? strdup(cache->company) : NULL;
+		return true;
+	}
+
+	oui_misses++;
+
+	if (!get_hwdb())
 		return false;
 
-	hwdb = udev_hwdb_new(udev);
-	if (!hwdb) {
-		result = false;
-		goto done;
-	}
+	sprintf(modalias, "OUI:%2.2X%2.2X%2.2X",
+				bdaddr[5], bdaddr[4], bdaddr[3]);
 
 	*company = NULL;
 
@@ -103,14 +125,37 @@ bool hwdb_get_company(const uint8_t *bdaddr, char **company)
 		}
 	}
 
-	hwdb = udev_hwdb_unref(hwdb);
+	/* Unknown OUIs are cached as well to avoid repeated lookups */
+	free(cache->company);
+	cache->valid = true;
+	cache->oui = oui;
+	cache->company = *company ? strdup(*company) : NULL;
 
-	result = true;
+	return true;
+}
 
-done:
-	udev = udev_unref(udev);
+void hwdb_get_stats(unsigned long *hits, unsigned long *misses)
+{
+	*hits = oui_hits;
+	*misses = oui_misses;
+}
+
+void hwdb_cleanup(void)
+{
+	int i;
 
-	return result;
+	for (i = 0; i < OUI_CACHE_SIZE; i++) {
+		free(oui_cache[i].company);
+		memset(&oui_cache[i], 0, sizeof(oui_cache[i]));
+	}
+
+	if (hwdb)
+		hwdb = udev_hwdb_unref(hwdb);
+
+	if (udev)
+		udev = udev_unref(udev);
+
+	hwdb_unavailable = false;
 }
 #else
 bool hwdb_get_vendor_model(const char *modalias, char **vendor, char **model)
@@ -122,4 +167,14 @@ bool hwdb_get_company(const uint8_t *bdaddr, char **company)
 {
 	return false;
 }
+
+void hwdb_get_stats(unsigned long *hits, unsigned long *misses)
+{
+	*hits = 0;
+	*misses = 0;
+}
+
+void hwdb_cleanup(void)
+{
+}
 #endif
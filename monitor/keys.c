@@ -34,6 +34,38 @@ struct irk_data {
 
 static struct queue *irk_list;
 
+/* Resolving an RPA means running AES against every known IRK, so remember
+ * the outcome for recently seen addresses. The cache is dropped whenever
+ * the set of IRKs changes.
+ */
+#define RPA_CACHE_SIZE	1024
+
+struct rpa_entry {
+	bool valid;
+	uint8_t addr[6];
+	struct irk_data *irk;
+};
+
+static struct rpa_entry rpa_cache[RPA_CACHE_SIZE];
+static unsigned long rpa_hits;
+static unsigned long rpa_misses;
+
+static void rpa_cache_clear(void)
+{
+	memset(rpa_cache, 0, sizeof(rpa_cache));
+}
+
+static struct rpa_entry *rpa_cache_entry(const uint8_t addr[6])
+{
+	uint32_t hash = 2166136261u;
+	int i;
+
+	for (i = 0; i < 6; i++)
+		hash = (hash ^ addr[i]) * 16777619u;
+
+	return &rpa_cache[hash % RPA_CACHE_SIZE];
+}
+
 void keys_setup(void)
 {
 	crypto = bt_crypto_new();
@@ -45,6 +77,8 @@ void keys_cleanup(void)
 {
 	bt_crypto_unref(crypto);
 
+	rpa_cache_clear();
+
 	queue_destroy(irk_list, free);
 }
 
@@ -52,6 +86,8 @@ void keys_update_identity_key(const uint8_t key[16])
 {
 	struct irk_data *irk;
 
+	rpa_cache_clear();
+
 	irk = queue_peek_tail(irk_list);
 	if (irk && !memcmp(irk->key, empty_key, 16)) {
 		memcpy(irk->key, key, 16);
@@ -70,6 +106,8 @@ void keys_update_identity_addr(const uint8_t addr[6], uint8_t addr_type)
 {
 	struct irk_data *irk;
 
+	rpa_cache_clear();
+
 	irk = queue_peek_tail(irk_list);
 	if (irk && !memcmp(irk->addr, empty_addr, 6)) {
 		memcpy(irk->addr, addr, 6);
@@ -100,9 +138,25 @@ static bool match_resolve_irk(const void *data, const void *match_data)
 bool keys_resolve_identity(const uint8_t addr[6], uint8_t ident[6],
 							uint8_t *ident_type)
 {
+	struct rpa_entry *cache;
 	struct irk_data *irk;
 
-	irk = queue_find(irk_list, match_resolve_irk, addr);
+	if (queue_isempty(irk_list))
+		return false;
+
+	cache = rpa_cache_entry(addr);
+	if (cache->valid && !memcmp(cache->addr, addr, 6)) {
+		rpa_hits++;
+		irk = cache->irk;
+	} else {
+		rpa_misses++;
+		irk = queue_find(irk_list, match_resolve_irk, addr);
+
+		/* Addresses that don't resolve are cached as well */
+		cache->valid = true;
+		memcpy(cache->addr, addr, 6);
+		cache->irk = irk;
+	}
 
 	if (irk) {
 		memcpy(ident, irk->addr, 6);
@@ -126,6 +180,8 @@ bool keys_add_identity(const uint8_t addr[6], uint8_t addr_type,
 {
 	struct irk_data *irk;
 
+	rpa_cache_clear();
+
 	irk = queue_find(irk_list, match_key, key);
 	if (!irk) {
 		irk = new0(struct irk_data, 1);
@@ -138,3 +194,9 @@ bool keys_add_identity(const uint8_t addr[6], uint8_t addr_type,
 
 	return true;
 }
+
+void keys_get_stats(unsigned long *hits, unsigned long *misses)
+{
+	*hits = rpa_hits;
+	*misses = rpa_misses;
+}
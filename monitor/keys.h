@@ -22,3 +22,4 @@ bool keys_resolve_identity(const uint8_t addr[6], uint8_t ident[6],
 							uint8_t *ident_type);
 bool keys_add_identity(const uint8_t addr[6], uint8_t addr_type,
 					const uint8_t key[16]);
+void keys_get_stats(unsigned long *hits, unsigned long *misses);
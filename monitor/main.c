@@ -27,6 +27,8 @@
 #include "packet.h"
 #include "lmp.h"
 #include "keys.h"
+#include "att.h"
+#include "hwdb.h"
 #include "analyze.h"
 #include "ellisys.h"
 #include "control.h"
@@ -68,6 +70,7 @@ static void usage(void)
 		"\t-I, --iso              Dump ISO traffic\n"
 		"\t-E, --ellisys [ip]     Send Ellisys HCI Injection\n"
 		"\t-P, --no-pager         Disable pager usage\n"
+		"\t-K, --cache-stats      Show address annotation cache usage\n"
 		"\t-J  --jlink <device>,[<serialno>],[<interface>],[<speed>]\n"
 		"\t                       Read data from RTT\n"
 		"\t-R  --rtt [<address>],[<area>],[<name>]\n"
@@ -96,6 +99,7 @@ static const struct option main_options[] = {
 	{ "iso",       no_argument,       NULL, 'I' },
 	{ "ellisys",   required_argument, NULL, 'E' },
 	{ "no-pager",  no_argument,       NULL, 'P' },
+	{ "cache-stats", no_argument,     NULL, 'K' },
 	{ "jlink",     required_argument, NULL, 'J' },
 	{ "rtt",       required_argument, NULL, 'R' },
 	{ "columns",   required_argument, NULL, 'C' },
@@ -131,7 +135,7 @@ int main(int argc, char *argv[])
 		struct sockaddr_un addr;
 
 		opt = getopt_long(argc, argv,
-				"r:w:a:s:p:i:d:B:V:MNtTSAIE:PJ:R:C:c:vh",
+				"r:w:a:s:p:i:d:B:V:MNtTSAIE:PKJ:R:C:c:vh",
 				main_options, NULL);
 		if (opt < 0)
 			break;
@@ -212,6 +216,9 @@ int main(int argc, char *argv[])
 		case 'P':
 			use_pager = false;
 			break;
+		case 'K':
+			filter_mask |= PACKET_FILTER_SHOW_CACHE_STATS;
+			break;
 		case 'J':
 			jlink = optarg;
 			break;
@@ -275,6 +282,11 @@ int main(int argc, char *argv[])
 			ellisys_enable(ellisys_server, ellisys_port);
 
 		control_reader(reader_path, use_pager);
+
+		att_cleanup();
+		keys_cleanup();
+		hwdb_cleanup();
+
 		return EXIT_SUCCESS;
 	}
 
@@ -297,7 +309,11 @@ int main(int argc, char *argv[])
 
 	exit_status = mainloop_run_with_signal(signal_callback, NULL);
 
+	packet_print_annotation_stats();
+
+	att_cleanup();
 	keys_cleanup();
+	hwdb_cleanup();
 
 	return exit_status;
 }
@@ -15754,6 +15754,36 @@ void packet_ctrl_event(struct timeval *tv, struct ucred *cred, uint16_t index,
 	mgmt_data->func(data, size);
 }
 
+static void print_cache_stats(const char *label, unsigned long hits,
+							unsigned long misses)
+{
+	unsigned long total = hits + misses;
+
+	if (!total)
+		return;
+
+	printf("  %s: %lu lookups, %lu hits (%lu%%)\n", label, total, hits,
+							hits * 100 / total);
+}
+
+void packet_print_annotation_stats(void)
+{
+	unsigned long oui_hits, oui_misses, rpa_hits, rpa_misses;
+
+	if (!(filter_mask & PACKET_FILTER_SHOW_CACHE_STATS))
+		return;
+
+	hwdb_get_stats(&oui_hits, &oui_misses);
+	keys_get_stats(&rpa_hits, &rpa_misses);
+
+	if (!oui_hits && !oui_misses && !rpa_hits && !rpa_misses)
+		return;
+
+	printf("Address annotation cache\n");
+	print_cache_stats("Company", oui_hits, oui_misses);
+	print_cache_stats("Identity", rpa_hits, rpa_misses);
+}
+
 void packet_todo(void)
 {
 	int i;
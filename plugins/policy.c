@@ -16,6 +16,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <time.h>
+#include <limits.h>
 
 #include <glib.h>
 
@@ -44,6 +45,8 @@
 #define CT_RETRIES 1
 #define TG_RETRIES CT_RETRIES
 
+#define RECONNECT_BUSY_TIMEOUT 1
+
 struct reconnect_data {
 	struct btd_device *dev;
 	bool reconnect;
@@ -51,6 +54,11 @@ struct reconnect_data {
 	unsigned int timer;
 	bool active;
 	unsigned int attempt;
+	unsigned int skip;
+	bool pending;
+	bool connected;
+	unsigned int check;
+	gint64 started;
 	bool on_resume;
 };
 
@@ -69,6 +77,9 @@ static size_t reconnect_intervals_len = 0;
 static const int default_resume_delay = 2;
 static int resume_delay;
 
+static const int default_reconnect_limit = 0;
+static int reconnect_limit;
+
 static GSList *reconnects = NULL;
 
 static unsigned int service_id = 0;
@@ -547,26 +558,51 @@ static void reconnect_reset(struct reconnect_data *reconnect)
 {
 	reconnect->attempt = 0;
 	reconnect->active = false;
+	reconnect->pending = false;
 
 	if (reconnect->timer > 0) {
 		timeout_remove(reconnect->timer);
 		reconnect->timer = 0;
 	}
+
+	if (reconnect->check > 0) {
+		timeout_remove(reconnect->check);
+		reconnect->check = 0;
+	}
 }
 
-static bool reconnect_match(const char *uuid)
+static int reconnect_priority(const char *uuid)
 {
-	char **str;
+	int i;
 
 	if (!reconnect_uuids)
-		return false;
+		return -1;
 
-	for (str = reconnect_uuids; *str; str++) {
-		if (!bt_uuid_strcmp(uuid, *str))
-			return true;
+	for (i = 0; reconnect_uuids[i]; i++) {
+		if (!bt_uuid_strcmp(uuid, reconnect_uuids[i]))
+			return i;
 	}
 
-	return false;
+	return -1;
+}
+
+static bool reconnect_match(const char *uuid)
+{
+	return reconnect_priority(uuid) >= 0;
+}
+
+static int service_priority(struct btd_service *service)
+{
+	struct btd_profile *profile = btd_service_get_profile(service);
+	int prio = reconnect_priority(profile->remote_uuid);
+
+	/* Services not listed in ReconnectUUIDs are connected last */
+	return prio < 0 ? INT_MAX : prio;
+}
+
+static int service_priority_cmp(gconstpointer a, gconstpointer b)
+{
+	return service_priority((void *) a) - service_priority((void *) b);
 }
 
 static struct reconnect_data *reconnect_add(struct btd_service *service)
@@ -584,8 +620,10 @@ static struct reconnect_data *reconnect_add(struct btd_service *service)
 	if (g_slist_find(reconnect->services, service))
 		return reconnect;
 
-	reconnect->services = g_slist_append(reconnect->services,
-						btd_service_ref(service));
+	/* Services are connected in the order set by ReconnectUUIDs */
+	reconnect->services = g_slist_insert_sorted(reconnect->services,
+						btd_service_ref(service),
+						service_priority_cmp);
 
 	return reconnect;
 }
@@ -597,6 +635,9 @@ static void reconnect_destroy(gpointer data)
 	if (reconnect->timer > 0)
 		timeout_remove(reconnect->timer);
 
+	if (reconnect->check > 0)
+		timeout_remove(reconnect->check);
+
 	g_slist_free_full(reconnect->services,
 					(GDestroyNotify) btd_service_unref);
 	g_free(reconnect);
@@ -627,9 +668,102 @@ static void reconnect_remove(struct btd_service *service)
 	if (reconnect->timer > 0)
 		timeout_remove(reconnect->timer);
 
+	if (reconnect->check > 0)
+		timeout_remove(reconnect->check);
+
 	g_free(reconnect);
 }
 
+static bool reconnect_connecting(struct reconnect_data *reconnect)
+{
+	GSList *l;
+
+	for (l = reconnect->services; l; l = g_slist_next(l)) {
+		struct btd_service *service = l->data;
+
+		if (btd_service_get_state(service) ==
+						BTD_SERVICE_STATE_CONNECTING)
+			return true;
+	}
+
+	return false;
+}
+
+static bool reconnect_check(gpointer data)
+{
+	struct reconnect_data *reconnect = data;
+
+	reconnect->check = 0;
+
+	/*
+	 * Services are connected one after the other, wait for the next
+	 * one if it has started. Services that failed to start connecting
+	 * never reach this state so they are not waited for.
+	 */
+	if (reconnect_connecting(reconnect))
+		return FALSE;
+
+	reconnect->pending = false;
+
+	if (!reconnect->connected)
+		return FALSE;
+
+	/*
+	 * Remember how many attempts it took so the next reconnection of
+	 * this device starts closer to the interval that worked, and move
+	 * back towards the shortest interval when the first attempt works.
+	 */
+	if (reconnect->attempt > 1)
+		reconnect->skip += reconnect->attempt - 1;
+	else if (reconnect->skip)
+		reconnect->skip--;
+
+	return FALSE;
+}
+
+static void reconnect_service_done(struct reconnect_data *reconnect,
+					struct btd_service *service,
+					btd_service_state_t state)
+{
+	struct btd_profile *profile = btd_service_get_profile(service);
+
+	if (!g_slist_find(reconnect->services, service))
+		return;
+
+	/*
+	 * The next service is only started once this state change has been
+	 * processed so check if the device is done from a fresh context.
+	 */
+	if (!reconnect->check)
+		reconnect->check = timeout_add(0, reconnect_check, reconnect,
+									NULL);
+
+	if (state != BTD_SERVICE_STATE_CONNECTED)
+		return;
+
+	reconnect->connected = true;
+
+	info("%s %s reconnected in %" G_GINT64_FORMAT " ms",
+			device_get_path(reconnect->dev), profile->name,
+			(g_get_monotonic_time() - reconnect->started) / 1000);
+}
+
+static unsigned int reconnect_count_pending(struct btd_adapter *adapter)
+{
+	unsigned int count = 0;
+	GSList *l;
+
+	for (l = reconnects; l; l = g_slist_next(l)) {
+		struct reconnect_data *reconnect = l->data;
+
+		if (reconnect->pending &&
+				device_get_adapter(reconnect->dev) == adapter)
+			count++;
+	}
+
+	return count;
+}
+
 static void service_cb(struct btd_service *service,
 						btd_service_state_t old_state,
 						btd_service_state_t new_state,
@@ -674,6 +808,11 @@ static void service_cb(struct btd_service *service,
 		return;
 	}
 
+	reconnect = reconnect_find(btd_service_get_device(service));
+	if (reconnect && reconnect->pending &&
+				old_state == BTD_SERVICE_STATE_CONNECTING)
+		reconnect_service_done(reconnect, service, new_state);
+
 	if (new_state != BTD_SERVICE_STATE_CONNECTED)
 		return;
 
@@ -709,6 +848,20 @@ static bool reconnect_timeout(gpointer data)
 	/* Mark any reconnect on resume as handled */
 	reconnect->on_resume = false;
 
+	/*
+	 * Wait for other devices to complete their reconnection if the
+	 * limit of parallel reconnections was reached.
+	 */
+	if (reconnect_limit > 0 && reconnect_count_pending(
+			device_get_adapter(reconnect->dev)) >=
+			(unsigned int) reconnect_limit) {
+		DBG("Reconnection limit reached, postponing");
+		reconnect->timer = timeout_add_seconds(RECONNECT_BUSY_TIMEOUT,
+							reconnect_timeout,
+							reconnect, NULL);
+		return FALSE;
+	}
+
 	err = btd_device_connect_services(reconnect->dev, reconnect->services);
 	if (err < 0) {
 		error("Reconnecting services failed: %s (%d)",
@@ -717,6 +870,8 @@ static bool reconnect_timeout(gpointer data)
 		return FALSE;
 	}
 
+	reconnect->pending = true;
+	reconnect->connected = false;
 	reconnect->attempt++;
 
 	return FALSE;
@@ -726,10 +881,18 @@ static void reconnect_set_timer(struct reconnect_data *reconnect, int timeout)
 {
 	static int interval_timeout = 0;
 
+	unsigned int index = reconnect->attempt + reconnect->skip;
+
+	if (!reconnect->active)
+		reconnect->started = g_get_monotonic_time();
+
 	reconnect->active = true;
 
-	if (reconnect->attempt < reconnect_intervals_len)
-		interval_timeout = reconnect_intervals[reconnect->attempt];
+	if (index < reconnect_intervals_len)
+		interval_timeout = reconnect_intervals[index];
+	else if (reconnect_intervals_len)
+		interval_timeout = reconnect_intervals[
+						reconnect_intervals_len - 1];
 
 	if (timeout < 0)
 		timeout = interval_timeout;
@@ -810,6 +973,8 @@ static void conn_fail_cb(struct btd_device *dev, uint8_t status)
 	if (!reconnect || !reconnect->reconnect)
 		return;
 
+	reconnect->pending = false;
+
 	if (!reconnect->active)
 		return;
 
@@ -860,6 +1025,8 @@ static int policy_init(void)
 		reconnect_intervals = util_memdup(default_intervals,
 						sizeof(default_intervals));
 		auto_enable = default_auto_enable;
+		resume_delay = default_resume_delay;
+		reconnect_limit = default_reconnect_limit;
 		goto done;
 	}
 
@@ -907,6 +1074,14 @@ static int policy_init(void)
 		g_clear_error(&gerr);
 		resume_delay = default_resume_delay;
 	}
+
+	reconnect_limit = g_key_file_get_integer(conf, "Policy",
+							"ReconnectLimit",
+							&gerr);
+	if (gerr) {
+		g_clear_error(&gerr);
+		reconnect_limit = default_reconnect_limit;
+	}
 done:
 	if (reconnect_uuids && reconnect_uuids[0] && reconnect_attempts) {
 		btd_add_disconnect_cb(disconnect_cb);
@@ -2650,7 +2650,11 @@ static gboolean avrcp_list_items_rsp(struct avctp *conn, uint8_t *operands,
 		len = get_be16(&operands[i]);
 		i += 2;
 
+		/* Keep a hole for skipped items so that the position of the
+		 * following ones is preserved.
+		 */
 		if (type != 0x03 && type != 0x02) {
+			p->items = g_slist_append(p->items, NULL);
 			i += len;
 			continue;
 		}
@@ -2665,8 +2669,7 @@ static gboolean avrcp_list_items_rsp(struct avctp *conn, uint8_t *operands,
 		else
 			item = parse_media_folder(session, &operands[i], len);
 
-		if (item)
-			p->items = g_slist_append(p->items, item);
+		p->items = g_slist_append(p->items, item);
 
 		i += len;
 	}
@@ -3839,8 +3842,21 @@ static void avrcp_addressed_player_changed(struct avrcp *session,
 static void avrcp_uids_changed(struct avrcp *session, struct avrcp_header *pdu)
 {
 	struct avrcp_player *player = session->controller->player;
+	uint16_t uid_counter = get_be16(&pdu->params[1]);
 
-	player->uid_counter = get_be16(&pdu->params[1]);
+	if (player->uid_counter != uid_counter && player->user_data)
+		media_player_set_uid_counter(player->user_data, uid_counter);
+
+	player->uid_counter = uid_counter;
+}
+
+static void avrcp_now_playing_changed(struct avrcp *session,
+						struct avrcp_header *pdu)
+{
+	struct avrcp_player *player = session->controller->player;
+
+	if (player->user_data)
+		media_player_playlist_changed(player->user_data);
 }
 
 static gboolean avrcp_handle_event(struct avctp *conn, uint8_t code,
@@ -3903,6 +3919,9 @@ static gboolean avrcp_handle_event(struct avctp *conn, uint8_t code,
 	case AVRCP_EVENT_UIDS_CHANGED:
 		avrcp_uids_changed(session, pdu);
 		break;
+	case AVRCP_EVENT_NOW_PLAYING_CHANGED:
+		avrcp_now_playing_changed(session, pdu);
+		break;
 	default:
 		if (event > AVRCP_EVENT_LAST) {
 			warn("Unsupported event: %u", event);
@@ -3987,6 +4006,7 @@ static gboolean avrcp_get_capabilities_resp(struct avctp *conn, uint8_t code,
 		case AVRCP_EVENT_SETTINGS_CHANGED:
 		case AVRCP_EVENT_ADDRESSED_PLAYER_CHANGED:
 		case AVRCP_EVENT_UIDS_CHANGED:
+		case AVRCP_EVENT_NOW_PLAYING_CHANGED:
 		case AVRCP_EVENT_AVAILABLE_PLAYERS_CHANGED:
 			/* These events above requires a player */
 			if (!session->controller ||
@@ -64,10 +64,17 @@
 
 /* Periodic advertisments are performed by an idle timer, which,
  * at every tick, checks a queue for pending PA requests.
- * When there is no pending requests, an item is popped from the
- * queue, marked as pending and then it gets processed.
+ * Up to PA_SYNC_MAX short lived PA syncs are processed in parallel, PA and
+ * BIG sync requests are only processed when nothing else is in progress.
+ * Pending requests are also processed as soon as a request completes.
  */
 #define PA_IDLE_TIMEOUT 2
+#define PA_SYNC_MAX 4
+
+/* Parsed BASE of broadcast sources are cached for BASE_CACHE_TIMEOUT seconds
+ * so sources that are found again don't require a new short lived PA sync.
+ */
+#define BASE_CACHE_TIMEOUT 60
 
 struct bap_setup {
 	struct bap_ep *ep;
@@ -101,7 +108,18 @@ struct bap_ep {
 struct bap_adapter {
 	struct btd_adapter *adapter;
 	unsigned int pa_timer_id;
+	unsigned int pa_idle_id;
+	unsigned int pa_sync_max;
 	struct queue *bcast_pa_requests;
+	struct queue *base_cache;
+};
+
+struct bap_base_entry {
+	bdaddr_t addr;
+	uint8_t addr_type;
+	struct bt_iso_base base;
+	struct bt_iso_qos qos;
+	gint64 expire;
 };
 
 struct bap_data {
@@ -130,6 +148,7 @@ enum {
 struct bap_bcast_pa_req {
 	uint8_t type;
 	bool in_progress;
+	gint64 start;
 	union {
 		struct btd_service *service;
 		struct bap_setup *setup;
@@ -1220,6 +1239,55 @@ fail:
 	return ret;
 }
 
+static bool match_base_entry(const void *data, const void *match_data)
+{
+	const struct bap_base_entry *entry = data;
+	struct btd_device *device = (void *) match_data;
+
+	return entry->addr_type == btd_device_get_bdaddr_type(device) &&
+		!bacmp(&entry->addr, device_get_address(device));
+}
+
+static bool match_base_expired(const void *data, const void *match_data)
+{
+	const struct bap_base_entry *entry = data;
+	const gint64 *now = match_data;
+
+	return entry->expire <= *now;
+}
+
+static struct bap_base_entry *base_cache_lookup(struct bap_adapter *adapter,
+						struct btd_device *device)
+{
+	gint64 now = g_get_monotonic_time();
+
+	queue_remove_all(adapter->base_cache, match_base_expired, &now, free);
+
+	return queue_find(adapter->base_cache, match_base_entry, device);
+}
+
+static void base_cache_add(struct bap_adapter *adapter,
+				struct btd_device *device,
+				struct bt_iso_base *base, struct bt_iso_qos *qos)
+{
+	struct bap_base_entry *entry;
+
+	entry = base_cache_lookup(adapter, device);
+	if (!entry) {
+		entry = new0(struct bap_base_entry, 1);
+		bacpy(&entry->addr, device_get_address(device));
+		entry->addr_type = btd_device_get_bdaddr_type(device);
+		queue_push_tail(adapter->base_cache, entry);
+	}
+
+	entry->base = *base;
+	entry->qos = *qos;
+	entry->expire = g_get_monotonic_time() +
+				BASE_CACHE_TIMEOUT * G_USEC_PER_SEC;
+}
+
+static void pa_req_schedule(struct bap_adapter *adapter);
+
 static void iso_pa_sync_confirm_cb(GIOChannel *io, void *user_data)
 {
 	GError *err = NULL;
@@ -1247,6 +1315,11 @@ static void iso_pa_sync_confirm_cb(GIOChannel *io, void *user_data)
 	g_io_channel_shutdown(io, TRUE, NULL);
 	data->listen_io = NULL;
 
+	DBG("Source discovered in %" G_GINT64_FORMAT " ms",
+				(g_get_monotonic_time() - req->start) / 1000);
+
+	base_cache_add(data->adapter, data->device, &base, &qos);
+
 	/* Analyze received BASE data and create remote media endpoints for each
 	 * BIS matching our capabilities
 	 */
@@ -1256,6 +1329,8 @@ static void iso_pa_sync_confirm_cb(GIOChannel *io, void *user_data)
 
 	queue_remove(data->adapter->bcast_pa_requests, req);
 	free(req);
+
+	pa_req_schedule(data->adapter);
 }
 
 static bool match_data_bap_data(const void *data, const void *match_data)
@@ -2152,52 +2227,131 @@ static void setup_listen_io(struct bap_data *data, struct bt_bap_stream *stream,
 	data->listen_io = io;
 }
 
-static void check_pa_req_in_progress(void *data, void *user_data)
+static int short_lived_pa_sync(struct bap_bcast_pa_req *req);
+static void pa_and_big_sync(struct bap_bcast_pa_req *req);
+
+static bool pa_req_cached(struct bap_bcast_pa_req *req)
 {
-	struct bap_bcast_pa_req *req = data;
+	struct bap_data *data = btd_service_get_user_data(req->data.service);
+	struct bap_base_entry *entry;
+
+	entry = base_cache_lookup(data->adapter, data->device);
+	if (!entry)
+		return false;
+
+	DBG("Using cached BASE");
+
+	parse_base(data, &entry->base, &entry->qos, bap_debug);
+
+	service_set_connecting(req->data.service);
 
-	if (req->in_progress == TRUE)
-		*((bool *)user_data) = TRUE;
+	return true;
 }
 
-static int short_lived_pa_sync(struct bap_bcast_pa_req *req);
-static void pa_and_big_sync(struct bap_bcast_pa_req *req);
+static void pa_req_schedule(struct bap_adapter *adapter)
+{
+	const struct queue_entry *entry, *next;
+	unsigned int in_progress = 0;
+	int err;
+
+	for (entry = queue_get_entries(adapter->bcast_pa_requests); entry;
+							entry = entry->next) {
+		struct bap_bcast_pa_req *req = entry->data;
+
+		if (!req->in_progress)
+			continue;
+
+		/* PA and BIG Sync needs the controller for itself, nothing
+		 * else can be started until it is done.
+		 */
+		if (req->type == BAP_PA_BIG_SYNC_REQ)
+			return;
+
+		in_progress++;
+	}
+
+	/* Pending syncs have completed, any limit reported by the controller
+	 * no longer applies.
+	 */
+	if (!in_progress)
+		adapter->pa_sync_max = PA_SYNC_MAX;
+
+	for (entry = queue_get_entries(adapter->bcast_pa_requests); entry;
+								entry = next) {
+		struct bap_bcast_pa_req *req = entry->data;
+
+		next = entry->next;
+
+		if (req->in_progress)
+			continue;
+
+		switch (req->type) {
+		case BAP_PA_SHORT_REQ:
+			if (pa_req_cached(req)) {
+				queue_remove(adapter->bcast_pa_requests, req);
+				free(req);
+				continue;
+			}
+
+			if (in_progress >= adapter->pa_sync_max)
+				return;
+
+			DBG("do short lived PA Sync");
+			err = short_lived_pa_sync(req);
+			if (err == -EBUSY) {
+				/* Controller has no sync slot left, wait for
+				 * the pending syncs to complete.
+				 */
+				adapter->pa_sync_max = MAX(in_progress, 1U);
+				return;
+			}
+
+			if (err < 0)
+				continue;
+
+			in_progress++;
+			break;
+		case BAP_PA_BIG_SYNC_REQ:
+			/* PA and BIG Sync is done with no other sync pending */
+			if (in_progress)
+				return;
+
+			DBG("do PA Sync and BIG Sync");
+			pa_and_big_sync(req);
+			return;
+		}
+	}
+}
 
 static gboolean pa_idle_timer(gpointer user_data)
 {
 	struct bap_adapter *adapter = user_data;
-	struct bap_bcast_pa_req *req;
-	bool in_progress = FALSE;
-
-	/* Handle timer if no request is in progress */
-	queue_foreach(adapter->bcast_pa_requests, check_pa_req_in_progress,
-			&in_progress);
-	if (in_progress == FALSE) {
-		req = queue_peek_head(adapter->bcast_pa_requests);
-		if (req != NULL)
-			switch (req->type) {
-			case BAP_PA_SHORT_REQ:
-				DBG("do short lived PA Sync");
-				short_lived_pa_sync(req);
-				break;
-			case BAP_PA_BIG_SYNC_REQ:
-				DBG("do PA Sync and BIG Sync");
-				pa_and_big_sync(req);
-				break;
-			}
-		else {
-			/* pa_req queue is empty, stop the timer by returning
-			 * FALSE and set the pa_timer_id to 0. This will later
-			 * be used to check if the timer is active.
-			 */
-			adapter->pa_timer_id = 0;
-			return FALSE;
-		}
+
+	if (queue_isempty(adapter->bcast_pa_requests)) {
+		/* pa_req queue is empty, stop the timer by returning
+		 * FALSE and set the pa_timer_id to 0. This will later
+		 * be used to check if the timer is active.
+		 */
+		adapter->pa_timer_id = 0;
+		return FALSE;
 	}
 
+	pa_req_schedule(adapter);
+
 	return TRUE;
 }
 
+static gboolean pa_idle_cb(gpointer user_data)
+{
+	struct bap_adapter *adapter = user_data;
+
+	adapter->pa_idle_id = 0;
+
+	pa_req_schedule(adapter);
+
+	return FALSE;
+}
+
 static void setup_accept_io_broadcast(struct bap_data *data,
 					struct bap_setup *setup)
 {
@@ -2937,11 +3091,10 @@ static int short_lived_pa_sync(struct bap_bcast_pa_req *req)
 
 	if (data->listen_io) {
 		DBG("Already probed");
-		return -1;
+		return -EALREADY;
 	}
 
 	DBG("Create PA sync with this source");
-	req->in_progress = TRUE;
 	data->listen_io = bt_io_listen(NULL, iso_pa_sync_confirm_cb, req,
 		NULL, &err,
 		BT_IO_OPT_SOURCE_BDADDR,
@@ -2956,10 +3109,15 @@ static int short_lived_pa_sync(struct bap_bcast_pa_req *req)
 		BT_IO_OPT_QOS, &bap_sink_pa_qos,
 		BT_IO_OPT_INVALID);
 	if (!data->listen_io) {
+		int ret = err->code ? -err->code : -EIO;
+
 		error("%s", err->message);
 		g_error_free(err);
+		return ret;
 	}
 
+	req->in_progress = TRUE;
+
 	return 0;
 }
 
@@ -3143,9 +3301,17 @@ static int bap_bcast_probe(struct btd_service *service)
 	req = new0(struct bap_bcast_pa_req, 1);
 	req->type = BAP_PA_SHORT_REQ;
 	req->in_progress = FALSE;
+	req->start = g_get_monotonic_time();
 	req->data.service = service;
 	queue_push_tail(data->adapter->bcast_pa_requests, req);
 
+	/* Process the request once probing is complete without waiting for
+	 * the next timer tick.
+	 */
+	if (data->adapter->pa_idle_id == 0)
+		data->adapter->pa_idle_id = g_idle_add(pa_idle_cb,
+							data->adapter);
+
 	return 0;
 }
 
@@ -3320,6 +3486,8 @@ static int bap_adapter_probe(struct btd_profile *p, struct btd_adapter *adapter)
 	if (adapters == NULL)
 		adapters = queue_new();
 	data->adapter->bcast_pa_requests = queue_new();
+	data->adapter->base_cache = queue_new();
+	data->adapter->pa_sync_max = PA_SYNC_MAX;
 	queue_push_tail(adapters, data->adapter);
 
 	return 0;
@@ -3335,7 +3503,14 @@ static void bap_adapter_remove(struct btd_profile *p,
 	ba2str(btd_adapter_get_address(adapter), addr);
 	DBG("%s", addr);
 
+	if (data->adapter->pa_timer_id)
+		g_source_remove(data->adapter->pa_timer_id);
+
+	if (data->adapter->pa_idle_id)
+		g_source_remove(data->adapter->pa_idle_id);
+
 	queue_destroy(data->adapter->bcast_pa_requests, free);
+	queue_destroy(data->adapter->base_cache, free);
 	queue_remove(adapters, data->adapter);
 	free(data->adapter);
 
@@ -37,6 +37,9 @@
 #define MEDIA_FOLDER_INTERFACE "org.bluez.MediaFolder1"
 #define MEDIA_ITEM_INTERFACE "org.bluez.MediaItem1"
 
+/* Minimum number of items fetched per GetFolderItems listing */
+#define LIST_ITEMS_WINDOW	64
+
 struct player_callback {
 	const struct media_player_callback *cbs;
 	void *user_data;
@@ -57,6 +60,7 @@ struct media_item {
 	bool			playable;	/* Item playable flag */
 	uint64_t		uid;		/* Item uid */
 	GHashTable		*metadata;	/* Item metadata */
+	bool			exported;	/* Item object registered */
 };
 
 struct media_folder {
@@ -65,6 +69,11 @@ struct media_folder {
 	uint32_t		number_of_items;/* Number of items */
 	GSList			*subfolders;
 	GSList			*items;
+	GHashTable		*index;		/* Items by uid */
+	GPtrArray		*slots;		/* Items by position */
+	uint32_t		list_start;	/* Pending list start */
+	uint32_t		list_end;	/* Pending list end */
+	bool			stale;		/* Invalidated while busy */
 	DBusMessage		*msg;
 };
 
@@ -617,12 +626,17 @@ static DBusMessage *media_player_release(DBusConnection *conn, DBusMessage *msg,
 	return g_dbus_create_reply(msg, DBUS_TYPE_INVALID);
 }
 
+static bool media_item_export(struct media_item *item);
+
 static void parse_folder_list(gpointer data, gpointer user_data)
 {
 	struct media_item *item = data;
 	DBusMessageIter *array = user_data;
 	DBusMessageIter entry;
 
+	if (!media_item_export(item))
+		return;
+
 	dbus_message_iter_open_container(array, DBUS_TYPE_DICT_ENTRY, NULL,
 								&entry);
 
@@ -635,22 +649,39 @@ static void parse_folder_list(gpointer data, gpointer user_data)
 	dbus_message_iter_close_container(array, &entry);
 }
 
-void media_player_list_complete(struct media_player *mp, GSList *items,
-								int err)
+static void media_folder_set_slot(struct media_folder *folder,
+					uint32_t pos, struct media_item *item)
 {
-	struct media_folder *folder = mp->scope;
-	DBusMessage *reply;
-	DBusMessageIter iter, array;
+	if (!folder->slots)
+		folder->slots = g_ptr_array_new();
 
-	if (folder == NULL || folder->msg == NULL)
-		return;
+	if (pos >= folder->slots->len)
+		g_ptr_array_set_size(folder->slots, pos + 1);
 
-	if (err < 0) {
-		reply = btd_error_failed(folder->msg, strerror(-err));
-		goto done;
+	g_ptr_array_index(folder->slots, pos) = item;
+}
+
+static void append_folder_slots(struct media_folder *folder, uint32_t start,
+				uint32_t end, DBusMessageIter *array)
+{
+	uint32_t i;
+
+	for (i = start; i <= end && i < folder->slots->len; i++) {
+		struct media_item *item = g_ptr_array_index(folder->slots, i);
+
+		if (item)
+			parse_folder_list(item, array);
 	}
+}
 
-	reply = dbus_message_new_method_return(folder->msg);
+static DBusMessage *list_items_reply(struct media_folder *folder,
+					DBusMessage *msg, uint32_t start,
+					uint32_t end)
+{
+	DBusMessage *reply;
+	DBusMessageIter iter, array;
+
+	reply = dbus_message_new_method_return(msg);
 
 	dbus_message_iter_init_append(reply, &iter);
 
@@ -665,13 +696,54 @@ void media_player_list_complete(struct media_player *mp, GSList *items,
 					DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
 					&array);
 
-	g_slist_foreach(items, parse_folder_list, &array);
+	if (folder->slots)
+		append_folder_slots(folder, start, end, &array);
+
 	dbus_message_iter_close_container(&iter, &array);
 
+	return reply;
+}
+
+static void media_folder_clear_items(struct media_folder *folder);
+
+void media_player_list_complete(struct media_player *mp, GSList *items,
+								int err)
+{
+	struct media_folder *folder = mp->scope;
+	DBusMessage *reply;
+	uint32_t pos;
+	GSList *l;
+
+	if (folder == NULL || folder->msg == NULL)
+		return;
+
+	if (err < 0) {
+		reply = btd_error_failed(folder->msg, strerror(-err));
+		goto done;
+	}
+
+	/* Items are received in order starting at the requested position,
+	 * with NULL standing for an item that could not be parsed.
+	 */
+	for (l = items, pos = folder->list_start; l; l = l->next, pos++)
+		media_folder_set_slot(folder, pos, l->data);
+
+	reply = list_items_reply(folder, folder->msg, folder->list_start,
+							folder->list_end);
+
 done:
 	g_dbus_send_message(btd_get_dbus_connection(), reply);
 	dbus_message_unref(folder->msg);
 	folder->msg = NULL;
+
+	/*
+	 * The contents changed while the listing was in progress so the
+	 * items just received may already be outdated, don't keep them.
+	 */
+	if (folder->stale) {
+		media_folder_clear_items(folder);
+		folder->stale = false;
+	}
 }
 
 static struct media_item *
@@ -714,6 +786,8 @@ void media_player_search_complete(struct media_player *mp, int ret)
 		mp->folders = g_slist_prepend(mp->folders, search);
 	}
 
+	/* Results of a previous search are no longer valid */
+	media_folder_clear_items(search);
 	search->number_of_items = ret;
 
 	reply = g_dbus_create_reply(folder->msg,
@@ -724,6 +798,11 @@ done:
 	g_dbus_send_message(btd_get_dbus_connection(), reply);
 	dbus_message_unref(folder->msg);
 	folder->msg = NULL;
+
+	if (folder->stale) {
+		media_folder_clear_items(folder);
+		folder->stale = false;
+	}
 }
 
 void media_player_total_items_complete(struct media_player *mp,
@@ -867,6 +946,27 @@ static int parse_filters(struct media_player *player, DBusMessageIter *iter,
 	return 0;
 }
 
+static bool media_folder_slots_cached(struct media_folder *folder,
+						uint32_t start, uint32_t end)
+{
+	uint32_t i;
+
+	/* Only trust the cache for folders with a known size */
+	if (!folder->slots || !folder->number_of_items ||
+					end >= folder->number_of_items)
+		return false;
+
+	if (end >= folder->slots->len)
+		return false;
+
+	for (i = start; i <= end; i++) {
+		if (!g_ptr_array_index(folder->slots, i))
+			return false;
+	}
+
+	return true;
+}
+
 static DBusMessage *media_folder_list_items(DBusConnection *conn,
 						DBusMessage *msg, void *data)
 {
@@ -874,7 +974,7 @@ static DBusMessage *media_folder_list_items(DBusConnection *conn,
 	struct media_folder *folder = mp->scope;
 	struct player_callback *cb = mp->cb;
 	DBusMessageIter iter;
-	uint32_t start, end;
+	uint32_t start, end, fetch_end;
 	int err;
 
 	dbus_message_iter_init(msg, &iter);
@@ -888,11 +988,32 @@ static DBusMessage *media_folder_list_items(DBusConnection *conn,
 	if (folder->msg != NULL)
 		return btd_error_failed(msg, strerror(EBUSY));
 
-	err = cb->cbs->list_items(mp, folder->item->name, start, end,
+	if (media_folder_slots_cached(folder, start, end)) {
+		DBG("%s start %u end %u cached", folder->item->name, start,
+									end);
+		return list_items_reply(folder, msg, start, end);
+	}
+
+	/*
+	 * Prefetch a window of items so consecutive pages can be served
+	 * from the cache without another round trip to the remote.
+	 */
+	fetch_end = end;
+	if (folder->number_of_items && end - start + 1 < LIST_ITEMS_WINDOW) {
+		fetch_end = start + LIST_ITEMS_WINDOW - 1;
+		if (fetch_end >= folder->number_of_items)
+			fetch_end = folder->number_of_items - 1;
+		if (fetch_end < end)
+			fetch_end = end;
+	}
+
+	err = cb->cbs->list_items(mp, folder->item->name, start, fetch_end,
 							cb->user_data);
 	if (err < 0)
 		return btd_error_failed(msg, strerror(-err));
 
+	folder->list_start = start;
+	folder->list_end = end;
 	folder->msg = dbus_message_ref(msg);
 
 	return NULL;
@@ -914,18 +1035,52 @@ static void media_item_destroy(void *data)
 
 	DBG("%s", item->path);
 
-	g_dbus_unregister_interface(btd_get_dbus_connection(), item->path,
-						MEDIA_ITEM_INTERFACE);
+	if (item->exported)
+		g_dbus_unregister_interface(btd_get_dbus_connection(),
+					item->path, MEDIA_ITEM_INTERFACE);
 
 	media_item_free(item);
 }
 
+static void media_folder_clear_items(struct media_folder *folder)
+{
+	g_slist_free_full(folder->items, media_item_destroy);
+	folder->items = NULL;
+
+	if (folder->index)
+		g_hash_table_remove_all(folder->index);
+
+	if (folder->slots)
+		g_ptr_array_set_size(folder->slots, 0);
+}
+
+static void media_folder_invalidate(struct media_folder *folder)
+{
+	/*
+	 * Items cannot be dropped while a request is pending since the
+	 * reply is built from them, mark the folder so they are dropped
+	 * once it completes.
+	 */
+	if (folder->msg != NULL) {
+		folder->stale = true;
+		return;
+	}
+
+	media_folder_clear_items(folder);
+}
+
 static void media_folder_destroy(void *data)
 {
 	struct media_folder *folder = data;
 
 	g_slist_free_full(folder->subfolders, media_folder_destroy);
-	g_slist_free_full(folder->items, media_item_destroy);
+	media_folder_clear_items(folder);
+
+	if (folder->index)
+		g_hash_table_destroy(folder->index);
+
+	if (folder->slots)
+		g_ptr_array_free(folder->slots, TRUE);
 
 	if (folder->msg != NULL)
 		dbus_message_unref(folder->msg);
@@ -956,8 +1111,7 @@ static void media_player_change_scope(struct media_player *mp,
 		goto done;
 
 cleanup:
-	g_slist_free_full(mp->scope->items, media_item_destroy);
-	mp->scope->items = NULL;
+	media_folder_clear_items(mp->scope);
 
 	/* Destroy search folder if it exists and is not being set as scope */
 	if (mp->search != NULL && folder != mp->search) {
@@ -1563,19 +1717,39 @@ void media_player_set_playlist(struct media_player *mp, const char *name)
 static struct media_item *media_folder_find_item(struct media_folder *folder,
 								uint64_t uid)
 {
-	GSList *l;
-
-	if (uid == 0)
+	if (uid == 0 || folder->index == NULL)
 		return NULL;
 
-	for (l = folder->items; l; l = l->next) {
-		struct media_item *item = l->data;
+	return g_hash_table_lookup(folder->index, &uid);
+}
 
-		if (item->uid == uid)
-			return item;
-	}
+void media_player_set_uid_counter(struct media_player *mp, uint16_t counter)
+{
+	struct media_folder *folder = mp->scope;
 
-	return NULL;
+	DBG("uid counter %u", counter);
+
+	/*
+	 * UIDs are no longer valid once the counter changes so drop the
+	 * cached items, they are going to be fetched again on the next
+	 * listing.
+	 */
+	if (folder != NULL)
+		media_folder_invalidate(folder);
+
+	if (mp->playlist != NULL && mp->playlist != folder)
+		media_folder_invalidate(mp->playlist);
+
+	if (mp->search != NULL && mp->search != folder)
+		media_folder_invalidate(mp->search);
+}
+
+void media_player_playlist_changed(struct media_player *mp)
+{
+	DBG("");
+
+	if (mp->playlist != NULL)
+		media_folder_invalidate(mp->playlist);
 }
 
 static DBusMessage *media_item_play(DBusConnection *conn, DBusMessage *msg,
@@ -1839,6 +2013,28 @@ void media_item_set_playable(struct media_item *item, bool value)
 					MEDIA_ITEM_INTERFACE, "Playable");
 }
 
+static bool media_item_export(struct media_item *item)
+{
+	if (item->exported)
+		return true;
+
+	if (!g_dbus_register_interface(btd_get_dbus_connection(),
+					item->path, MEDIA_ITEM_INTERFACE,
+					media_item_methods,
+					NULL,
+					media_item_properties, item, NULL)) {
+		error("D-Bus failed to register %s on %s path",
+					MEDIA_ITEM_INTERFACE, item->path);
+		return false;
+	}
+
+	item->exported = true;
+
+	DBG("%s", item->path);
+
+	return true;
+}
+
 static struct media_item *media_folder_create_item(struct media_player *mp,
 						struct media_folder *folder,
 						const char *name,
@@ -1872,21 +2068,29 @@ static struct media_item *media_folder_create_item(struct media_player *mp,
 	item->type = type;
 	item->folder_type = PLAYER_FOLDER_TYPE_INVALID;
 
-	if (!g_dbus_register_interface(btd_get_dbus_connection(),
-					item->path, MEDIA_ITEM_INTERFACE,
-					media_item_methods,
-					NULL,
-					media_item_properties, item, NULL)) {
-		error("D-Bus failed to register %s on %s path",
-					MEDIA_ITEM_INTERFACE, item->path);
-		media_item_free(item);
-		return NULL;
+	/*
+	 * Folders are referenced by path so they are registered right away,
+	 * other items are only registered once they are listed.
+	 */
+	if (type == PLAYER_ITEM_TYPE_FOLDER) {
+		if (!media_item_export(item)) {
+			media_item_free(item);
+			return NULL;
+		}
+
+		return item;
 	}
 
-	if (type != PLAYER_ITEM_TYPE_FOLDER) {
-		folder->items = g_slist_prepend(folder->items, item);
-		item->metadata = g_hash_table_new_full(g_str_hash, g_str_equal,
+	folder->items = g_slist_prepend(folder->items, item);
+	item->metadata = g_hash_table_new_full(g_str_hash, g_str_equal,
 							g_free, g_free);
+
+	if (uid) {
+		if (!folder->index)
+			folder->index = g_hash_table_new(g_int64_hash,
+							g_int64_equal);
+
+		g_hash_table_insert(folder->index, &item->uid, item);
 	}
 
 	DBG("%s", item->path);
@@ -1979,7 +2183,7 @@ struct media_item *media_player_set_playlist_item(struct media_player *mp,
 
 	item = media_folder_create_item(mp, folder, NULL,
 						PLAYER_ITEM_TYPE_AUDIO, uid);
-	if (item == NULL)
+	if (item == NULL || !media_item_export(item))
 		return NULL;
 
 	media_item_set_playable(item, true);
@@ -341,6 +341,9 @@ struct btd_adapter {
 
 	struct queue *exp_pending;
 	struct queue *exps;
+
+	bool startup_done;		/* Startup timeline has been logged */
+	unsigned int startup_loads;	/* Key and parameter loads pending */
 };
 
 static char *adapter_power_state_str(uint32_t power_state)
@@ -596,6 +599,45 @@ static void store_adapter_info(struct btd_adapter *adapter)
 static void trigger_pairable_timeout(struct btd_adapter *adapter);
 static void adapter_start(struct btd_adapter *adapter);
 static void adapter_stop(struct btd_adapter *adapter);
+
+static void startup_mark(struct btd_adapter *adapter, const char *phase)
+{
+	if (!adapter->startup_done)
+		btd_timeline_mark(adapter->dev_id, "%s", phase);
+}
+
+/*
+ * Startup is considered done once the adapter is powered and the keys and
+ * connection parameters read from storage have been loaded into the kernel.
+ */
+static void startup_check(struct btd_adapter *adapter)
+{
+	if (adapter->startup_done || adapter->startup_loads)
+		return;
+
+	if (!(adapter->current_settings & MGMT_SETTING_POWERED))
+		return;
+
+	adapter->startup_done = true;
+	btd_timeline_dump(adapter->dev_id);
+}
+
+static void startup_load_sent(struct btd_adapter *adapter)
+{
+	if (!adapter->startup_done)
+		adapter->startup_loads++;
+}
+
+static void startup_load_done(struct btd_adapter *adapter, const char *phase)
+{
+	if (adapter->startup_done || !adapter->startup_loads)
+		return;
+
+	startup_mark(adapter, phase);
+
+	adapter->startup_loads--;
+	startup_check(adapter);
+}
 static void trigger_passive_scanning(struct btd_adapter *adapter);
 static bool set_mode(struct btd_adapter *adapter, uint16_t opcode,
 							uint8_t mode);
@@ -635,6 +677,10 @@ static void settings_changed(struct btd_adapter *adapter, uint32_t settings)
 				(adapter->current_settings & MGMT_SETTING_LE))
 		trigger_passive_scanning(adapter);
 
+	if ((changed_mask & MGMT_SETTING_CONNECTABLE) &&
+			(adapter->current_settings & MGMT_SETTING_CONNECTABLE))
+		startup_mark(adapter, "connectable");
+
 	if (changed_mask & MGMT_SETTING_DISCOVERABLE) {
 		g_dbus_emit_property_changed(dbus_conn, adapter->path,
 					ADAPTER_INTERFACE, "Discoverable");
@@ -4310,6 +4356,7 @@ static void load_link_keys_complete(uint8_t status, uint16_t length,
 			goto done;
 		}
 
+		startup_load_done(adapter, "link keys load failed");
 		return;
 	}
 
@@ -4318,6 +4365,8 @@ static void load_link_keys_complete(uint8_t status, uint16_t length,
 done:
 	g_slist_free_full(adapter->load_keys, g_free);
 	adapter->load_keys = NULL;
+
+	startup_load_done(adapter, "link keys loaded");
 }
 
 static void load_link_keys(struct btd_adapter *adapter, bool debug_keys,
@@ -4392,7 +4441,10 @@ static void load_link_keys(struct btd_adapter *adapter, bool debug_keys,
 							adapter->dev_id);
 		g_slist_free_full(adapter->load_keys, g_free);
 		adapter->load_keys = NULL;
+		return;
 	}
+
+	startup_load_sent(adapter);
 }
 
 static void load_ltks_complete(uint8_t status, uint16_t length,
@@ -4407,6 +4459,9 @@ static void load_ltks_complete(uint8_t status, uint16_t length,
 	}
 
 	DBG("LTKs loaded for hci%u", adapter->dev_id);
+
+	startup_load_done(adapter, status == MGMT_STATUS_SUCCESS ?
+					"LTKs loaded" : "LTKs load failed");
 }
 
 static void load_ltks(struct btd_adapter *adapter, GSList *keys)
@@ -4488,6 +4543,8 @@ static void load_ltks(struct btd_adapter *adapter, GSList *keys)
 			adapter, NULL, 2))
 		btd_error(adapter->dev_id, "Failed to load LTKs for hci%u",
 							adapter->dev_id);
+	else
+		startup_load_sent(adapter);
 
 	g_free(cp);
 }
@@ -4497,6 +4554,9 @@ static void load_irks_complete(uint8_t status, uint16_t length,
 {
 	struct btd_adapter *adapter = user_data;
 
+	startup_load_done(adapter, status == MGMT_STATUS_SUCCESS ?
+					"IRKs loaded" : "IRKs load failed");
+
 	if (status == MGMT_STATUS_UNKNOWN_COMMAND) {
 		btd_info(adapter->dev_id,
 			"Load IRKs failed: Kernel doesn't support LE Privacy");
@@ -4565,6 +4625,8 @@ static void load_irks(struct btd_adapter *adapter, GSList *irks)
 	if (id == 0)
 		btd_error(adapter->dev_id, "Failed to IRKs for hci%u",
 							adapter->dev_id);
+	else
+		startup_load_sent(adapter);
 }
 
 static void load_conn_params_complete(uint8_t status, uint16_t length,
@@ -4572,6 +4634,10 @@ static void load_conn_params_complete(uint8_t status, uint16_t length,
 {
 	struct btd_adapter *adapter = user_data;
 
+	startup_load_done(adapter, status == MGMT_STATUS_SUCCESS ?
+				"connection parameters loaded" :
+				"connection parameters load failed");
+
 	if (status != MGMT_STATUS_SUCCESS) {
 		btd_error(adapter->dev_id,
 			"hci%u Load Connection Parameters failed: %s (0x%02x)",
@@ -4631,6 +4697,8 @@ static void load_conn_params(struct btd_adapter *adapter, GSList *params)
 
 	if (id == 0)
 		btd_error(adapter->dev_id, "Load connection parameters failed");
+	else
+		startup_load_sent(adapter);
 }
 
 void btd_adapter_load_conn_param(struct btd_adapter *adapter,
@@ -5068,6 +5136,8 @@ free:
 
 	closedir(dir);
 
+	startup_mark(adapter, "devices loaded");
+
 	load_link_keys(adapter, btd_opts.debug_keys, false);
 
 	load_ltks(adapter, ltks);
@@ -5791,6 +5861,9 @@ static void adapter_start(struct btd_adapter *adapter)
 	DBG("adapter %s has been enabled", adapter->path);
 
 	trigger_passive_scanning(adapter);
+
+	startup_mark(adapter, "powered");
+	startup_check(adapter);
 }
 
 static void reply_pending_requests(struct btd_adapter *adapter)
@@ -5871,6 +5944,9 @@ static void adapter_free(gpointer user_data)
 
 	DBG("%p", adapter);
 
+	if (!adapter->startup_done)
+		btd_timeline_clear(adapter->dev_id);
+
 	/* Make sure the adapter's discovery list is cleaned up before freeing
 	 * the adapter.
 	 */
@@ -7213,7 +7289,7 @@ void btd_adapter_device_found(struct btd_adapter *adapter,
 					bool monitoring)
 {
 	struct btd_device *dev;
-	struct bt_ad *ad = NULL;
+	struct bt_ad_view view;
 	struct eir_data eir_data;
 	bool name_known, discoverable;
 	char addr[18];
@@ -7234,18 +7310,15 @@ void btd_adapter_device_found(struct btd_adapter *adapter,
 	if (!btd_adv_monitor_offload_enabled(adapter->adv_monitor_manager) ||
 				(MGMT_VERSION(mgmt_version, mgmt_revision) <
 							MGMT_VERSION(1, 22))) {
-		if (bdaddr_type != BDADDR_BREDR)
-			ad = bt_ad_new_with_data(data_len, data);
-
 		/* During the background scanning, update the device only when
-		 * the data match at least one Adv monitor
+		 * the data match at least one Adv monitor. The data is matched
+		 * in place to avoid allocating for every report received.
 		 */
-		if (ad) {
+		if (bdaddr_type != BDADDR_BREDR &&
+				bt_ad_view_init(&view, data, data_len)) {
 			matched_monitors = btd_adv_monitor_content_filter(
 						adapter->adv_monitor_manager,
-						ad);
-			bt_ad_unref(ad);
-			ad = NULL;
+						&view);
 			monitoring = matched_monitors ? true : false;
 		}
 	}
@@ -10166,6 +10239,8 @@ static void read_info_complete(uint8_t status, uint16_t length,
 		goto failed;
 	}
 
+	startup_mark(adapter, "read info complete");
+
 	/*
 	 * Store controller information for class of device, device
 	 * name, short name and settings.
@@ -10274,6 +10349,8 @@ static void read_info_complete(uint8_t status, uint16_t length,
 		goto failed;
 	}
 
+	startup_mark(adapter, "registered");
+
 	/*
 	 * Register all event notification handlers for controller.
 	 *
@@ -10411,6 +10488,8 @@ static void read_info_complete(uint8_t status, uint16_t length,
 	if (adapter->stored_discoverable && !adapter->discoverable_timeout)
 		set_discoverable(adapter, 0x01, 0);
 
+	startup_mark(adapter, "init commands sent");
+
 	if (btd_adapter_get_powered(adapter))
 		adapter_start(adapter);
 
@@ -10472,6 +10551,8 @@ static void read_info(struct btd_adapter *adapter)
 {
 	DBG("sending read info command for index %u", adapter->dev_id);
 
+	startup_mark(adapter, "read info");
+
 	if (mgmt_send(mgmt_primary, MGMT_OP_READ_INFO, adapter->dev_id, 0, NULL,
 					read_info_complete, adapter, NULL) > 0)
 		return;
@@ -10535,6 +10616,8 @@ static void index_added(uint16_t index, uint16_t length, const void *param,
 		return;
 	}
 
+	startup_mark(adapter, "index added");
+
 	if (btd_has_kernel_features(KERNEL_EXP_FEATURES))
 		read_exp_features(adapter);
 
@@ -10593,6 +10676,8 @@ static void read_index_list_complete(uint8_t status, uint16_t length,
 
 	DBG("Number of controllers: %d", num);
 
+	btd_timeline_mark(MGMT_INDEX_NONE, "mgmt index list");
+
 	if (num * sizeof(uint16_t) + sizeof(*rp) != length) {
 		error("Incorrect packet size for index list response");
 		return;
@@ -10692,6 +10777,8 @@ static void read_commands_complete(uint8_t status, uint16_t length,
 			break;
 		}
 	}
+
+	btd_timeline_mark(MGMT_INDEX_NONE, "mgmt commands");
 }
 
 static void read_version_complete(uint8_t status, uint16_t length,
@@ -10721,6 +10808,8 @@ static void read_version_complete(uint8_t status, uint16_t length,
 		abort();
 	}
 
+	btd_timeline_mark(MGMT_INDEX_NONE, "mgmt version");
+
 	DBG("sending read supported commands command");
 
 	/*
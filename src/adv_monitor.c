@@ -165,7 +165,7 @@ struct app_match_data {
 };
 
 struct adv_content_filter_info {
-	struct bt_ad *ad;
+	const struct bt_ad_view *view;
 	struct queue *matched_monitors;	/* List of matched monitors */
 };
 
@@ -1862,7 +1862,7 @@ static void adv_match_per_monitor(void *data, void *user_data)
 
 	patterns = monitor->merged_pattern->patterns;
 	if (monitor->merged_pattern->type == MONITOR_TYPE_OR_PATTERNS &&
-				bt_ad_pattern_match(info->ad, patterns)) {
+				bt_ad_view_pattern_match(info->view, patterns)) {
 		goto matched;
 	}
 
@@ -1895,14 +1895,14 @@ static void adv_match_per_app(void *data, void *user_data)
  */
 struct queue *btd_adv_monitor_content_filter(
 				struct btd_adv_monitor_manager *manager,
-				struct bt_ad *ad)
+				const struct bt_ad_view *view)
 {
 	struct adv_content_filter_info info;
 
-	if (!manager || !ad)
+	if (!manager || !view)
 		return NULL;
 
-	info.ad = ad;
+	info.view = view;
 	info.matched_monitors = NULL;
 
 	queue_foreach(manager->apps, adv_match_per_app, &info);
@@ -21,6 +21,7 @@ struct btd_device;
 struct btd_adapter;
 struct btd_adv_monitor_manager;
 struct btd_adv_monitor_pattern;
+struct bt_ad_view;
 
 struct btd_adv_monitor_manager *btd_adv_monitor_manager_create(
 						struct btd_adapter *adapter,
@@ -31,7 +32,7 @@ bool btd_adv_monitor_offload_enabled(struct btd_adv_monitor_manager *manager);
 
 struct queue *btd_adv_monitor_content_filter(
 				struct btd_adv_monitor_manager *manager,
-				struct bt_ad *ad);
+				const struct bt_ad_view *view);
 
 void btd_adv_monitor_notify_monitors(struct btd_adv_monitor_manager *manager,
 					struct btd_device *device, int8_t rssi,
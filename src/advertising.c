@@ -54,6 +54,8 @@ struct btd_adv_manager {
 	bool extended_add_cmds;
 	int8_t min_tx_power;
 	int8_t max_tx_power;
+	unsigned int refreshes;
+	unsigned int refreshes_suppressed;
 };
 
 #define AD_TYPE_BROADCAST 0
@@ -64,6 +66,11 @@ struct btd_adv_manager {
  */
 #define ADV_TX_POWER_NO_PREFERENCE 0x7F
 
+/* Property changes arriving within this window are merged into a single
+ * refresh of the advertising instance.
+ */
+#define ADV_REFRESH_DELAY 50
+
 struct btd_adv_client {
 	struct btd_adv_manager *manager;
 	char *owner;
@@ -75,6 +82,7 @@ struct btd_adv_client {
 	uint16_t discoverable_to;
 	unsigned int to_id;
 	unsigned int disc_to_id;
+	unsigned int refresh_id;
 	unsigned int add_adv_id;
 	GDBusClient *client;
 	GDBusProxy *proxy;
@@ -88,6 +96,9 @@ struct btd_adv_client {
 	uint32_t max_interval;
 	int8_t tx_power;
 	mgmt_request_func_t refresh_done_func;
+	bool refresh_deferred;
+	uint8_t *programmed;
+	size_t programmed_len;
 };
 
 struct dbus_obj_match {
@@ -119,6 +130,9 @@ static void client_free(void *data)
 	if (client->disc_to_id > 0)
 		timeout_remove(client->disc_to_id);
 
+	if (client->refresh_id > 0)
+		timeout_remove(client->refresh_id);
+
 	if (client->client) {
 		g_dbus_client_set_disconnect_watch(client->client, NULL, NULL);
 		g_dbus_client_unref(client->client);
@@ -152,6 +166,7 @@ static void client_free(void *data)
 	if (client->path)
 		g_free(client->path);
 
+	free(client->programmed);
 	free(client->name);
 	free(client);
 }
@@ -894,6 +909,82 @@ static int get_adv_flags(struct btd_adv_client *client)
 	return flags;
 }
 
+static void clear_programmed(struct btd_adv_client *client)
+{
+	free(client->programmed);
+	client->programmed = NULL;
+	client->programmed_len = 0;
+}
+
+/* Record what is about to be programmed for the instance and return true if
+ * it differs from what was programmed last.
+ */
+static bool update_programmed(struct btd_adv_client *client,
+					const void *data, size_t len)
+{
+	if (client->programmed && client->programmed_len == len &&
+				!memcmp(client->programmed, data, len))
+		return false;
+
+	clear_programmed(client);
+
+	client->programmed = util_memdup(data, len);
+	if (client->programmed)
+		client->programmed_len = len;
+
+	return true;
+}
+
+/* Record the TX power granted by the kernel, which is written back to the
+ * client, so the refresh it triggers compares equal when nothing else changed.
+ */
+static void programmed_set_tx_power(struct btd_adv_client *client,
+							int8_t tx_power)
+{
+	struct mgmt_cp_add_ext_adv_params *cp = (void *) client->programmed;
+
+	if (!cp || client->programmed_len < sizeof(*cp))
+		return;
+
+	cp->tx_power = tx_power;
+	cp->flags |= cpu_to_le32(MGMT_ADV_PARAM_TX_POWER);
+}
+
+static void refresh_adv_callback(uint8_t status, uint16_t length,
+					const void *param, void *user_data)
+{
+	struct btd_adv_client *client = user_data;
+
+	client->add_adv_id = 0;
+
+	if (!status)
+		return;
+
+	error("Failed to refresh advertisement: %s (0x%02x)",
+						mgmt_errstr(status), status);
+
+	/* Nothing reliable is known about the instance contents anymore */
+	clear_programmed(client);
+}
+
+static bool refresh_suppressed(struct btd_adv_client *client, bool changed,
+					mgmt_request_func_t func)
+{
+	/* Registration always goes to the kernel */
+	if (func || changed) {
+		client->manager->refreshes++;
+		return false;
+	}
+
+	client->manager->refreshes_suppressed++;
+
+	DBG("Advertisement unchanged: %s (%u issued, %u suppressed)",
+				client->path, client->manager->refreshes,
+				client->manager->refreshes_suppressed);
+
+	return true;
+}
+
 static int refresh_legacy_adv(struct btd_adv_client *client,
 				mgmt_request_func_t func)
 {
@@ -947,17 +1038,32 @@ static int refresh_legacy_adv(struct btd_adv_client *client,
 	free(adv_data);
 	free(scan_rsp);
 
+	if (refresh_suppressed(client,
+				update_programmed(client, cp, param_len),
+				func)) {
+		free(cp);
+		return 0;
+	}
+
+	/* Only the latest contents matter if a refresh is still pending,
+	 * registration never overlaps with refreshes so anything pending was
+	 * issued by a previous refresh.
+	 */
+	if (!func && client->add_adv_id)
+		mgmt_cancel(client->manager->mgmt, client->add_adv_id);
+
 	mgmt_ret = mgmt_send(client->manager->mgmt, MGMT_OP_ADD_ADVERTISING,
 			client->manager->mgmt_index, param_len, cp,
-			func, client, NULL);
+			func ? func : refresh_adv_callback, client, NULL);
 
 	if (!mgmt_ret) {
 		error("Failed to add Advertising Data");
+		clear_programmed(client);
 		free(cp);
 		return -EINVAL;
 	}
-	if (func)
-		client->add_adv_id = mgmt_ret;
+
+	client->add_adv_id = mgmt_ret;
 
 	free(cp);
 
@@ -967,6 +1073,55 @@ static int refresh_legacy_adv(struct btd_adv_client *client,
 static void add_adv_params_callback(uint8_t status, uint16_t length,
 				    const void *param, void *user_data);
 
+/* Compare the parameters together with the data that add_adv_params_callback
+ * is going to generate, so an unchanged instance can be left alone.
+ */
+static bool ext_adv_changed(struct btd_adv_client *client,
+				const struct mgmt_cp_add_ext_adv_params *cp)
+{
+	uint8_t *adv_data, *scan_rsp = NULL, *buf;
+	size_t adv_data_len, scan_rsp_len = 0;
+	uint32_t flags;
+	bool changed = true;
+
+	flags = get_adv_flags(client);
+
+	adv_data = generate_adv_data(client, &flags, &adv_data_len);
+	if (!adv_data)
+		goto fail;
+
+	if (adv_client_has_scan_response(client, flags)) {
+		scan_rsp = generate_scan_rsp(client, &flags, &scan_rsp_len);
+		if (!scan_rsp && scan_rsp_len)
+			goto fail;
+	}
+
+	buf = malloc(sizeof(*cp) + adv_data_len + scan_rsp_len);
+	if (!buf)
+		goto fail;
+
+	memcpy(buf, cp, sizeof(*cp));
+	memcpy(buf + sizeof(*cp), adv_data, adv_data_len);
+	if (scan_rsp)
+		memcpy(buf + sizeof(*cp) + adv_data_len, scan_rsp,
+							scan_rsp_len);
+
+	changed = update_programmed(client, buf,
+				sizeof(*cp) + adv_data_len + scan_rsp_len);
+
+	free(buf);
+	goto done;
+
+fail:
+	clear_programmed(client);
+
+done:
+	free(adv_data);
+	free(scan_rsp);
+
+	return changed;
+}
+
 static int refresh_extended_adv(struct btd_adv_client *client,
 				mgmt_request_func_t func)
 {
@@ -1010,12 +1165,23 @@ static int refresh_extended_adv(struct btd_adv_client *client,
 
 	cp.flags = cpu_to_le32(flags);
 
+	if (refresh_suppressed(client, ext_adv_changed(client, &cp), func))
+		return 0;
+
+	/* Only the latest contents matter if a refresh is still pending,
+	 * registration never overlaps with refreshes so anything pending was
+	 * issued by a previous refresh.
+	 */
+	if (!func && client->add_adv_id)
+		mgmt_cancel(client->manager->mgmt, client->add_adv_id);
+
 	mgmt_ret = mgmt_send(client->manager->mgmt, MGMT_OP_ADD_EXT_ADV_PARAMS,
 			client->manager->mgmt_index, sizeof(cp), &cp,
 			add_adv_params_callback, client, NULL);
 
 	if (!mgmt_ret) {
 		error("Failed to request extended advertising parameters");
+		clear_programmed(client);
 		return -EINVAL;
 	}
 
@@ -1029,12 +1195,43 @@ static int refresh_extended_adv(struct btd_adv_client *client,
 static int refresh_advertisement(struct btd_adv_client *client,
 					mgmt_request_func_t func)
 {
+	/* Leave the commands of a pending registration alone, the refresh is
+	 * done once the registration completes.
+	 */
+	if (!func && client->reg) {
+		client->refresh_deferred = true;
+		return 0;
+	}
+
 	if (client->manager->extended_add_cmds)
 		return refresh_extended_adv(client, func);
 
 	return refresh_legacy_adv(client, func);
 }
 
+static bool client_refresh_timeout(void *user_data)
+{
+	struct btd_adv_client *client = user_data;
+
+	client->refresh_id = 0;
+
+	refresh_advertisement(client, NULL);
+
+	return false;
+}
+
+static void schedule_refresh(struct btd_adv_client *client)
+{
+	if (client->refresh_id)
+		return;
+
+	client->refresh_id = timeout_add(ADV_REFRESH_DELAY,
+						client_refresh_timeout,
+						client, NULL);
+	if (!client->refresh_id)
+		refresh_advertisement(client, NULL);
+}
+
 static bool client_discoverable_timeout(void *user_data)
 {
 	struct btd_adv_client *client = user_data;
@@ -1243,7 +1440,7 @@ static void properties_changed(GDBusProxy *proxy, const char *name,
 			continue;
 
 		if (parser->func(iter, client)) {
-			refresh_advertisement(client, NULL);
+			schedule_refresh(client);
 
 			break;
 		}
@@ -1277,6 +1474,11 @@ static void add_client_complete(struct btd_adv_client *client, uint8_t status)
 	g_dbus_send_message(btd_get_dbus_connection(), reply);
 	dbus_message_unref(client->reg);
 	client->reg = NULL;
+
+	if (!status && client->refresh_deferred) {
+		client->refresh_deferred = false;
+		refresh_advertisement(client, NULL);
+	}
 }
 
 static void add_adv_callback(uint8_t status, uint16_t length,
@@ -1287,8 +1489,10 @@ static void add_adv_callback(uint8_t status, uint16_t length,
 
 	client->add_adv_id = 0;
 
-	if (status)
+	if (status) {
+		clear_programmed(client);
 		goto done;
+	}
 
 	if (!param || length < sizeof(*rp)) {
 		status = MGMT_STATUS_FAILED;
@@ -1345,9 +1549,11 @@ static void add_adv_params_callback(uint8_t status, uint16_t length,
 
 	/* Update tx power held by client */
 	tx_power = rp->tx_power;
-	if (tx_power != ADV_TX_POWER_NO_PREFERENCE)
+	if (tx_power != ADV_TX_POWER_NO_PREFERENCE) {
 		g_dbus_proxy_set_property_basic(client->proxy, "TxPower",
 				DBUS_TYPE_INT16, &tx_power, NULL, NULL, NULL);
+		programmed_set_tx_power(client, tx_power);
+	}
 
 	client->instance = rp->instance;
 
@@ -1393,9 +1599,11 @@ static void add_adv_params_callback(uint8_t status, uint16_t length,
 	/* Submit request to update instance data */
 	mgmt_ret = mgmt_send(client->manager->mgmt, MGMT_OP_ADD_EXT_ADV_DATA,
 			     client->manager->mgmt_index, param_len, cp,
-			     client->refresh_done_func, client, NULL);
+			     client->refresh_done_func ?
+			     client->refresh_done_func : refresh_adv_callback,
+			     client, NULL);
 
-	if (mgmt_ret && client->refresh_done_func)
+	if (mgmt_ret)
 		client->add_adv_id = mgmt_ret;
 
 	/* Clear the callback */
@@ -1424,6 +1632,9 @@ fail:
 	if (!status)
 		status = -EINVAL;
 
+	/* Nothing reliable is known about the instance contents anymore */
+	clear_programmed(client);
+
 	/* Failure for any reason ends this advertising request */
 	add_client_complete(client, status);
 }
@@ -1850,6 +2061,9 @@ static void manager_destroy(void *user_data)
 {
 	struct btd_adv_manager *manager = user_data;
 
+	DBG("Advertising refreshes: %u issued, %u suppressed",
+			manager->refreshes, manager->refreshes_suppressed);
+
 	queue_destroy(manager->clients, client_destroy);
 
 	mgmt_unref(manager->mgmt);
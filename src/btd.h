@@ -168,3 +168,8 @@ GKeyFile *btd_get_main_conf(void);
 bool btd_kernel_experimental_enabled(const char *uuid);
 
 void btd_exit(void);
+
+void btd_timeline_mark(uint16_t index, const char *format, ...)
+					__attribute__((format(printf, 2, 3)));
+void btd_timeline_dump(uint16_t index);
+void btd_timeline_clear(uint16_t index);
@@ -4083,13 +4083,21 @@ static void device_add_gatt_services(struct btd_device *device)
 
 static void device_accept_gatt_profiles(struct btd_device *device)
 {
+	struct bt_gatt_client *client;
 	GSList *l;
 	bool initiator = btd_device_is_initiator(device);
 
 	DBG("initiator %s", initiator ? "true" : "false");
 
+	/* Let the initial reads of all profiles be coalesced */
+	client = bt_gatt_client_ref(device->client);
+	bt_gatt_client_read_batch_begin(client);
+
 	for (l = device->services; l != NULL; l = g_slist_next(l))
 		service_accept(l->data, initiator);
+
+	bt_gatt_client_read_batch_end(client);
+	bt_gatt_client_unref(client);
 }
 
 static void device_remove_gatt_service(struct btd_device *device,
@@ -7150,6 +7158,61 @@ const sdp_record_t *btd_device_get_record(struct btd_device *device,
 	return find_record_in_list(device->tmp_records, uuid);
 }
 
+void btd_device_update_record(struct btd_device *device, const char *uuid,
+							sdp_record_t *rec)
+{
+	char srcaddr[18], dstaddr[18];
+	char filename[PATH_MAX];
+	char handle_str[11];
+	GKeyFile *key_file;
+	GError *gerr = NULL;
+	sdp_record_t *old;
+	char *data;
+	gsize length = 0;
+
+	old = (sdp_record_t *) btd_device_get_record(device, uuid);
+	if (old) {
+		device->tmp_records = sdp_list_remove(device->tmp_records,
+									old);
+		sprintf(handle_str, "0x%8.8X", old->handle);
+		sdp_record_free(old);
+	}
+
+	device->tmp_records = sdp_list_append(device->tmp_records,
+							sdp_copy_record(rec));
+
+	ba2str(btd_adapter_get_address(device->adapter), srcaddr);
+	ba2str(&device->bdaddr, dstaddr);
+
+	create_filename(filename, PATH_MAX, "/%s/cache/%s", srcaddr,
+								dstaddr);
+	create_file(filename, 0600);
+
+	key_file = g_key_file_new();
+	if (!g_key_file_load_from_file(key_file, filename, 0, &gerr)) {
+		error("Unable to load key file from %s: (%s)", filename,
+								gerr->message);
+		g_clear_error(&gerr);
+	}
+
+	if (old)
+		g_key_file_remove_key(key_file, "ServiceRecords", handle_str,
+									NULL);
+
+	store_sdp_record(key_file, rec);
+
+	data = g_key_file_to_data(key_file, &length, NULL);
+	if (length > 0 && !g_file_set_contents(filename, data, length,
+								&gerr)) {
+		error("Unable set contents for %s: (%s)", filename,
+								gerr->message);
+		g_clear_error(&gerr);
+	}
+
+	g_free(data);
+	g_key_file_free(key_file);
+}
+
 struct btd_device *btd_device_ref(struct btd_device *device)
 {
 	__sync_fetch_and_add(&device->ref_count, 1);
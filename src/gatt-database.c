@@ -16,6 +16,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <unistd.h>
+#include <time.h>
 
 #include "lib/bluetooth.h"
 #include "lib/sdp.h"
@@ -26,6 +27,7 @@
 #include "src/shared/util.h"
 #include "src/shared/queue.h"
 #include "src/shared/io.h"
+#include "src/shared/timeout.h"
 #include "src/shared/att.h"
 #include "src/shared/gatt-db.h"
 #include "src/shared/gatt-server.h"
@@ -110,11 +112,32 @@ struct external_profile {
 	struct queue *profiles; /* btd_profile list */
 };
 
+/* Datagrams read from a notify socket per wakeup */
+#define NOTIFY_READ_MAX		32
+/* Interval to retry sending a conflated value while congested */
+#define NOTIFY_RETRY_MS		10
+
 struct client_io {
 	struct bt_att *att;
 	struct external_chrc *chrc;
 	unsigned int disconn_id;
 	struct io *io;
+	unsigned int pending_id;
+	uint8_t pending[BT_ATT_MAX_VALUE_LEN];
+	size_t pending_len;
+};
+
+/* Value of an external attribute answered without calling ReadValue */
+struct value_cache {
+	bool enabled;
+	bool valid;
+	unsigned int generation;	/* Bumped whenever Value changes */
+	uint16_t max_age;
+	struct timespec updated;
+	uint8_t *value;
+	size_t len;
+	unsigned int hits;
+	unsigned int misses;
 };
 
 struct external_chrc {
@@ -133,8 +156,12 @@ struct external_chrc {
 	struct queue *pending_reads;
 	struct queue *pending_writes;
 	unsigned int ntfy_cnt;
+	bool ntfy_conflate;
+	unsigned int ntfy_conflated;
+	unsigned int ntfy_dropped;
 	bool prep_authorized;
 	bool req_prep_authorization;
+	struct value_cache cache;
 };
 
 struct external_desc {
@@ -148,6 +175,7 @@ struct external_desc {
 	struct queue *pending_writes;
 	bool prep_authorized;
 	bool req_prep_authorization;
+	struct value_cache cache;
 };
 
 struct pending_op {
@@ -158,6 +186,8 @@ struct pending_op {
 	uint8_t link_type;
 	struct gatt_db_attribute *attrib;
 	struct queue *owner_queue;
+	struct value_cache *cache;
+	unsigned int cache_generation;
 	struct iovec data;
 	bool is_characteristic;
 	bool prep_authorize;
@@ -474,12 +504,28 @@ static void client_io_free(void *data)
 {
 	struct client_io *client = data;
 
+	/* Conflated value that never made it to the remote */
+	if (client->pending_id) {
+		timeout_remove(client->pending_id);
+		client->chrc->ntfy_dropped++;
+	}
+
 	bt_att_unregister_disconnect(client->att, client->disconn_id);
 	bt_att_unref(client->att);
 	io_destroy(client->io);
 	free(client);
 }
 
+static void value_cache_free(struct value_cache *cache, const char *path)
+{
+	if (!cache->enabled)
+		return;
+
+	DBG("%s cache hits %u misses %u", path, cache->hits, cache->misses);
+
+	free(cache->value);
+}
+
 static void chrc_free(void *data)
 {
 	struct external_chrc *chrc = data;
@@ -487,9 +533,14 @@ static void chrc_free(void *data)
 	queue_destroy(chrc->write_ios, client_io_free);
 	queue_destroy(chrc->notify_ios, client_io_free);
 
+	if (chrc->ntfy_conflate)
+		DBG("%s notify conflated %u dropped %u", chrc->path,
+				chrc->ntfy_conflated, chrc->ntfy_dropped);
+
 	queue_destroy(chrc->pending_reads, cancel_pending_read);
 	queue_destroy(chrc->pending_writes, cancel_pending_write);
 
+	value_cache_free(&chrc->cache, chrc->path);
 	g_free(chrc->path);
 
 	g_dbus_proxy_set_property_watch(chrc->proxy, NULL, NULL);
@@ -505,6 +556,12 @@ static void desc_free(void *data)
 	queue_destroy(desc->pending_reads, cancel_pending_read);
 	queue_destroy(desc->pending_writes, cancel_pending_write);
 
+	if (desc->proxy) {
+		value_cache_free(&desc->cache,
+				g_dbus_proxy_get_path(desc->proxy));
+		g_dbus_proxy_set_property_watch(desc->proxy, NULL, NULL);
+	}
+
 	g_dbus_proxy_unref(desc->proxy);
 	g_free(desc->chrc_path);
 
@@ -1871,6 +1928,108 @@ static bool parse_flags(GDBusProxy *proxy, uint8_t *props, uint8_t *ext_props,
 							req_prep_authorization);
 }
 
+static void value_cache_set(struct value_cache *cache, const uint8_t *value,
+								size_t len)
+{
+	free(cache->value);
+	cache->value = len ? util_memdup(value, len) : NULL;
+	cache->len = len;
+	cache->valid = true;
+	cache->generation++;
+	clock_gettime(CLOCK_MONOTONIC, &cache->updated);
+}
+
+static void value_cache_invalidate(struct value_cache *cache)
+{
+	cache->valid = false;
+	cache->generation++;
+}
+
+static void parse_cache(GDBusProxy *proxy, struct value_cache *cache)
+{
+	DBusMessageIter iter, array;
+	uint8_t *value = NULL;
+	int len = 0;
+
+	/* Caching is only enabled if the application opts in */
+	if (!g_dbus_proxy_get_property(proxy, "CacheMaxAge", &iter))
+		return;
+
+	if (dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_UINT16) {
+		error("Invalid \"CacheMaxAge\" property, caching disabled");
+		return;
+	}
+
+	dbus_message_iter_get_basic(&iter, &cache->max_age);
+	cache->enabled = true;
+
+	/* Start with the current value if the object exposes one */
+	if (!g_dbus_proxy_get_property(proxy, "Value", &iter) ||
+			dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_ARRAY)
+		return;
+
+	dbus_message_iter_recurse(&iter, &array);
+	dbus_message_iter_get_fixed_array(&array, &value, &len);
+
+	if (len < 0)
+		return;
+
+	value_cache_set(cache, value, MIN(BT_ATT_MAX_VALUE_LEN, len));
+}
+
+static bool value_cache_read(struct value_cache *cache,
+					struct gatt_db_attribute *attrib,
+					unsigned int id, uint16_t offset)
+{
+	struct timespec now;
+
+	if (!cache->enabled)
+		return false;
+
+	if (cache->valid && cache->max_age) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (now.tv_sec - cache->updated.tv_sec >= cache->max_age)
+			cache->valid = false;
+	}
+
+	if (!cache->valid) {
+		cache->misses++;
+		return false;
+	}
+
+	cache->hits++;
+
+	if (offset > cache->len) {
+		gatt_db_attribute_read_result(attrib, id,
+					BT_ATT_ERROR_INVALID_OFFSET, NULL, 0);
+		return true;
+	}
+
+	gatt_db_attribute_read_result(attrib, id, 0,
+				offset < cache->len ? cache->value + offset :
+				NULL, cache->len - offset);
+
+	return true;
+}
+
+static bool parse_conflate(GDBusProxy *proxy)
+{
+	DBusMessageIter iter;
+	dbus_bool_t conflate;
+
+	if (!g_dbus_proxy_get_property(proxy, "NotifyConflate", &iter))
+		return false;
+
+	if (dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_BOOLEAN) {
+		error("Invalid \"NotifyConflate\" property, ignoring");
+		return false;
+	}
+
+	dbus_message_iter_get_basic(&iter, &conflate);
+
+	return conflate;
+}
+
 static struct external_chrc *chrc_create(struct gatt_app *app,
 							GDBusProxy *proxy,
 							const char *path)
@@ -1922,6 +2081,9 @@ static struct external_chrc *chrc_create(struct gatt_app *app,
 		goto fail;
 	}
 
+	parse_cache(proxy, &chrc->cache);
+	chrc->ntfy_conflate = parse_conflate(proxy);
+
 	if ((chrc->props & BT_GATT_CHRC_PROP_NOTIFY ||
 				chrc->props & BT_GATT_CHRC_PROP_INDICATE) &&
 				!incr_attr_count(chrc->service, 1)) {
@@ -2005,6 +2167,8 @@ static struct external_desc *desc_create(struct gatt_app *app,
 		goto fail;
 	}
 
+	parse_cache(proxy, &desc->cache);
+
 	queue_push_tail(desc->service->descs, desc);
 
 	return desc;
@@ -2307,6 +2471,14 @@ static void read_reply_cb(DBusMessage *message, void *user_data)
 	len = MIN(BT_ATT_MAX_VALUE_LEN, len);
 	value = len ? value : NULL;
 
+	/*
+	 * Only a read of the whole value can refresh the cache, and only if
+	 * the value has not been written or changed since the read started.
+	 */
+	if (op->cache && !op->offset &&
+			op->cache_generation == op->cache->generation)
+		value_cache_set(op->cache, value, len);
+
 done:
 	gatt_db_attribute_read_result(op->attrib, op->id, ecode, value, len);
 }
@@ -2393,12 +2565,15 @@ static struct pending_op *send_read(struct bt_att *att,
 					struct gatt_db_attribute *attrib,
 					GDBusProxy *proxy,
 					struct queue *owner_queue,
+					struct value_cache *cache,
 					unsigned int id,
 					uint16_t offset)
 {
 	struct pending_op *op;
 
 	op = pending_read_new(att, owner_queue, attrib, id, offset);
+	op->cache = cache->enabled ? cache : NULL;
+	op->cache_generation = cache->generation;
 
 	if (g_dbus_proxy_method_call(proxy, "ReadValue", read_setup_cb,
 				read_reply_cb, op, pending_op_free) == TRUE)
@@ -2590,20 +2765,78 @@ static bool sock_hup(struct io *io, void *user_data)
 	return false;
 }
 
+static void client_notify(struct client_io *client, const uint8_t *value,
+								size_t len)
+{
+	struct external_chrc *chrc = client->chrc;
+
+	gatt_notify_cb(chrc->attrib, chrc->ccc, value, len, client->att,
+					chrc->service->app->database);
+}
+
+static bool client_pending_flush(void *user_data)
+{
+	struct client_io *client = user_data;
+
+	/* Hold on to the newest value until the bearer catches up */
+	if (bt_att_is_congested(client->att))
+		return true;
+
+	client->pending_id = 0;
+	client_notify(client, client->pending, client->pending_len);
+
+	return false;
+}
+
+static void client_conflate(struct client_io *client, const uint8_t *value,
+								size_t len)
+{
+	if (client->pending_id) {
+		/* Replace the value still waiting to be sent */
+		client->chrc->ntfy_conflated++;
+		memcpy(client->pending, value, len);
+		client->pending_len = len;
+		return;
+	}
+
+	if (!bt_att_is_congested(client->att)) {
+		client_notify(client, value, len);
+		return;
+	}
+
+	memcpy(client->pending, value, len);
+	client->pending_len = len;
+	client->pending_id = timeout_add(NOTIFY_RETRY_MS, client_pending_flush,
+								client, NULL);
+}
+
 static bool sock_io_read(struct io *io, void *user_data)
 {
 	struct client_io *client = user_data;
 	struct external_chrc *chrc = client->chrc;
-	uint8_t buf[512];
+	uint8_t buf[BT_ATT_MAX_VALUE_LEN];
 	int fd = io_get_fd(io);
 	ssize_t bytes_read;
+	int i;
 
-	bytes_read = read(fd, buf, sizeof(buf));
-	if (bytes_read <= 0)
-		return false;
+	/* Drain what has been queued, bounded so other sources get a turn */
+	for (i = 0; i < NOTIFY_READ_MAX; i++) {
+		bytes_read = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+		if (bytes_read < 0) {
+			if (errno == EAGAIN || errno == EINTR)
+				break;
 
-	gatt_notify_cb(chrc->attrib, chrc->ccc, buf, bytes_read, client->att,
-				client->chrc->service->app->database);
+			return false;
+		}
+
+		if (!bytes_read)
+			return false;
+
+		if (chrc->ntfy_conflate)
+			client_conflate(client, buf, bytes_read);
+		else
+			client_notify(client, buf, bytes_read);
+	}
 
 	return true;
 }
@@ -3003,6 +3236,17 @@ static void property_changed_cb(GDBusProxy *proxy, const char *name,
 	len = MIN(BT_ATT_MAX_VALUE_LEN, len);
 	value = len ? value : NULL;
 
+	/* Invalidated properties carry no value */
+	if (chrc->cache.enabled) {
+		if (iter)
+			value_cache_set(&chrc->cache, value, len);
+		else
+			value_cache_invalidate(&chrc->cache);
+	}
+
+	if (!chrc->ccc)
+		return;
+
 	send_notification_to_devices(chrc->service->app->database,
 				gatt_db_attribute_get_handle(chrc->attrib),
 				value, len,
@@ -3081,6 +3325,39 @@ static bool database_add_cep(struct external_service *service,
 	return true;
 }
 
+static void desc_property_changed_cb(GDBusProxy *proxy, const char *name,
+					DBusMessageIter *iter, void *user_data)
+{
+	struct external_desc *desc = user_data;
+	DBusMessageIter array;
+	uint8_t *value = NULL;
+	int len = 0;
+
+	if (strcmp(name, "Value"))
+		return;
+
+	/* Invalidated properties carry no value */
+	if (!iter) {
+		value_cache_invalidate(&desc->cache);
+		return;
+	}
+
+	if (dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY) {
+		DBG("Malformed \"Value\" property received");
+		return;
+	}
+
+	dbus_message_iter_recurse(iter, &array);
+	dbus_message_iter_get_fixed_array(&array, &value, &len);
+
+	if (len < 0) {
+		DBG("Malformed \"Value\" property received");
+		return;
+	}
+
+	value_cache_set(&desc->cache, value, MIN(BT_ATT_MAX_VALUE_LEN, len));
+}
+
 static void desc_read_cb(struct gatt_db_attribute *attrib,
 					unsigned int id, uint16_t offset,
 					uint8_t opcode, struct bt_att *att,
@@ -3100,8 +3377,11 @@ static void desc_read_cb(struct gatt_db_attribute *attrib,
 		goto fail;
 	}
 
-	if (send_read(att, attrib, desc->proxy, desc->pending_reads, id,
-					offset))
+	if (value_cache_read(&desc->cache, attrib, id, offset))
+		return;
+
+	if (send_read(att, attrib, desc->proxy, desc->pending_reads,
+					&desc->cache, id, offset))
 		return;
 
 fail:
@@ -3129,6 +3409,9 @@ static void desc_write_cb(struct gatt_db_attribute *attrib,
 		goto fail;
 	}
 
+	/* The application is expected to update Value after a write */
+	value_cache_invalidate(&desc->cache);
+
 	if (opcode == BT_ATT_OP_PREP_WRITE_REQ) {
 		if (!btd_device_is_trusted(device) && !desc->prep_authorized &&
 						desc->req_prep_authorization)
@@ -3191,6 +3474,15 @@ static bool database_add_desc(struct external_service *service,
 		return false;
 	}
 
+	/* Cached values are refreshed when the application changes Value */
+	if (desc->cache.enabled &&
+			g_dbus_proxy_set_property_watch(desc->proxy,
+						desc_property_changed_cb,
+						desc) == FALSE) {
+		error("Failed to set up property watch for descriptor");
+		return false;
+	}
+
 	desc->handled = true;
 
 	if (!handle) {
@@ -3224,8 +3516,11 @@ static void chrc_read_cb(struct gatt_db_attribute *attrib,
 		goto fail;
 	}
 
-	if (send_read(att, attrib, chrc->proxy, chrc->pending_reads, id,
-	       offset))
+	if (value_cache_read(&chrc->cache, attrib, id, offset))
+		return;
+
+	if (send_read(att, attrib, chrc->proxy, chrc->pending_reads,
+					&chrc->cache, id, offset))
 		return;
 
 fail:
@@ -3256,6 +3551,9 @@ static void chrc_write_cb(struct gatt_db_attribute *attrib,
 		goto fail;
 	}
 
+	/* The application is expected to update Value after a write */
+	value_cache_invalidate(&chrc->cache);
+
 	if (!(chrc->props & BT_GATT_CHRC_PROP_WRITE_WITHOUT_RESP))
 		queue = chrc->pending_writes;
 	else
@@ -3370,6 +3668,15 @@ static bool database_add_chrc(struct external_service *service,
 	if (!database_add_ccc(service, chrc))
 		return false;
 
+	/* Cached values are refreshed when the application changes Value */
+	if (!chrc->ccc && chrc->cache.enabled &&
+			g_dbus_proxy_set_property_watch(chrc->proxy,
+						property_changed_cb,
+						chrc) == FALSE) {
+		error("Failed to set up property watch for characteristic");
+		return false;
+	}
+
 	if (!database_add_cep(service, chrc))
 		return false;
 
@@ -3866,6 +4173,114 @@ static DBusMessage *manager_unregister_app(DBusConnection *conn,
 	return dbus_message_new_method_return(msg);
 }
 
+static void append_stats(DBusMessageIter *iter, const char *path,
+						struct value_cache *cache,
+						struct external_chrc *chrc)
+{
+	DBusMessageIter entry, dict;
+	bool conflate = chrc && chrc->ntfy_conflate;
+
+	if (!cache->enabled && !conflate)
+		return;
+
+	dbus_message_iter_open_container(iter, DBUS_TYPE_DICT_ENTRY, NULL,
+								&entry);
+	dbus_message_iter_append_basic(&entry, DBUS_TYPE_OBJECT_PATH, &path);
+	dbus_message_iter_open_container(&entry, DBUS_TYPE_ARRAY,
+					DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+					DBUS_TYPE_STRING_AS_STRING
+					DBUS_TYPE_VARIANT_AS_STRING
+					DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+					&dict);
+
+	if (cache->enabled) {
+		dict_append_entry(&dict, "CacheHits", DBUS_TYPE_UINT32,
+							&cache->hits);
+		dict_append_entry(&dict, "CacheMisses", DBUS_TYPE_UINT32,
+							&cache->misses);
+	}
+
+	if (conflate) {
+		dict_append_entry(&dict, "NotifyConflated", DBUS_TYPE_UINT32,
+							&chrc->ntfy_conflated);
+		dict_append_entry(&dict, "NotifyDropped", DBUS_TYPE_UINT32,
+							&chrc->ntfy_dropped);
+	}
+
+	dbus_message_iter_close_container(&entry, &dict);
+	dbus_message_iter_close_container(iter, &entry);
+}
+
+static void append_chrc_stats(void *data, void *user_data)
+{
+	struct external_chrc *chrc = data;
+
+	append_stats(user_data, chrc->path, &chrc->cache, chrc);
+}
+
+static void append_desc_stats(void *data, void *user_data)
+{
+	struct external_desc *desc = data;
+
+	if (!desc->proxy)
+		return;
+
+	append_stats(user_data, g_dbus_proxy_get_path(desc->proxy),
+							&desc->cache, NULL);
+}
+
+static void append_service_stats(void *data, void *user_data)
+{
+	struct external_service *service = data;
+
+	queue_foreach(service->chrcs, append_chrc_stats, user_data);
+	queue_foreach(service->descs, append_desc_stats, user_data);
+}
+
+static DBusMessage *manager_get_stats(DBusConnection *conn,
+					DBusMessage *msg, void *user_data)
+{
+	struct btd_gatt_database *database = user_data;
+	struct svc_match_data match_data;
+	DBusMessageIter iter, dict;
+	struct gatt_app *app;
+	DBusMessage *reply;
+	const char *path;
+
+	if (!dbus_message_get_args(msg, NULL, DBUS_TYPE_OBJECT_PATH, &path,
+							DBUS_TYPE_INVALID))
+		return btd_error_invalid_args(msg);
+
+	match_data.path = path;
+	match_data.sender = dbus_message_get_sender(msg);
+
+	app = queue_find(database->apps, match_app, &match_data);
+	if (!app)
+		return btd_error_does_not_exist(msg);
+
+	reply = dbus_message_new_method_return(msg);
+	if (!reply)
+		return NULL;
+
+	dbus_message_iter_init_append(reply, &iter);
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+					DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+					DBUS_TYPE_OBJECT_PATH_AS_STRING
+					DBUS_TYPE_ARRAY_AS_STRING
+					DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+					DBUS_TYPE_STRING_AS_STRING
+					DBUS_TYPE_VARIANT_AS_STRING
+					DBUS_DICT_ENTRY_END_CHAR_AS_STRING
+					DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+					&dict);
+
+	queue_foreach(app->services, append_service_stats, &dict);
+
+	dbus_message_iter_close_container(&iter, &dict);
+
+	return reply;
+}
+
 static const GDBusMethodTable manager_methods[] = {
 	{ GDBUS_ASYNC_METHOD("RegisterApplication",
 					GDBUS_ARGS({ "application", "o" },
@@ -3874,6 +4289,10 @@ static const GDBusMethodTable manager_methods[] = {
 	{ GDBUS_ASYNC_METHOD("UnregisterApplication",
 					GDBUS_ARGS({ "application", "o" }),
 					NULL, manager_unregister_app) },
+	{ GDBUS_EXPERIMENTAL_METHOD("GetStatistics",
+				GDBUS_ARGS({ "application", "o" }),
+				GDBUS_ARGS({ "statistics", "a{oa{sv}}" }),
+				manager_get_stats) },
 	{ }
 };
 
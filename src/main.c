@@ -22,6 +22,8 @@
 #include <string.h>
 #include <signal.h>
 #include <stdbool.h>
+#include <stdarg.h>
+#include <time.h>
 #include <sys/signalfd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -32,6 +34,7 @@
 
 #include "lib/bluetooth.h"
 #include "lib/sdp.h"
+#include "lib/mgmt.h"
 
 #include "gdbus/gdbus.h"
 #include "btio/btio.h"
@@ -138,6 +141,7 @@ static const char *policy_options[] = {
 	"ReconnectIntervals",
 	"AutoEnable",
 	"ResumeDelay",
+	"ReconnectLimit",
 	NULL
 };
 
@@ -1219,8 +1223,8 @@ static void log_handler(const gchar *log_domain, GLogLevelFlags log_level,
 	else
 		priority = 0x06;
 
-	btd_log(0xffff, priority, "GLib: %s", message);
-	btd_backtrace(0xffff);
+	btd_log(MGMT_INDEX_NONE, priority, "GLib: %s", message);
+	btd_backtrace(MGMT_INDEX_NONE);
 }
 
 void btd_exit(void)
@@ -1228,6 +1232,101 @@ void btd_exit(void)
 	mainloop_quit();
 }
 
+struct timeline_entry {
+	uint16_t index;
+	char *phase;
+	struct timespec ts;
+};
+
+static struct queue *timeline;
+
+static void timeline_entry_free(void *data)
+{
+	struct timeline_entry *entry = data;
+
+	g_free(entry->phase);
+	free(entry);
+}
+
+void btd_timeline_mark(uint16_t index, const char *format, ...)
+{
+	struct timeline_entry *entry;
+	va_list ap;
+
+	if (!timeline)
+		timeline = queue_new();
+
+	entry = new0(struct timeline_entry, 1);
+	entry->index = index;
+
+	va_start(ap, format);
+	entry->phase = g_strdup_vprintf(format, ap);
+	va_end(ap);
+
+	clock_gettime(CLOCK_MONOTONIC, &entry->ts);
+
+	queue_push_tail(timeline, entry);
+}
+
+static long timeline_usec(const struct timespec *from,
+						const struct timespec *to)
+{
+	return (to->tv_sec - from->tv_sec) * 1000000L +
+				(to->tv_nsec - from->tv_nsec) / 1000L;
+}
+
+static bool match_timeline_index(const void *data, const void *match_data)
+{
+	const struct timeline_entry *entry = data;
+
+	return entry->index == PTR_TO_UINT(match_data);
+}
+
+/*
+ * Log the daemon wide phases, marked with MGMT_INDEX_NONE, together with the
+ * phases of the given adapter and then forget about the adapter phases.
+ */
+void btd_timeline_dump(uint16_t index)
+{
+	const struct queue_entry *l;
+	const struct timeline_entry *start, *last = NULL;
+	long usec, prev = 0;
+
+	start = queue_peek_head(timeline);
+	if (!start)
+		return;
+
+	for (l = queue_get_entries(timeline); l; l = l->next) {
+		const struct timeline_entry *entry = l->data;
+
+		if (entry->index != MGMT_INDEX_NONE && entry->index != index)
+			continue;
+
+		usec = timeline_usec(&start->ts, &entry->ts);
+
+		DBG_IDX(index, "startup %s: %ld.%03ld ms (+%ld.%03ld ms)",
+					entry->phase, usec / 1000, usec % 1000,
+					(usec - prev) / 1000,
+					(usec - prev) % 1000);
+
+		prev = usec;
+		last = entry;
+	}
+
+	btd_info(index, "Startup completed in %ld.%03ld ms, %ld.%03ld s "
+				"after boot", prev / 1000, prev % 1000,
+				(long) last->ts.tv_sec,
+				last->ts.tv_nsec / 1000000L);
+
+	btd_timeline_clear(index);
+}
+
+void btd_timeline_clear(uint16_t index)
+{
+	queue_remove_all(timeline, match_timeline_index, UINT_TO_PTR(index),
+							timeline_entry_free);
+}
+
 static bool quit_eventloop(gpointer user_data)
 {
 	btd_exit();
@@ -1371,6 +1470,8 @@ int main(int argc, char *argv[])
 	uint32_t sdp_flags = 0;
 	int gdbus_flags = 0;
 
+	btd_timeline_mark(MGMT_INDEX_NONE, "start");
+
 	init_defaults();
 
 	context = g_option_context_new(NULL);
@@ -1415,6 +1516,8 @@ int main(int argc, char *argv[])
 		exit(1);
 	}
 
+	btd_timeline_mark(MGMT_INDEX_NONE, "D-Bus connected");
+
 	if (btd_opts.experimental)
 		gdbus_flags = G_DBUS_FLAG_ENABLE_EXPERIMENTAL;
 
@@ -1459,6 +1562,8 @@ int main(int argc, char *argv[])
 
 	rfkill_init();
 
+	btd_timeline_mark(MGMT_INDEX_NONE, "main loop");
+
 	DBG("Entering main loop");
 
 	mainloop_sd_notify("STATUS=Running");
@@ -1484,6 +1589,8 @@ int main(int argc, char *argv[])
 	if (btd_opts.kernel)
 		queue_destroy(btd_opts.kernel, free);
 
+	queue_destroy(timeline, timeline_entry_free);
+
 	if (main_conf)
 		g_key_file_free(main_conf);
 
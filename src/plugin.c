@@ -20,6 +20,7 @@
 #include <glib.h>
 
 #include "lib/bluetooth.h"
+#include "lib/mgmt.h"
 
 #include "btio/btio.h"
 #include "src/plugin.h"
@@ -56,6 +57,9 @@ static int init_plugin(const struct bluetooth_plugin_desc *desc)
 			error("Failed to init %s plugin",
 						desc->name);
 	}
+
+	btd_timeline_mark(MGMT_INDEX_NONE, "plugin %s", desc->name);
+
 	return err;
 }
 
@@ -215,6 +219,8 @@ void plugin_init(const char *enable, const char *disable)
 	if (disable)
 		cli_disabled = g_strsplit_set(disable, ", ", -1);
 
+	btd_timeline_mark(MGMT_INDEX_NONE, "plugin init");
+
 	DBG("Loading builtin plugins");
 
 	for (i = 0; __bluetooth_builtin[i]; i++) {
@@ -697,6 +697,7 @@ struct ext_io {
 
 	bool resolving;
 	bool connected;
+	bool cached;
 
 	uint16_t version;
 	uint16_t features;
@@ -1098,6 +1099,8 @@ static bool send_new_connection(struct ext_profile *ext, struct ext_io *conn)
 	return true;
 }
 
+static int refresh_service(struct ext_io *conn);
+
 static void ext_connect(GIOChannel *io, GError *err, gpointer user_data)
 {
 	struct ext_io *conn = user_data;
@@ -1123,6 +1126,10 @@ static void ext_connect(GIOChannel *io, GError *err, gpointer user_data)
 	if (err != NULL) {
 		error("%s failed to connect to %s: %s", ext->name, addr,
 								err->message);
+		if (conn->cached && err->code != EHOSTDOWN &&
+					!refresh_service(conn))
+			return;
+
 		goto drop;
 	}
 
@@ -1625,7 +1632,7 @@ static int connect_io(struct ext_io *conn, const bdaddr_t *src,
 	return 0;
 }
 
-static uint16_t get_goep_l2cap_psm(sdp_record_t *rec)
+static uint16_t get_goep_l2cap_psm(const sdp_record_t *rec)
 {
 	sdp_data_t *data;
 
@@ -1643,6 +1650,34 @@ static uint16_t get_goep_l2cap_psm(sdp_record_t *rec)
 	return data->val.uint16;
 }
 
+static int get_record_port(struct ext_io *conn, const sdp_record_t *rec)
+{
+	sdp_list_t *protos;
+	int port;
+
+	if (sdp_get_access_protos(rec, &protos) < 0) {
+		error("Unable to get proto list from %s record",
+							conn->ext->name);
+		return -ENOTSUP;
+	}
+
+	port = sdp_get_proto_port(protos, L2CAP_UUID);
+	if (port > 0)
+		conn->psm = port;
+
+	port = sdp_get_proto_port(protos, RFCOMM_UUID);
+	if (port > 0)
+		conn->chan = port;
+
+	if (conn->psm == 0 && sdp_get_proto_desc(protos, OBEX_UUID))
+		conn->psm = get_goep_l2cap_psm(rec);
+
+	sdp_list_foreach(protos, (sdp_list_func_t) sdp_list_free, NULL);
+	sdp_list_free(protos, NULL);
+
+	return 0;
+}
+
 static void record_cb(sdp_list_t *recs, int err, gpointer user_data)
 {
 	struct ext_io *conn = user_data;
@@ -1665,33 +1700,17 @@ static void record_cb(sdp_list_t *recs, int err, gpointer user_data)
 
 	for (r = recs; r != NULL; r = r->next) {
 		sdp_record_t *rec = r->data;
-		sdp_list_t *protos;
-		int port;
 
-		if (sdp_get_access_protos(rec, &protos) < 0) {
-			error("Unable to get proto list from %s record",
-								ext->name);
-			err = -ENOTSUP;
+		err = get_record_port(conn, rec);
+		if (err < 0)
 			goto failed;
-		}
-
-		port = sdp_get_proto_port(protos, L2CAP_UUID);
-		if (port > 0)
-			conn->psm = port;
-
-		port = sdp_get_proto_port(protos, RFCOMM_UUID);
-		if (port > 0)
-			conn->chan = port;
 
-		if (conn->psm == 0 && sdp_get_proto_desc(protos, OBEX_UUID))
-			conn->psm = get_goep_l2cap_psm(rec);
-
-		sdp_list_foreach(protos, (sdp_list_func_t) sdp_list_free,
-									NULL);
-		sdp_list_free(protos, NULL);
-
-		if (conn->chan || conn->psm)
+		if (conn->chan || conn->psm) {
+			/* Let the next connection use the record directly */
+			btd_device_update_record(conn->device,
+						ext->remote_uuid, rec);
 			break;
+		}
 	}
 
 	if (!conn->chan && !conn->psm) {
@@ -1735,6 +1754,50 @@ static int resolve_service(struct ext_io *conn, const bdaddr_t *src,
 	return err;
 }
 
+/* The stored record may be outdated, query it again and retry */
+static int refresh_service(struct ext_io *conn)
+{
+	DBG("%s refreshing record of %s", conn->ext->name,
+					device_get_path(conn->device));
+
+	conn->cached = false;
+	conn->psm = 0;
+	conn->chan = 0;
+
+	if (conn->io) {
+		g_io_channel_shutdown(conn->io, FALSE, NULL);
+		g_io_channel_unref(conn->io);
+		conn->io = NULL;
+	}
+
+	return resolve_service(conn, btd_adapter_get_address(conn->adapter),
+					device_get_address(conn->device));
+}
+
+static bool resolve_cached_service(struct ext_io *conn,
+						struct btd_device *dev)
+{
+	struct ext_profile *ext = conn->ext;
+	const sdp_record_t *rec;
+
+	rec = btd_device_get_record(dev, ext->remote_uuid);
+	if (!rec)
+		return false;
+
+	if (get_record_port(conn, rec) < 0 || (!conn->psm && !conn->chan)) {
+		conn->psm = 0;
+		conn->chan = 0;
+		return false;
+	}
+
+	DBG("%s using stored record: psm %u channel %u", ext->name,
+						conn->psm, conn->chan);
+
+	conn->cached = true;
+
+	return true;
+}
+
 static int ext_connect_dev(struct btd_service *service)
 {
 	struct btd_device *dev = btd_service_get_device(service);
@@ -1762,6 +1825,9 @@ static int ext_connect_dev(struct btd_service *service)
 		conn->chan = ext->remote_chan;
 		err = connect_io(conn, btd_adapter_get_address(adapter),
 						device_get_address(dev));
+	} else if (resolve_cached_service(conn, dev)) {
+		err = connect_io(conn, btd_adapter_get_address(adapter),
+						device_get_address(dev));
 	} else {
 		err = resolve_service(conn, btd_adapter_get_address(adapter),
 						device_get_address(dev));
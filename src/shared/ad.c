@@ -1482,3 +1482,349 @@ struct bt_ad_pattern *bt_ad_pattern_match(struct bt_ad *ad,
 
 	return info.matched_pattern;
 }
+
+typedef bool (*ad_view_func_t)(uint8_t type, const uint8_t *data,
+						uint8_t len, void *user_data);
+
+/* Iterates over each element until func returns true */
+static bool ad_view_foreach(const struct bt_ad_view *view,
+					ad_view_func_t func, void *user_data)
+{
+	size_t i = 0;
+
+	if (!view || !view->data)
+		return false;
+
+	while (i + 1 < view->len) {
+		uint8_t elen = view->data[i];
+
+		if (func(view->data[i + 1], &view->data[i + 2], elen - 1,
+								user_data))
+			return true;
+
+		i += elen + 1;
+	}
+
+	return false;
+}
+
+/* Types stored as generic data entries by bt_ad_new_with_data */
+static bool ad_type_is_data(uint8_t type)
+{
+	switch (type) {
+	case BT_AD_UUID16_SOME:
+	case BT_AD_UUID16_ALL:
+	case BT_AD_UUID32_SOME:
+	case BT_AD_UUID32_ALL:
+	case BT_AD_UUID128_SOME:
+	case BT_AD_UUID128_ALL:
+	case BT_AD_NAME_SHORT:
+	case BT_AD_NAME_COMPLETE:
+	case BT_AD_SERVICE_DATA16:
+	case BT_AD_SERVICE_DATA32:
+	case BT_AD_SERVICE_DATA128:
+	case BT_AD_MANUFACTURER_DATA:
+		return false;
+	}
+
+	return true;
+}
+
+static bool ad_view_uuid(uint8_t type, const uint8_t *data, bt_uuid_t *uuid)
+{
+	uint128_t value;
+
+	switch (type) {
+	case BT_AD_UUID16_SOME:
+	case BT_AD_UUID16_ALL:
+	case BT_AD_SERVICE_DATA16:
+		return !bt_uuid16_create(uuid, get_le16(data));
+	case BT_AD_UUID32_SOME:
+	case BT_AD_UUID32_ALL:
+	case BT_AD_SERVICE_DATA32:
+		return !bt_uuid32_create(uuid, get_le32(data));
+	case BT_AD_UUID128_SOME:
+	case BT_AD_UUID128_ALL:
+	case BT_AD_SERVICE_DATA128:
+		bswap_128(data, &value);
+		return !bt_uuid128_create(uuid, value);
+	}
+
+	return false;
+}
+
+static size_t ad_view_uuid_len(uint8_t type)
+{
+	switch (type) {
+	case BT_AD_UUID16_SOME:
+	case BT_AD_UUID16_ALL:
+	case BT_AD_SERVICE_DATA16:
+		return 2;
+	case BT_AD_UUID32_SOME:
+	case BT_AD_UUID32_ALL:
+	case BT_AD_SERVICE_DATA32:
+		return 4;
+	case BT_AD_UUID128_SOME:
+	case BT_AD_UUID128_ALL:
+	case BT_AD_SERVICE_DATA128:
+		return 16;
+	}
+
+	return 0;
+}
+
+static bool ad_view_is_service_data(uint8_t type)
+{
+	return type == BT_AD_SERVICE_DATA16 || type == BT_AD_SERVICE_DATA32 ||
+					type == BT_AD_SERVICE_DATA128;
+}
+
+/*
+ * Manufacturer and service data must at least contain the company identifier
+ * or the service UUID so they can be matched without checking the length.
+ */
+static bool ad_view_element_valid(uint8_t type, uint8_t len)
+{
+	if (type == BT_AD_MANUFACTURER_DATA)
+		return len >= 2;
+
+	if (ad_view_is_service_data(type))
+		return len >= ad_view_uuid_len(type);
+
+	return true;
+}
+
+bool bt_ad_view_init(struct bt_ad_view *view, const uint8_t *data,
+								size_t len)
+{
+	struct iovec iov = {
+		.iov_base = (void *)data,
+		.iov_len = len,
+	};
+	uint8_t elen, type;
+
+	if (!view || data == NULL || !len)
+		return false;
+
+	/* Validate each element the way bt_ad_new_with_data does, except that
+	 * repeated elements, which it may reject, are accepted since the view
+	 * keeps no per type state.
+	 */
+	while (util_iov_pull_u8(&iov, &elen)) {
+		if (elen == 0 || elen > iov.iov_len) {
+			/* Ignore anything past the last valid element */
+			len -= iov.iov_len + 1;
+			break;
+		}
+
+		if (!util_iov_pull_u8(&iov, &type))
+			return false;
+
+		if (!ad_is_type_valid(type))
+			return false;
+
+		if (!ad_view_element_valid(type, elen - 1))
+			return false;
+
+		if (!util_iov_pull_mem(&iov, elen - 1))
+			return false;
+	}
+
+	view->data = data;
+	view->len = len;
+
+	return true;
+}
+
+static bool view_service_uuid_match(uint8_t type, const uint8_t *data,
+						uint8_t len, void *user_data)
+{
+	const bt_uuid_t *match = user_data;
+	size_t uuid_len = ad_view_uuid_len(type);
+	size_t i;
+
+	if (!uuid_len || ad_view_is_service_data(type))
+		return false;
+
+	for (i = 0; i + uuid_len <= len; i += uuid_len) {
+		bt_uuid_t uuid;
+
+		if (ad_view_uuid(type, data + i, &uuid) &&
+						!bt_uuid_cmp(&uuid, match))
+			return true;
+	}
+
+	return false;
+}
+
+bool bt_ad_view_has_service_uuid(const struct bt_ad_view *view,
+						const bt_uuid_t *uuid)
+{
+	if (!uuid)
+		return false;
+
+	return ad_view_foreach(view, view_service_uuid_match, (void *) uuid);
+}
+
+static bool view_manufacturer_match(uint8_t type, const uint8_t *data,
+						uint8_t len, void *user_data)
+{
+	const struct bt_ad_manufacturer_data *m = user_data;
+
+	if (type != BT_AD_MANUFACTURER_DATA || len < 2)
+		return false;
+
+	if (!m)
+		return true;
+
+	if (get_le16(data) != m->manufacturer_id || len - 2 != m->len)
+		return false;
+
+	return !memcmp(data + 2, m->data, m->len);
+}
+
+bool bt_ad_view_has_manufacturer_data(const struct bt_ad_view *view,
+				const struct bt_ad_manufacturer_data *data)
+{
+	return ad_view_foreach(view, view_manufacturer_match, (void *) data);
+}
+
+static bool view_service_data_match(uint8_t type, const uint8_t *data,
+						uint8_t len, void *user_data)
+{
+	const struct bt_ad_service_data *s = user_data;
+	size_t uuid_len = ad_view_uuid_len(type);
+	bt_uuid_t uuid;
+
+	if (!ad_view_is_service_data(type) || len < uuid_len)
+		return false;
+
+	if (!s)
+		return true;
+
+	if (len - uuid_len != s->len)
+		return false;
+
+	if (!ad_view_uuid(type, data, &uuid) || bt_uuid_cmp(&uuid, &s->uuid))
+		return false;
+
+	return !memcmp(data + uuid_len, s->data, s->len);
+}
+
+bool bt_ad_view_has_service_data(const struct bt_ad_view *view,
+				const struct bt_ad_service_data *data)
+{
+	return ad_view_foreach(view, view_service_data_match, (void *) data);
+}
+
+static bool view_data_match(uint8_t type, const uint8_t *data, uint8_t len,
+							void *user_data)
+{
+	const struct bt_ad_data *d = user_data;
+
+	if (!ad_type_is_data(type))
+		return false;
+
+	if (!d)
+		return true;
+
+	if (type != d->type)
+		return false;
+
+	if (!d->len && !d->data)
+		return true;
+
+	if (len != d->len)
+		return false;
+
+	return !memcmp(data, d->data, len);
+}
+
+bool bt_ad_view_has_data(const struct bt_ad_view *view,
+					const struct bt_ad_data *data)
+{
+	return ad_view_foreach(view, view_data_match, (void *) data);
+}
+
+bool bt_ad_view_has_flags(const struct bt_ad_view *view)
+{
+	struct bt_ad_data data = { .type = BT_AD_FLAGS };
+
+	return bt_ad_view_has_data(view, &data);
+}
+
+static bool view_flags_match(uint8_t type, const uint8_t *data, uint8_t len,
+							void *user_data)
+{
+	uint8_t *flags = user_data;
+
+	if (type != BT_AD_FLAGS)
+		return false;
+
+	*flags = len == 1 ? data[0] : 0;
+
+	return true;
+}
+
+uint8_t bt_ad_view_get_flags(const struct bt_ad_view *view)
+{
+	uint8_t flags = 0;
+
+	ad_view_foreach(view, view_flags_match, &flags);
+
+	return flags;
+}
+
+static bool view_pattern_match(uint8_t type, const uint8_t *data,
+						uint8_t len, void *user_data)
+{
+	const struct bt_ad_pattern *pattern = user_data;
+	size_t skip = 0;
+
+	switch (pattern->type) {
+	case BT_AD_MANUFACTURER_DATA:
+		/* Manufacturer ID is part of the data being matched */
+		if (type != BT_AD_MANUFACTURER_DATA || len < 2)
+			return false;
+		break;
+	case BT_AD_SERVICE_DATA16:
+	case BT_AD_SERVICE_DATA32:
+	case BT_AD_SERVICE_DATA128:
+		/* Any service data is matched skipping its UUID */
+		if (!ad_view_is_service_data(type))
+			return false;
+
+		skip = ad_view_uuid_len(type);
+		if (len < skip)
+			return false;
+		break;
+	default:
+		if (type != pattern->type || !ad_type_is_data(type))
+			return false;
+		break;
+	}
+
+	if (len - skip < pattern->offset + pattern->len)
+		return false;
+
+	return !memcmp(data + skip + pattern->offset, pattern->data,
+								pattern->len);
+}
+
+struct bt_ad_pattern *bt_ad_view_pattern_match(const struct bt_ad_view *view,
+							struct queue *patterns)
+{
+	const struct queue_entry *entry;
+
+	if (!view || queue_isempty(patterns))
+		return NULL;
+
+	for (entry = queue_get_entries(patterns); entry; entry = entry->next) {
+		struct bt_ad_pattern *pattern = entry->data;
+
+		if (ad_view_foreach(view, view_pattern_match, pattern))
+			return pattern;
+	}
+
+	return NULL;
+}
@@ -98,6 +98,12 @@ struct bt_ad_pattern {
 	uint8_t data[BT_AD_MAX_DATA_LEN];
 };
 
+/* Non-allocating view parsing advertising data in place */
+struct bt_ad_view {
+	const uint8_t *data;
+	size_t len;
+};
+
 struct bt_ad *bt_ad_new(void);
 
 bool bt_ad_set_max_len(struct bt_ad *ad, uint8_t len);
@@ -189,3 +195,25 @@ struct bt_ad_pattern *bt_ad_pattern_new(uint8_t type, size_t offset,
 
 struct bt_ad_pattern *bt_ad_pattern_match(struct bt_ad *ad,
 							struct queue *patterns);
+
+bool bt_ad_view_init(struct bt_ad_view *view, const uint8_t *data,
+								size_t len);
+
+bool bt_ad_view_has_service_uuid(const struct bt_ad_view *view,
+						const bt_uuid_t *uuid);
+
+bool bt_ad_view_has_manufacturer_data(const struct bt_ad_view *view,
+				const struct bt_ad_manufacturer_data *data);
+
+bool bt_ad_view_has_service_data(const struct bt_ad_view *view,
+				const struct bt_ad_service_data *data);
+
+bool bt_ad_view_has_data(const struct bt_ad_view *view,
+					const struct bt_ad_data *data);
+
+bool bt_ad_view_has_flags(const struct bt_ad_view *view);
+
+uint8_t bt_ad_view_get_flags(const struct bt_ad_view *view);
+
+struct bt_ad_pattern *bt_ad_view_pattern_match(const struct bt_ad_view *view,
+							struct queue *patterns);
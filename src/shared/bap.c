@@ -4849,6 +4849,9 @@ clone:
 	bap->idle_id = bt_gatt_client_idle_register(bap->client, bap_idle,
 								bap, NULL);
 
+	/* Coalesce the initial reads of PACS and ASCS */
+	bt_gatt_client_read_batch_begin(bap->client);
+
 	if (bap->rdb->pacs) {
 		uint16_t value_handle;
 		struct bt_pacs *pacs = bap->rdb->pacs;
@@ -4935,7 +4938,7 @@ clone:
 
 		bap_cp_attach(bap);
 
-		return true;
+		goto done;
 	}
 
 	bt_uuid16_create(&uuid, PACS_UUID);
@@ -4944,6 +4947,9 @@ clone:
 	bt_uuid16_create(&uuid, ASCS_UUID);
 	gatt_db_foreach_service(bap->rdb->db, &uuid, foreach_ascs_service, bap);
 
+done:
+	bt_gatt_client_read_batch_end(bap->client);
+
 	return true;
 }
 
@@ -1507,10 +1507,14 @@ bool bt_bass_attach(struct bt_bass *bass, struct bt_gatt_client *client)
 	if (!bass->client)
 		return false;
 
+	bt_gatt_client_read_batch_begin(bass->client);
+
 	bt_uuid16_create(&uuid, BASS_UUID);
 	gatt_db_foreach_service(bass->rdb->db, &uuid, foreach_bass_service,
 				bass);
 
+	bt_gatt_client_read_batch_end(bass->client);
+
 	return true;
 }
 
@@ -37,6 +37,7 @@
 
 #define GATT_SVC_UUID	0x1801
 #define SVC_CHNGD_UUID	0x2a05
+#define NOTIFY_INDEX_MIN	16
 #define DBG(_client, _format, arg...) \
 	gatt_log(_client, "[%p] %s:%s() " _format, _client, __FILE__, \
 		__func__, ## arg)
@@ -91,6 +92,12 @@ struct bt_gatt_client {
 	/* List of registered disconnect/notification/indication callbacks */
 	struct queue *notify_list;
 	struct queue *notify_chrcs;
+	/*
+	 * Characteristics with registered callbacks hashed by value handle so
+	 * incoming notifications are dispatched without walking notify_list.
+	 */
+	struct notify_chrc **notify_index;
+	unsigned int notify_index_size;
 	int next_reg_id;
 	unsigned int disc_id, nfy_id, nfy_mult_id, ind_id;
 
@@ -114,12 +121,22 @@ struct bt_gatt_client {
 
 	struct bt_gatt_request *discovery_req;
 	unsigned int mtu_req_id;
+
+	/*
+	 * Reads queued while a read batch is open and Read Multiple Variable
+	 * Length requests in flight. Only used by the root client so reads
+	 * from all clones end up in the same batch.
+	 */
+	unsigned int read_batch_depth;
+	struct queue *batch_reads;
+	struct queue *read_batches;
 };
 
 struct request {
 	struct bt_gatt_client *client;
 	bool long_write;
 	bool prep_write;
+	struct batch_read *batch_read;	/* Set while queued in a batch */
 	bool removed;
 	int ref_count;
 	unsigned int id;
@@ -128,6 +145,11 @@ struct request {
 	void (*destroy)(void *);
 };
 
+struct batch_read {
+	struct request *req;
+	uint16_t handle;
+};
+
 static struct request *request_ref(struct request *req)
 {
 	__sync_fetch_and_add(&req->ref_count, 1);
@@ -221,6 +243,10 @@ struct notify_chrc {
 	uint16_t properties;
 	unsigned int notify_id;
 	int notify_count;  /* Reference count of registered notify callbacks */
+	struct notify_chrc *index_next;  /* Next entry in index bucket */
+
+	/* Callbacks registered for this characteristic, in order */
+	struct queue *notify_list;
 
 	/* Pending calls to register_notify are queued here so that they can be
 	 * processed after a write that modifies the CCC descriptor.
@@ -288,9 +314,82 @@ static void notify_chrc_free(void *data)
 		gatt_db_attribute_unregister(chrc->attr, chrc->notify_id);
 
 	queue_destroy(chrc->reg_notify_queue, notify_data_unref);
+	queue_destroy(chrc->notify_list, NULL);
 	free(chrc);
 }
 
+static struct notify_chrc **notify_index_bucket(struct bt_gatt_client *client,
+							uint16_t value_handle)
+{
+	return &client->notify_index[value_handle &
+					(client->notify_index_size - 1)];
+}
+
+static void notify_index_add(struct bt_gatt_client *client,
+						struct notify_chrc *chrc)
+{
+	struct notify_chrc **bucket;
+	unsigned int size = client->notify_index_size;
+
+	/* Keep the table at least as large as the number of entries */
+	if (queue_length(client->notify_chrcs) > size) {
+		const struct queue_entry *entry;
+
+		free(client->notify_index);
+
+		client->notify_index_size = size ? size * 2 : NOTIFY_INDEX_MIN;
+		client->notify_index = new0(struct notify_chrc *,
+						client->notify_index_size);
+
+		for (entry = queue_get_entries(client->notify_chrcs); entry;
+							entry = entry->next) {
+			struct notify_chrc *c = entry->data;
+
+			bucket = notify_index_bucket(client, c->value_handle);
+			c->index_next = *bucket;
+			*bucket = c;
+		}
+
+		return;
+	}
+
+	bucket = notify_index_bucket(client, chrc->value_handle);
+	chrc->index_next = *bucket;
+	*bucket = chrc;
+}
+
+static struct notify_chrc *notify_index_find(struct bt_gatt_client *client,
+							uint16_t value_handle)
+{
+	struct notify_chrc *chrc;
+
+	if (!client->notify_index)
+		return NULL;
+
+	for (chrc = *notify_index_bucket(client, value_handle); chrc;
+						chrc = chrc->index_next) {
+		if (chrc->value_handle == value_handle)
+			return chrc;
+	}
+
+	return NULL;
+}
+
+static void notify_index_remove(struct notify_chrc *chrc)
+{
+	struct notify_chrc **entry;
+
+	entry = notify_index_bucket(chrc->client, chrc->value_handle);
+
+	for (; *entry; entry = &(*entry)->index_next) {
+		if (*entry == chrc) {
+			*entry = chrc->index_next;
+			chrc->index_next = NULL;
+			return;
+		}
+	}
+}
+
 static void chrc_removed(struct gatt_db_attribute *attr, void *user_data)
 {
 	struct notify_chrc *chrc = user_data;
@@ -303,6 +402,7 @@ static void chrc_removed(struct gatt_db_attribute *attr, void *user_data)
 								chrc)))
 		notify_data_cleanup(data);
 
+	notify_index_remove(chrc);
 	queue_remove(client->notify_chrcs, chrc);
 	notify_chrc_free(chrc);
 }
@@ -337,6 +437,8 @@ static struct notify_chrc *notify_chrc_create(struct bt_gatt_client *client,
 		return NULL;
 	}
 
+	chrc->notify_list = queue_new();
+
 	ccc = gatt_db_attribute_get_ccc(attr);
 	if (ccc)
 		chrc->ccc_handle = gatt_db_attribute_get_handle(ccc);
@@ -349,6 +451,7 @@ static struct notify_chrc *notify_chrc_create(struct bt_gatt_client *client,
 									NULL);
 
 	queue_push_tail(client->notify_chrcs, chrc);
+	notify_index_add(client, chrc);
 
 	return chrc;
 }
@@ -1002,14 +1105,12 @@ static void discover_chrcs_cb(bool success, uint8_t att_ecode,
 {
 	struct discovery_op *op = user_data;
 	struct bt_gatt_client *client = op->client;
-	struct bt_gatt_iter iter;
+	const struct bt_gatt_record *rec;
 	struct chrc *chrc_data;
-	uint16_t start, end, value;
-	uint8_t properties;
 	uint128_t u128;
 	bt_uuid_t uuid;
 	char uuid_str[MAX_LEN_UUID_STR];
-	unsigned int chrc_count;
+	unsigned int chrc_count, i;
 	bool discovering;
 
 	discovery_req_clear(client);
@@ -1023,7 +1124,7 @@ static void discover_chrcs_cb(bool success, uint8_t att_ecode,
 		goto done;
 	}
 
-	if (!result || !bt_gatt_iter_init(&iter, result))
+	if (!result)
 		goto failed;
 
 	chrc_count = bt_gatt_result_characteristic_count(result);
@@ -1033,22 +1134,30 @@ static void discover_chrcs_cb(bool success, uint8_t att_ecode,
 	if (chrc_count == 0)
 		goto failed;
 
-	while (bt_gatt_iter_next_characteristic(&iter, &start, &end, &value,
-						&properties, u128.data)) {
+	rec = bt_gatt_result_characteristics(result, &chrc_count);
+	if (!rec)
+		goto failed;
+
+	for (i = 0; i < chrc_count; i++, rec++) {
+		memcpy(u128.data, rec->uuid, sizeof(u128.data));
 		bt_uuid128_create(&uuid, u128);
 
 		/* Log debug message */
-		bt_uuid_to_string(&uuid, uuid_str, sizeof(uuid_str));
-		DBG(client, "start: 0x%04x, end: 0x%04x, value: 0x%04x, "
-				"props: 0x%02x, uuid: %s",
-				start, end, value, properties, uuid_str);
+		if (client->debug_callback) {
+			bt_uuid_to_string(&uuid, uuid_str, sizeof(uuid_str));
+			DBG(client, "start: 0x%04x, end: 0x%04x, "
+					"value: 0x%04x, props: 0x%02x, "
+					"uuid: %s", rec->start_handle,
+					rec->end_handle, rec->value_handle,
+					rec->properties, uuid_str);
+		}
 
 		chrc_data = new0(struct chrc, 1);
 
-		chrc_data->start_handle = start;
-		chrc_data->end_handle = end;
-		chrc_data->value_handle = value;
-		chrc_data->properties = properties;
+		chrc_data->start_handle = rec->start_handle;
+		chrc_data->end_handle = rec->end_handle;
+		chrc_data->value_handle = rec->value_handle;
+		chrc_data->properties = rec->properties;
 		chrc_data->uuid = uuid;
 
 		queue_push_tail(op->pending_chrcs, chrc_data);
@@ -1187,22 +1296,38 @@ static void discovery_found_service(struct discovery_op *op,
 }
 
 static bool discovery_parse_services(struct discovery_op *op, bool primary,
-						struct bt_gatt_iter *iter)
+						struct bt_gatt_result *result)
 {
 	struct bt_gatt_client *client = op->client;
+	const struct bt_gatt_record *rec;
 	struct gatt_db_attribute *attr;
+	unsigned int count, i;
 	uint16_t start, end;
 	uint128_t u128;
 	bt_uuid_t uuid;
 	char uuid_str[MAX_LEN_UUID_STR];
 
-	while (bt_gatt_iter_next_service(iter, &start, &end, u128.data)) {
+	rec = bt_gatt_result_services(result, &count);
+	if (!rec) {
+		DBG(client, "Failed to parse services");
+		return false;
+	}
+
+	DBG(client, "%s services found: %u", primary ? "Primary" : "Secondary",
+								count);
+
+	for (i = 0; i < count; i++, rec++) {
+		start = rec->start_handle;
+		end = rec->end_handle;
+		memcpy(u128.data, rec->uuid, sizeof(u128.data));
 		bt_uuid128_create(&uuid, u128);
 
 		/* Log debug message */
-		bt_uuid_to_string(&uuid, uuid_str, sizeof(uuid_str));
-		DBG(client, "start: 0x%04x, end: 0x%04x, uuid: %s",
-				start, end, uuid_str);
+		if (client->debug_callback) {
+			bt_uuid_to_string(&uuid, uuid_str, sizeof(uuid_str));
+			DBG(client, "start: 0x%04x, end: 0x%04x, uuid: %s",
+							start, end, uuid_str);
+		}
 
 		/* Store the service */
 		attr = gatt_db_insert_service(client->db, start, &uuid, primary,
@@ -1232,7 +1357,6 @@ static void discover_secondary_cb(bool success, uint8_t att_ecode,
 {
 	struct discovery_op *op = user_data;
 	struct bt_gatt_client *client = op->client;
-	struct bt_gatt_iter iter;
 	struct handle_range *range;
 
 	discovery_req_clear(client);
@@ -1251,15 +1375,12 @@ static void discover_secondary_cb(bool success, uint8_t att_ecode,
 		}
 	}
 
-	if (!result || !bt_gatt_iter_init(&iter, result)) {
+	if (!result) {
 		success = false;
 		goto done;
 	}
 
-	DBG(client, "Secondary services found: %u",
-					bt_gatt_result_service_count(result));
-
-	if (!discovery_parse_services(op, false, &iter)) {
+	if (!discovery_parse_services(op, false, result)) {
 		success = false;
 		goto done;
 	}
@@ -1300,7 +1421,6 @@ static void discover_primary_cb(bool success, uint8_t att_ecode,
 {
 	struct discovery_op *op = user_data;
 	struct bt_gatt_client *client = op->client;
-	struct bt_gatt_iter iter;
 
 	discovery_req_clear(client);
 
@@ -1318,15 +1438,12 @@ static void discover_primary_cb(bool success, uint8_t att_ecode,
 		}
 	}
 
-	if (!result || !bt_gatt_iter_init(&iter, result)) {
+	if (!result) {
 		success = false;
 		goto done;
 	}
 
-	DBG(client, "Primary services found: %u",
-					bt_gatt_result_service_count(result));
-
-	if (!discovery_parse_services(op, true, &iter)) {
+	if (!discovery_parse_services(op, true, result)) {
 		success = false;
 		goto done;
 	}
@@ -1738,14 +1855,6 @@ static void enable_ccc_callback(bool success, uint8_t att_ecode,
 	bt_gatt_client_unref(notify_data->client);
 }
 
-static bool match_notify_chrc_value_handle(const void *a, const void *b)
-{
-	const struct notify_chrc *chrc = a;
-	uint16_t value_handle = PTR_TO_UINT(b);
-
-	return chrc->value_handle == value_handle;
-}
-
 static unsigned int register_notify(struct bt_gatt_client *client,
 				uint16_t handle,
 				bt_gatt_client_register_callback_t callback,
@@ -1757,8 +1866,7 @@ static unsigned int register_notify(struct bt_gatt_client *client,
 	struct notify_chrc *chrc = NULL;
 
 	/* Check if a characteristic ref count has been started already */
-	chrc = queue_find(client->notify_chrcs, match_notify_chrc_value_handle,
-						UINT_TO_PTR(handle));
+	chrc = notify_index_find(client, handle);
 
 	if (!chrc) {
 		/*
@@ -1786,8 +1894,12 @@ static unsigned int register_notify(struct bt_gatt_client *client,
 	notify_data->user_data = user_data;
 	notify_data->destroy = destroy;
 
-	/* Add the handler to the bt_gatt_client's general list */
+	/*
+	 * Add the handler to the bt_gatt_client's general list and to the
+	 * characteristic's own list used for dispatching.
+	 */
 	queue_push_tail(client->notify_list, notify_data);
+	queue_push_tail(chrc->notify_list, notify_data);
 
 	/* Assign an ID to the handler. */
 	if (client->next_reg_id < 1)
@@ -1819,6 +1931,7 @@ static unsigned int register_notify(struct bt_gatt_client *client,
 	/* Write to the CCC descriptor */
 	if (!notify_data_write_ccc(notify_data, true, enable_ccc_callback)) {
 		queue_remove(client->notify_list, notify_data);
+		queue_remove(chrc->notify_list, notify_data);
 		free(notify_data);
 		return 0;
 	}
@@ -2216,9 +2329,6 @@ static void notify_handler(void *data, void *user_data)
 	struct notify_data *notify_data = data;
 	struct value_data *value_data = user_data;
 
-	if (notify_data->chrc->value_handle != value_data->handle)
-		return;
-
 	/*
 	 * Even if the notify data has a pending ATT request to write to the
 	 * CCC, there is really no reason not to notify the handlers.
@@ -2233,6 +2343,7 @@ static void notify_cb(struct bt_att_chan *chan, uint8_t opcode,
 					void *user_data)
 {
 	struct bt_gatt_client *client = user_data;
+	struct notify_chrc *chrc;
 	struct value_data data;
 
 	bt_gatt_client_ref(client);
@@ -2257,8 +2368,10 @@ static void notify_cb(struct bt_att_chan *chan, uint8_t opcode,
 
 			data.data = pdu;
 
-			queue_foreach(client->notify_list, notify_handler,
-								&data);
+			chrc = notify_index_find(client, data.handle);
+			if (chrc)
+				queue_foreach(chrc->notify_list,
+							notify_handler, &data);
 
 			length -= data.len;
 			pdu += data.len;
@@ -2271,7 +2384,9 @@ static void notify_cb(struct bt_att_chan *chan, uint8_t opcode,
 		data.len = length;
 		data.data = pdu;
 
-		queue_foreach(client->notify_list, notify_handler, &data);
+		chrc = notify_index_find(client, data.handle);
+		if (chrc)
+			queue_foreach(chrc->notify_list, notify_handler, &data);
 	}
 
 done:
@@ -2282,12 +2397,19 @@ done:
 	bt_gatt_client_unref(client);
 }
 
+static void batch_read_free(void *data);
+static void read_batch_cancel(void *data);
+
 static void bt_gatt_client_free(struct bt_gatt_client *client)
 {
 	bt_gatt_client_cancel_all(client);
 
+	queue_destroy(client->batch_reads, batch_read_free);
+	queue_destroy(client->read_batches, read_batch_cancel);
+
 	queue_destroy(client->notify_chrcs, notify_chrc_free);
 	queue_destroy(client->notify_list, notify_data_cleanup);
+	free(client->notify_index);
 
 	queue_destroy(client->ready_cbs, ready_destroy);
 	queue_destroy(client->idle_cbs, idle_destroy);
@@ -2355,6 +2477,8 @@ static struct bt_gatt_client *gatt_client_new(struct gatt_db *db,
 	client->notify_list = queue_new();
 	client->notify_chrcs = queue_new();
 	client->pending_requests = queue_new();
+	client->batch_reads = queue_new();
+	client->read_batches = queue_new();
 
 	client->nfy_id = bt_att_register(att, BT_ATT_OP_HANDLE_NFY,
 						notify_cb, client, NULL);
@@ -2624,6 +2748,18 @@ static bool cancel_request(struct request *req)
 	if (req->prep_write)
 		return cancel_prep_write_session(req->client, req);
 
+	/*
+	 * Shares its PDU with other reads so leave an empty slot in the
+	 * batch to keep the position of the other values, and release the
+	 * request right away.
+	 */
+	if (req->batch_read) {
+		req->batch_read->req = NULL;
+		req->batch_read = NULL;
+		request_unref(req);
+		return true;
+	}
+
 	return bt_att_cancel(req->client->att, req->att_id);
 }
 
@@ -2713,6 +2849,288 @@ done:
 		op->callback(success, att_ecode, value, length, op->user_data);
 }
 
+struct read_batch {
+	struct bt_gatt_client *client;
+	struct bt_att *att;
+	unsigned int att_id;
+	struct queue *reads;
+};
+
+static struct bt_gatt_client *client_root(struct bt_gatt_client *client)
+{
+	while (client->parent)
+		client = client->parent;
+
+	return client;
+}
+
+static void batch_read_free(void *data)
+{
+	struct batch_read *read = data;
+
+	/* Canceled reads leave an empty slot */
+	if (read->req) {
+		read->req->batch_read = NULL;
+		request_unref(read->req);
+	}
+
+	free(read);
+}
+
+static void batch_read_complete(struct batch_read *read, bool success,
+					uint8_t att_ecode, const uint8_t *value,
+					uint16_t length)
+{
+	struct read_op *op = read->req ? read->req->data : NULL;
+
+	if (op && !read->req->removed && op->callback)
+		op->callback(success, att_ecode, value, length, op->user_data);
+
+	batch_read_free(read);
+}
+
+static void batch_read_send(struct bt_att *att, struct batch_read *read)
+{
+	struct request *req = read->req;
+	uint8_t pdu[2];
+
+	if (!req || req->removed) {
+		batch_read_free(read);
+		return;
+	}
+
+	req->batch_read = NULL;
+
+	put_le16(read->handle, pdu);
+
+	/* The request reference is handed over to the ATT operation */
+	req->att_id = bt_att_send(att, BT_ATT_OP_READ_REQ, pdu, sizeof(pdu),
+						read_cb, req, request_unref);
+	if (!req->att_id) {
+		batch_read_complete(read, false, 0, NULL, 0);
+		return;
+	}
+
+	free(read);
+}
+
+static void read_batch_free(void *data)
+{
+	struct read_batch *batch = data;
+
+	if (batch->client)
+		queue_remove(batch->client->read_batches, batch);
+
+	queue_destroy(batch->reads, batch_read_free);
+	bt_att_unref(batch->att);
+	free(batch);
+}
+
+static void read_batch_cancel(void *data)
+{
+	struct read_batch *batch = data;
+
+	/* Already removed from the client so don't let the destroy touch it */
+	batch->client = NULL;
+
+	bt_att_cancel(batch->att, batch->att_id);
+}
+
+static void read_batch_send(struct bt_gatt_client *client,
+						struct read_batch *batch);
+
+static bool match_read_canceled(const void *data, const void *match_data)
+{
+	const struct batch_read *read = data;
+
+	return !read->req;
+}
+
+static void read_batch_cb(uint8_t opcode, const void *pdu, uint16_t length,
+								void *user_data)
+{
+	struct read_batch *batch = user_data;
+	struct bt_gatt_client *client = bt_gatt_client_ref_safe(batch->client);
+	struct queue *reads = batch->reads;
+	struct bt_att *att = bt_att_ref(batch->att);
+	struct batch_read *read;
+	const uint8_t *ptr = pdu;
+	bool success = true;
+	unsigned int done = 0;
+
+	/* Callbacks may end up canceling, and thus freeing, the batch */
+	batch->reads = queue_new();
+
+	if (opcode != BT_ATT_OP_READ_MULT_VL_RSP || (!pdu && length)) {
+		/* Read each value on its own so each gets its own error */
+		success = false;
+		length = 0;
+	}
+
+	while ((read = queue_peek_head(reads))) {
+		uint16_t len;
+
+		if (length < 2)
+			break;
+
+		len = get_le16(ptr);
+
+		/* Truncated due to the MTU, read it again */
+		if (len > length - 2)
+			break;
+
+		queue_pop_head(reads);
+		batch_read_complete(read, true, 0, len ? ptr + 2 : NULL, len);
+
+		ptr += 2 + len;
+		length -= 2 + len;
+		done++;
+	}
+
+	/* Canceled reads need no slot in the next request */
+	queue_remove_all(reads, match_read_canceled, NULL, batch_read_free);
+
+	/* Whatever did not fit in the response goes into another batch */
+	if (success && done && client && client->att &&
+						queue_length(reads) > 1) {
+		struct read_batch *next = new0(struct read_batch, 1);
+
+		next->reads = reads;
+		read_batch_send(client, next);
+	} else {
+		while ((read = queue_pop_head(reads)))
+			batch_read_send(att, read);
+
+		queue_destroy(reads, NULL);
+	}
+
+	bt_att_unref(att);
+	bt_gatt_client_unref(client);
+}
+
+static void read_batch_send(struct bt_gatt_client *client,
+						struct read_batch *batch)
+{
+	unsigned int count = queue_length(batch->reads);
+	const struct queue_entry *entry;
+	struct batch_read *read;
+	uint8_t *pdu = newa(uint8_t, count * 2);
+	uint8_t *ptr = pdu;
+
+	for (entry = queue_get_entries(batch->reads); entry;
+						entry = entry->next) {
+		read = entry->data;
+		put_le16(read->handle, ptr);
+		ptr += 2;
+	}
+
+	batch->client = client;
+	batch->att = bt_att_ref(client->att);
+	queue_push_tail(client->read_batches, batch);
+
+	batch->att_id = bt_att_send(client->att, BT_ATT_OP_READ_MULT_VL_REQ,
+						pdu, count * 2, read_batch_cb,
+						batch, read_batch_free);
+	if (batch->att_id)
+		return;
+
+	while ((read = queue_pop_head(batch->reads)))
+		batch_read_send(batch->att, read);
+
+	read_batch_free(batch);
+}
+
+static void read_batch_flush(struct bt_gatt_client *client)
+{
+	unsigned int max;
+	struct batch_read *read;
+
+	if (!client->att) {
+		while ((read = queue_pop_head(client->batch_reads)))
+			batch_read_complete(read, false, 0, NULL, 0);
+		return;
+	}
+
+	max = (bt_att_get_mtu(client->att) - 1) / 2;
+
+	while (!queue_isempty(client->batch_reads)) {
+		struct read_batch *batch;
+
+		batch = new0(struct read_batch, 1);
+		batch->reads = queue_new();
+
+		while (queue_length(batch->reads) < max &&
+				(read = queue_pop_head(client->batch_reads))) {
+			if (!read->req || read->req->removed) {
+				batch_read_free(read);
+				continue;
+			}
+
+			queue_push_tail(batch->reads, read);
+		}
+
+		switch (queue_length(batch->reads)) {
+		case 0:
+			break;
+		case 1:
+			batch_read_send(client->att,
+					queue_pop_head(batch->reads));
+			break;
+		default:
+			read_batch_send(client, batch);
+			continue;
+		}
+
+		queue_destroy(batch->reads, NULL);
+		free(batch);
+	}
+}
+
+static bool read_batch_add(struct bt_gatt_client *client,
+					struct request *req, uint16_t handle)
+{
+	struct batch_read *read;
+
+	client = client_root(client);
+
+	if (!client->read_batch_depth)
+		return false;
+
+	/* Read Multiple Variable Length is mandatory with EATT support */
+	if (!(client->features & BT_GATT_CHRC_CLI_FEAT_EATT))
+		return false;
+
+	read = new0(struct batch_read, 1);
+	read->req = req;
+	read->handle = handle;
+	req->batch_read = read;
+
+	queue_push_tail(client->batch_reads, read);
+
+	return true;
+}
+
+void bt_gatt_client_read_batch_begin(struct bt_gatt_client *client)
+{
+	if (!client)
+		return;
+
+	client_root(client)->read_batch_depth++;
+}
+
+void bt_gatt_client_read_batch_end(struct bt_gatt_client *client)
+{
+	if (!client)
+		return;
+
+	client = client_root(client);
+
+	if (!client->read_batch_depth || --client->read_batch_depth)
+		return;
+
+	read_batch_flush(client);
+}
+
 unsigned int bt_gatt_client_read_value(struct bt_gatt_client *client,
 					uint16_t value_handle,
 					bt_gatt_client_read_callback_t callback,
@@ -2741,6 +3159,9 @@ unsigned int bt_gatt_client_read_value(struct bt_gatt_client *client,
 	req->data = op;
 	req->destroy = destroy_read_op;
 
+	if (read_batch_add(client, req, value_handle))
+		return req->id;
+
 	put_le16(value_handle, pdu);
 
 	req->att_id = bt_att_send(client->att, BT_ATT_OP_READ_REQ,
@@ -2807,9 +3228,12 @@ static void read_multiple_cb(uint8_t opcode, const void *pdu, uint16_t length,
 		 * current ATT_MTU.
 		 */
 		if (len > length)
-			length = len;
+			len = length;
 
 		op->callback(success, att_ecode, pdu, len, op->user_data);
+
+		pdu += len;
+		length -= len;
 	}
 }
 
@@ -3761,6 +4185,7 @@ bool bt_gatt_client_unregister_notify(struct bt_gatt_client *client,
 
 	/* Remove data if it has been queued */
 	queue_remove(notify_data->chrc->reg_notify_queue, notify_data);
+	queue_remove(notify_data->chrc->notify_list, notify_data);
 
 	/* Reset callbacks */
 	notify_data->callback = NULL;
@@ -85,6 +85,9 @@ unsigned int bt_gatt_client_read_multiple(struct bt_gatt_client *client,
 					void *user_data,
 					bt_gatt_client_destroy_func_t destroy);
 
+void bt_gatt_client_read_batch_begin(struct bt_gatt_client *client);
+void bt_gatt_client_read_batch_end(struct bt_gatt_client *client);
+
 unsigned int bt_gatt_client_write_without_response(
 					struct bt_gatt_client *client,
 					uint16_t value_handle,
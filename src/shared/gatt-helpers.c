@@ -32,6 +32,10 @@ struct bt_gatt_result {
 
 	void *op;  /* Discovery operation data */
 
+	/* Records decoded on first access, only set on the first result */
+	struct bt_gatt_record *records;
+	unsigned int num_records;
+
 	struct bt_gatt_result *next;
 };
 
@@ -66,6 +70,7 @@ static void result_destroy(struct bt_gatt_result *result)
 	while (result) {
 		next = result->next;
 
+		free(result->records);
 		free(result->pdu);
 		free(result);
 
@@ -463,6 +468,123 @@ bool bt_gatt_iter_next_read_by_type(struct bt_gatt_iter *iter,
 	return true;
 }
 
+const struct bt_gatt_record *bt_gatt_result_services(
+					struct bt_gatt_result *result,
+					unsigned int *count)
+{
+	struct bt_gatt_request *op;
+	struct bt_gatt_result *cur;
+	struct bt_gatt_record *rec;
+	uint8_t uuid[16];
+	bt_uuid_t tmp;
+	uint16_t pos;
+
+	if (!result || !count)
+		return NULL;
+
+	if (result->opcode != BT_ATT_OP_READ_BY_GRP_TYPE_RSP &&
+			result->opcode != BT_ATT_OP_FIND_BY_TYPE_RSP)
+		return NULL;
+
+	if (result->records)
+		goto done;
+
+	/* UUID is only present in the request of Find By Type Value */
+	op = result->op;
+	if (result->opcode == BT_ATT_OP_FIND_BY_TYPE_RSP) {
+		bt_uuid_to_uuid128(&op->uuid, &tmp);
+		memcpy(uuid, tmp.value.u128.data, 16);
+	}
+
+	result->records = new0(struct bt_gatt_record,
+					result_element_count(result));
+	rec = result->records;
+
+	for (cur = result; cur; cur = cur->next) {
+		for (pos = 0; pos + cur->data_len <= cur->pdu_len;
+						pos += cur->data_len, rec++) {
+			const uint8_t *pdu_ptr = cur->pdu + pos;
+
+			rec->start_handle = get_le16(pdu_ptr);
+			rec->end_handle = get_le16(pdu_ptr + 2);
+
+			if (cur->opcode == BT_ATT_OP_FIND_BY_TYPE_RSP)
+				memcpy(rec->uuid, uuid, 16);
+			else
+				convert_uuid_le(pdu_ptr + 4, cur->data_len - 4,
+								rec->uuid);
+		}
+	}
+
+	result->num_records = rec - result->records;
+
+done:
+	*count = result->num_records;
+
+	return result->records;
+}
+
+const struct bt_gatt_record *bt_gatt_result_characteristics(
+					struct bt_gatt_result *result,
+					unsigned int *count)
+{
+	struct bt_gatt_request *op;
+	struct bt_gatt_result *cur;
+	struct bt_gatt_record *rec;
+	unsigned int i;
+	uint16_t pos;
+
+	if (!result || !count)
+		return NULL;
+
+	if (result->opcode != BT_ATT_OP_READ_BY_TYPE_RSP)
+		return NULL;
+
+	/* UUID in discovery_op is set in read_by_type and service_discovery */
+	op = result->op;
+	if (op->uuid.type != BT_UUID_UNSPEC)
+		return NULL;
+
+	if (result->records)
+		goto done;
+
+	result->records = new0(struct bt_gatt_record,
+					result_element_count(result));
+	rec = result->records;
+
+	for (cur = result; cur; cur = cur->next) {
+		/* Stop at the first PDU the iterator would reject */
+		if (cur->data_len != 21 && cur->data_len != 7)
+			break;
+
+		for (pos = 0; pos + cur->data_len <= cur->pdu_len;
+						pos += cur->data_len, rec++) {
+			const uint8_t *pdu_ptr = cur->pdu + pos;
+
+			rec->start_handle = get_le16(pdu_ptr);
+			rec->properties = pdu_ptr[2];
+			rec->value_handle = get_le16(pdu_ptr + 3);
+			convert_uuid_le(pdu_ptr + 5, cur->data_len - 5,
+								rec->uuid);
+		}
+	}
+
+	result->num_records = rec - result->records;
+
+	/* Each characteristic ends right before the next one starts */
+	for (i = 0; i + 1 < result->num_records; i++)
+		result->records[i].end_handle =
+				result->records[i + 1].start_handle - 1;
+
+	if (result->num_records)
+		result->records[i].end_handle = op->end_handle;
+
+done:
+	*count = result->num_records;
+
+	return result->records;
+}
+
 struct mtu_op {
 	struct bt_att *att;
 	uint16_t client_rx_mtu;
@@ -22,11 +22,27 @@ struct bt_gatt_iter {
 	uint16_t pos;
 };
 
+/* Discovery result entry decoded once from the response PDUs */
+struct bt_gatt_record {
+	uint16_t start_handle;
+	uint16_t end_handle;
+	uint16_t value_handle;
+	uint8_t properties;
+	uint8_t uuid[16];
+};
+
 unsigned int bt_gatt_result_service_count(struct bt_gatt_result *result);
 unsigned int bt_gatt_result_characteristic_count(struct bt_gatt_result *result);
 unsigned int bt_gatt_result_descriptor_count(struct bt_gatt_result *result);
 unsigned int bt_gatt_result_included_count(struct bt_gatt_result *result);
 
+const struct bt_gatt_record *bt_gatt_result_services(
+					struct bt_gatt_result *result,
+					unsigned int *count);
+const struct bt_gatt_record *bt_gatt_result_characteristics(
+					struct bt_gatt_result *result,
+					unsigned int *count);
+
 bool bt_gatt_iter_init(struct bt_gatt_iter *iter, struct bt_gatt_result *result);
 bool bt_gatt_iter_next_service(struct bt_gatt_iter *iter,
 				uint16_t *start_handle, uint16_t *end_handle,
@@ -15,6 +15,7 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
 #include <sys/socket.h>
 #include <sys/uio.h>
 
@@ -53,6 +54,16 @@ struct bt_hci {
 	struct queue *cmd_queue;
 	struct queue *rsp_queue;
 	struct queue *evt_list;
+	struct queue *cmd_stats;
+};
+
+struct cmd_seq {
+	int ref_count;
+	uint8_t status;
+	uint16_t opcode;
+	bt_hci_seq_func_t callback;
+	bt_hci_destroy_func_t destroy;
+	void *user_data;
 };
 
 struct cmd {
@@ -60,6 +71,8 @@ struct cmd {
 	uint16_t opcode;
 	void *data;
 	uint8_t size;
+	uint64_t sent;
+	struct cmd_seq *seq;
 	bt_hci_callback_func_t callback;
 	bt_hci_destroy_func_t destroy;
 	void *user_data;
@@ -73,10 +86,33 @@ struct evt {
 	void *user_data;
 };
 
+static uint64_t get_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void seq_unref(struct cmd_seq *seq)
+{
+	if (--seq->ref_count)
+		return;
+
+	if (seq->destroy)
+		seq->destroy(seq->user_data);
+
+	free(seq);
+}
+
 static void cmd_free(void *data)
 {
 	struct cmd *cmd = data;
 
+	if (cmd->seq)
+		seq_unref(cmd->seq);
+
 	if (cmd->destroy)
 		cmd->destroy(cmd->user_data);
 
@@ -94,7 +130,7 @@ static void evt_free(void *data)
 	free(evt);
 }
 
-static void send_command(struct bt_hci *hci, uint16_t opcode,
+static bool send_command(struct bt_hci *hci, uint16_t opcode,
 						void *data, uint8_t size)
 {
 	uint8_t type = BT_H4_CMD_PKT;
@@ -103,7 +139,7 @@ static void send_command(struct bt_hci *hci, uint16_t opcode,
 	int iovcnt;
 
 	if (hci->num_cmds < 1)
-		return;
+		return false;
 
 	hdr.opcode = cpu_to_le16(opcode);
 	hdr.plen = size;
@@ -121,9 +157,11 @@ static void send_command(struct bt_hci *hci, uint16_t opcode,
 		iovcnt = 2;
 
 	if (io_send(hci->io, iov, iovcnt) < 0)
-		return;
+		return false;
 
 	hci->num_cmds--;
+
+	return true;
 }
 
 static bool io_write_callback(struct io *io, void *user_data)
@@ -131,11 +169,20 @@ static bool io_write_callback(struct io *io, void *user_data)
 	struct bt_hci *hci = user_data;
 	struct cmd *cmd;
 
-	cmd = queue_pop_head(hci->cmd_queue);
-	if (cmd) {
-		send_command(hci, cmd->opcode, cmd->data, cmd->size);
+	/* Pipeline as many commands as the controller has credits for */
+	do {
+		cmd = queue_pop_head(hci->cmd_queue);
+		if (!cmd)
+			break;
+
+		if (!send_command(hci, cmd->opcode, cmd->data, cmd->size)) {
+			queue_push_tail(hci->rsp_queue, cmd);
+			break;
+		}
+
+		cmd->sent = get_time_us();
 		queue_push_tail(hci->rsp_queue, cmd);
-	}
+	} while (hci->num_cmds > 0);
 
 	hci->writer_active = false;
 
@@ -167,6 +214,76 @@ static bool match_cmd_opcode(const void *a, const void *b)
 	return cmd->opcode == opcode;
 }
 
+static bool match_stats_opcode(const void *a, const void *b)
+{
+	const struct bt_hci_cmd_stats *stats = a;
+	uint16_t opcode = PTR_TO_UINT(b);
+
+	return stats->opcode == opcode;
+}
+
+static void update_stats(struct bt_hci *hci, struct cmd *cmd)
+{
+	struct bt_hci_cmd_stats *stats;
+	uint64_t elapsed;
+
+	if (!cmd->sent)
+		return;
+
+	elapsed = get_time_us() - cmd->sent;
+
+	stats = queue_find(hci->cmd_stats, match_stats_opcode,
+						UINT_TO_PTR(cmd->opcode));
+	if (!stats) {
+		stats = new0(struct bt_hci_cmd_stats, 1);
+		stats->opcode = cmd->opcode;
+		stats->min_us = UINT64_MAX;
+		queue_push_tail(hci->cmd_stats, stats);
+	}
+
+	stats->count++;
+	stats->total_us += elapsed;
+
+	if (elapsed < stats->min_us)
+		stats->min_us = elapsed;
+
+	if (elapsed > stats->max_us)
+		stats->max_us = elapsed;
+}
+
+static bool match_cmd_id(const void *a, const void *b)
+{
+	const struct cmd *cmd = a;
+	unsigned int id = PTR_TO_UINT(b);
+
+	return cmd->id == id;
+}
+
+static void process_seq_response(struct bt_hci *hci, struct cmd *cmd,
+					const void *data, size_t size)
+{
+	struct cmd_seq *seq = cmd->seq;
+	uint8_t status = size ? *((const uint8_t *) data) : 0;
+
+	/* Don't send the rest of the sequence once a command has failed */
+	if (status && !seq->status) {
+		seq->status = status;
+		seq->opcode = cmd->opcode;
+
+		queue_remove_all(hci->cmd_queue, match_cmd_id,
+					UINT_TO_PTR(cmd->id), cmd_free);
+	}
+
+	if (queue_find(hci->cmd_queue, match_cmd_id, UINT_TO_PTR(cmd->id)) ||
+			queue_find(hci->rsp_queue, match_cmd_id,
+						UINT_TO_PTR(cmd->id)))
+		return;
+
+	if (seq->callback)
+		seq->callback(seq->status ? seq->opcode : cmd->opcode,
+						seq->status, seq->user_data);
+}
+
 static void process_response(struct bt_hci *hci, uint16_t opcode,
 					const void *data, size_t size)
 {
@@ -187,7 +304,11 @@ static void process_response(struct bt_hci *hci, uint16_t opcode,
 	 */
 	bt_hci_ref(hci);
 
-	if (cmd->callback)
+	update_stats(hci, cmd);
+
+	if (cmd->seq)
+		process_seq_response(hci, cmd, data, size);
+	else if (cmd->callback)
 		cmd->callback(data, size, cmd->user_data);
 
 	cmd_free(cmd);
@@ -300,8 +421,10 @@ static struct bt_hci *create_hci(int fd)
 	hci->cmd_queue = queue_new();
 	hci->rsp_queue = queue_new();
 	hci->evt_list = queue_new();
+	hci->cmd_stats = queue_new();
 
 	if (!io_set_read_handler(hci->io, io_read_callback, hci, NULL)) {
+		queue_destroy(hci->cmd_stats, NULL);
 		queue_destroy(hci->evt_list, NULL);
 		queue_destroy(hci->rsp_queue, NULL);
 		queue_destroy(hci->cmd_queue, NULL);
@@ -423,6 +546,7 @@ void bt_hci_unref(struct bt_hci *hci)
 	queue_destroy(hci->evt_list, evt_free);
 	queue_destroy(hci->cmd_queue, cmd_free);
 	queue_destroy(hci->rsp_queue, cmd_free);
+	queue_destroy(hci->cmd_stats, free);
 
 	io_destroy(hci->io);
 
@@ -481,36 +605,84 @@ unsigned int bt_hci_send(struct bt_hci *hci, uint16_t opcode,
 	return cmd->id;
 }
 
-static bool match_cmd_id(const void *a, const void *b)
+unsigned int bt_hci_send_seq(struct bt_hci *hci,
+				const struct bt_hci_seq_cmd *cmds,
+				unsigned int num_cmds,
+				bt_hci_seq_func_t callback,
+				void *user_data, bt_hci_destroy_func_t destroy)
 {
-	const struct cmd *cmd = a;
-	unsigned int id = PTR_TO_UINT(b);
+	struct cmd_seq *seq;
+	unsigned int i, id;
 
-	return cmd->id == id;
+	if (!hci || !cmds || !num_cmds)
+		return 0;
+
+	if (hci->next_cmd_id < 1)
+		hci->next_cmd_id = 1;
+
+	/* All commands of a sequence share the same id */
+	id = hci->next_cmd_id++;
+
+	seq = new0(struct cmd_seq, 1);
+	seq->callback = callback;
+	seq->destroy = destroy;
+	seq->user_data = user_data;
+
+	for (i = 0; i < num_cmds; i++) {
+		struct cmd *cmd;
+
+		cmd = new0(struct cmd, 1);
+		cmd->id = id;
+		cmd->opcode = cmds[i].opcode;
+		cmd->size = cmds[i].size;
+
+		if (cmd->size > 0)
+			cmd->data = util_memdup(cmds[i].data, cmd->size);
+
+		cmd->seq = seq;
+		seq->ref_count++;
+
+		queue_push_tail(hci->cmd_queue, cmd);
+	}
+
+	wakeup_writer(hci);
+
+	return id;
 }
 
 bool bt_hci_cancel(struct bt_hci *hci, unsigned int id)
 {
-	struct cmd *cmd;
+	unsigned int count;
 
 	if (!hci || !id)
 		return false;
 
-	cmd = queue_remove_if(hci->cmd_queue, match_cmd_id, UINT_TO_PTR(id));
-	if (!cmd) {
-		cmd = queue_remove_if(hci->rsp_queue, match_cmd_id,
-							UINT_TO_PTR(id));
-		if (!cmd)
-			return false;
-	}
-
-	cmd_free(cmd);
+	/* Sequences have several commands with the same id */
+	count = queue_remove_all(hci->cmd_queue, match_cmd_id,
+						UINT_TO_PTR(id), cmd_free);
+	count += queue_remove_all(hci->rsp_queue, match_cmd_id,
+						UINT_TO_PTR(id), cmd_free);
+	if (!count)
+		return false;
 
 	wakeup_writer(hci);
 
 	return true;
 }
 
+void bt_hci_foreach_cmd_stats(struct bt_hci *hci,
+				bt_hci_cmd_stats_func_t func, void *user_data)
+{
+	const struct queue_entry *entry;
+
+	if (!hci || !func)
+		return;
+
+	for (entry = queue_get_entries(hci->cmd_stats); entry;
+							entry = entry->next)
+		func(entry->data, user_data);
+}
+
 bool bt_hci_flush(struct bt_hci *hci)
 {
 	if (!hci)
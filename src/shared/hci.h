@@ -31,6 +31,21 @@ unsigned int bt_hci_send(struct bt_hci *hci, uint16_t opcode,
 				const void *data, uint8_t size,
 				bt_hci_callback_func_t callback,
 				void *user_data, bt_hci_destroy_func_t destroy);
+
+struct bt_hci_seq_cmd {
+	uint16_t opcode;
+	const void *data;
+	uint8_t size;
+};
+
+typedef void (*bt_hci_seq_func_t)(uint16_t opcode, uint8_t status,
+							void *user_data);
+
+unsigned int bt_hci_send_seq(struct bt_hci *hci,
+				const struct bt_hci_seq_cmd *cmds,
+				unsigned int num_cmds,
+				bt_hci_seq_func_t callback,
+				void *user_data, bt_hci_destroy_func_t destroy);
 bool bt_hci_cancel(struct bt_hci *hci, unsigned int id);
 bool bt_hci_flush(struct bt_hci *hci);
 
@@ -38,3 +53,17 @@ unsigned int bt_hci_register(struct bt_hci *hci, uint8_t event,
 				bt_hci_callback_func_t callback,
 				void *user_data, bt_hci_destroy_func_t destroy);
 bool bt_hci_unregister(struct bt_hci *hci, unsigned int id);
+
+struct bt_hci_cmd_stats {
+	uint16_t opcode;
+	unsigned int count;
+	uint64_t total_us;
+	uint64_t min_us;
+	uint64_t max_us;
+};
+
+typedef void (*bt_hci_cmd_stats_func_t)(const struct bt_hci_cmd_stats *stats,
+							void *user_data);
+
+void bt_hci_foreach_cmd_stats(struct bt_hci *hci,
+				bt_hci_cmd_stats_func_t func, void *user_data);
@@ -883,8 +883,13 @@ bool bt_micp_attach(struct bt_micp *micp, struct bt_gatt_client *client)
 
 	bt_gatt_client_idle_register(micp->client, micp_idle, micp, NULL);
 
+	bt_gatt_client_read_batch_begin(micp->client);
+
 	bt_uuid16_create(&uuid, MICS_UUID);
 	gatt_db_foreach_service(micp->ldb->db, &uuid, foreach_mics_service,
 						micp);
+
+	bt_gatt_client_read_batch_end(micp->client);
+
 	return true;
 }
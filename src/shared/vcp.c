@@ -2740,6 +2740,9 @@ bool bt_vcp_attach(struct bt_vcp *vcp, struct bt_gatt_client *client)
 	if (!vcp->client)
 		return false;
 
+	/* Coalesce the initial reads of all services */
+	bt_gatt_client_read_batch_begin(vcp->client);
+
 	bt_uuid16_create(&uuid, VCS_UUID);
 	gatt_db_foreach_service(vcp->rdb->db, &uuid, foreach_vcs_service, vcp);
 
@@ -2749,6 +2752,8 @@ bool bt_vcp_attach(struct bt_vcp *vcp, struct bt_gatt_client *client)
 	bt_uuid16_create(&uuid, AUDIO_INPUT_CS_UUID);
 	gatt_db_foreach_service(vcp->rdb->db, &uuid, foreach_aics_service, vcp);
 
+	bt_gatt_client_read_batch_end(vcp->client);
+
 	return true;
 }
 
@@ -25,6 +25,7 @@
 #include <getopt.h>
 #include <endian.h>
 #include <arpa/inet.h>
+#include <time.h>
 #include <sys/stat.h>
 
 #include "src/shared/btsnoop.h"
@@ -114,23 +115,143 @@ static int open_btsnoop(const char *path, uint32_t *type)
 	return fd;
 }
 
-#define MAX_MERGE 8
+#define MERGE_BUF_SIZE	65536
+#define MERGE_MAX_DATA	2048
 
-static void command_merge(const char *output, int argc, char *argv[])
+struct merge_input {
+	int fd;
+	uint16_t index;
+	struct btsnoop_pkt pkt;
+	size_t pos;
+	size_t len;
+	uint8_t buf[MERGE_BUF_SIZE];
+};
+
+struct merge_output {
+	int fd;
+	size_t len;
+	uint8_t buf[MERGE_BUF_SIZE];
+};
+
+static bool merge_read(struct merge_input *input, void *data, size_t size)
 {
-	struct btsnoop_pkt input_pkt[MAX_MERGE];
-	unsigned char buf[2048];
-	int output_fd, input_fd[MAX_MERGE], num_input = 0;
-	int i, select_input;
-	ssize_t len, written;
+	uint8_t *ptr = data;
+
+	while (size) {
+		size_t count;
+
+		if (input->pos == input->len) {
+			ssize_t len;
+
+			len = read(input->fd, input->buf, sizeof(input->buf));
+			if (len <= 0)
+				return false;
+
+			input->pos = 0;
+			input->len = len;
+		}
+
+		count = input->len - input->pos;
+		if (count > size)
+			count = size;
+
+		memcpy(ptr, input->buf + input->pos, count);
+		input->pos += count;
+		ptr += count;
+		size -= count;
+	}
+
+	return true;
+}
+
+static bool merge_flush(struct merge_output *output)
+{
+	ssize_t written;
+
+	if (!output->len)
+		return true;
+
+	written = write(output->fd, output->buf, output->len);
+	if (written != (ssize_t) output->len)
+		return false;
+
+	output->len = 0;
+
+	return true;
+}
+
+static bool merge_write(struct merge_output *output, const void *data,
+								size_t size)
+{
+	if (output->len + size > sizeof(output->buf) && !merge_flush(output))
+		return false;
+
+	memcpy(output->buf + output->len, data, size);
+	output->len += size;
+
+	return true;
+}
+
+/* Order by timestamp, and by input on ties to keep the merge stable */
+static bool merge_before(const struct merge_input *a,
+					const struct merge_input *b)
+{
+	uint64_t ts_a = be64toh(a->pkt.ts);
+	uint64_t ts_b = be64toh(b->pkt.ts);
+
+	if (ts_a != ts_b)
+		return ts_a < ts_b;
+
+	return a->index < b->index;
+}
+
+static void merge_sift_down(struct merge_input **heap, int num, int i)
+{
+	for (;;) {
+		struct merge_input *tmp;
+		int min = i, child = 2 * i + 1;
+
+		if (child < num && merge_before(heap[child], heap[min]))
+			min = child;
+
+		if (child + 1 < num && merge_before(heap[child + 1], heap[min]))
+			min = child + 1;
+
+		if (min == i)
+			return;
+
+		tmp = heap[i];
+		heap[i] = heap[min];
+		heap[min] = tmp;
+		i = min;
+	}
+}
+
+static void command_merge(const char *output_path, int argc, char *argv[])
+{
+	struct merge_input *inputs, **heap;
+	struct merge_output *output;
+	unsigned char buf[MERGE_MAX_DATA];
+	int num_input = 0, num_heap = 0;
+	int i;
 	uint32_t toread, flags;
-	uint16_t index, opcode;
+	uint16_t opcode;
 
-	if (argc > MAX_MERGE) {
-		fprintf(stderr, "only up to %d files allowed\n", MAX_MERGE);
+	/* The input is recorded as controller index of each packet */
+	if (argc > UINT16_MAX + 1) {
+		fprintf(stderr, "only up to %d files allowed\n",
+							UINT16_MAX + 1);
 		return;
 	}
 
+	inputs = calloc(argc, sizeof(*inputs));
+	heap = calloc(argc, sizeof(*heap));
+	output = calloc(1, sizeof(*output));
+	if (!inputs || !heap || !output) {
+		fprintf(stderr, "failed to allocate memory\n");
+		goto done;
+	}
+
 	for (i = 0; i < argc; i++) {
 		uint32_t type;
 		int fd;
@@ -146,7 +267,9 @@ static void command_merge(const char *output, int argc, char *argv[])
 			break;
 		}
 
-		input_fd[num_input++] = fd;
+		inputs[num_input].fd = fd;
+		inputs[num_input].index = num_input;
+		num_input++;
 	}
 
 	if (num_input != argc) {
@@ -154,109 +277,201 @@ static void command_merge(const char *output, int argc, char *argv[])
 		goto close_input;
 	}
 
-	output_fd = create_btsnoop(output);
-	if (output_fd < 0)
+	output->fd = create_btsnoop(output_path);
+	if (output->fd < 0)
 		goto close_input;
 
 	for (i = 0; i < num_input; i++) {
-		len = read(input_fd[i], &input_pkt[i], BTSNOOP_PKT_SIZE);
-		if (len < 0 || len != BTSNOOP_PKT_SIZE) {
-			close(input_fd[i]);
-			input_fd[i] = -1;
-		}
+		if (merge_read(&inputs[i], &inputs[i].pkt, BTSNOOP_PKT_SIZE))
+			heap[num_heap++] = &inputs[i];
 	}
 
-next_packet:
-	select_input = -1;
+	for (i = num_heap / 2 - 1; i >= 0; i--)
+		merge_sift_down(heap, num_heap, i);
 
-	for (i = 0; i < num_input; i++) {
-		uint64_t ts;
+	while (num_heap) {
+		struct merge_input *input = heap[0];
 
-		if (input_fd[i] < 0)
-			continue;
+		toread = be32toh(input->pkt.size);
+		flags = be32toh(input->pkt.flags);
 
-		if (select_input < 0) {
-			select_input = i;
+		if (toread == 0 || toread > sizeof(buf) ||
+					!merge_read(input, buf, toread)) {
+			heap[0] = heap[--num_heap];
+			merge_sift_down(heap, num_heap, 0);
 			continue;
 		}
 
-		ts = be64toh(input_pkt[i].ts);
+		switch (buf[0]) {
+		case 0x01:
+			opcode = BTSNOOP_OPCODE_COMMAND_PKT;
+			break;
+		case 0x02:
+			if (flags & 0x01)
+				opcode = BTSNOOP_OPCODE_ACL_RX_PKT;
+			else
+				opcode = BTSNOOP_OPCODE_ACL_TX_PKT;
+			break;
+		case 0x03:
+			if (flags & 0x01)
+				opcode = BTSNOOP_OPCODE_SCO_RX_PKT;
+			else
+				opcode = BTSNOOP_OPCODE_SCO_TX_PKT;
+			break;
+		case 0x04:
+			opcode = BTSNOOP_OPCODE_EVENT_PKT;
+			break;
+		default:
+			goto next_packet;
+		}
+
+		input->pkt.size = htobe32(toread - 1);
+		input->pkt.len = htobe32(toread - 1);
+		input->pkt.flags = htobe32((input->index << 16) | opcode);
+
+		if (!merge_write(output, &input->pkt, BTSNOOP_PKT_SIZE)) {
+			fprintf(stderr, "write of packet header failed\n");
+			goto close_output;
+		}
+
+		if (!merge_write(output, buf + 1, toread - 1)) {
+			fprintf(stderr, "write of packet data failed\n");
+			goto close_output;
+		}
 
-		if (ts < be64toh(input_pkt[select_input].ts))
-			select_input = i;
+next_packet:
+		if (!merge_read(input, &input->pkt, BTSNOOP_PKT_SIZE))
+			heap[0] = heap[--num_heap];
+
+		merge_sift_down(heap, num_heap, 0);
 	}
 
-	if (select_input < 0)
-		goto close_output;
+	if (!merge_flush(output))
+		fprintf(stderr, "write of packet data failed\n");
 
-	toread = be32toh(input_pkt[select_input].size);
-	flags = be32toh(input_pkt[select_input].flags);
+close_output:
+	close(output->fd);
+
+close_input:
+	for (i = 0; i < num_input; i++)
+		close(inputs[i].fd);
 
-	len = read(input_fd[select_input], buf, toread);
-	if (toread == 0 || len < 0 || len != (ssize_t) toread) {
-		close(input_fd[select_input]);
-		input_fd[select_input] = -1;
-		goto next_packet;
+done:
+	free(output);
+	free(heap);
+	free(inputs);
+}
+
+#define BENCHMARK_PACKETS	10000
+
+static bool create_benchmark_input(const char *path, unsigned int seed)
+{
+	struct btsnoop_hdr hdr;
+	struct btsnoop_pkt pkt;
+	uint8_t data[16];
+	uint64_t ts = 0x00dcddb30f2f8000ULL;
+	bool result = false;
+	unsigned int i;
+	FILE *fp;
+
+	fp = fopen(path, "we");
+	if (!fp) {
+		perror("failed to create benchmark input");
+		return false;
 	}
 
-	written = htobe32(toread - 1);
-	input_pkt[select_input].size = written;
-	input_pkt[select_input].len = written;
+	memcpy(hdr.id, btsnoop_id, sizeof(btsnoop_id));
+	hdr.version = htobe32(btsnoop_version);
+	hdr.type = htobe32(1002);
 
-	switch (buf[0]) {
-	case 0x01:
-		opcode = BTSNOOP_OPCODE_COMMAND_PKT;
-		break;
-	case 0x02:
-		if (flags & 0x01)
-			opcode = BTSNOOP_OPCODE_ACL_RX_PKT;
-		else
-			opcode = BTSNOOP_OPCODE_ACL_TX_PKT;
-		break;
-	case 0x03:
-		if (flags & 0x01)
-			opcode = BTSNOOP_OPCODE_SCO_RX_PKT;
-		else
-			opcode = BTSNOOP_OPCODE_SCO_TX_PKT;
-		break;
-	case 0x04:
-		opcode = BTSNOOP_OPCODE_EVENT_PKT;
-		break;
-	default:
-		goto skip_write;
+	if (fwrite(&hdr, BTSNOOP_HDR_SIZE, 1, fp) != 1)
+		goto done;
+
+	memset(data, 0, sizeof(data));
+	data[0] = 0x04;
+
+	/* Interleave the inputs with pseudo random gaps between packets */
+	for (i = 0; i < BENCHMARK_PACKETS; i++) {
+		seed = seed * 1103515245 + 12345;
+		ts += 1 + (seed >> 16) % 1000;
+
+		pkt.size = htobe32(sizeof(data));
+		pkt.len = htobe32(sizeof(data));
+		pkt.flags = htobe32(0x01);
+		pkt.drops = 0;
+		pkt.ts = htobe64(ts);
+
+		if (fwrite(&pkt, BTSNOOP_PKT_SIZE, 1, fp) != 1 ||
+				fwrite(data, sizeof(data), 1, fp) != 1)
+			goto done;
 	}
 
-	index = select_input;
-	input_pkt[select_input].flags = htobe32((index << 16) | opcode);
+	result = true;
 
-	written = write(output_fd, &input_pkt[select_input], BTSNOOP_PKT_SIZE);
-	if (written != BTSNOOP_PKT_SIZE) {
-		fprintf(stderr, "write of packet header failed\n");
-		goto close_output;
+done:
+	if (fclose(fp) || !result) {
+		fprintf(stderr, "failed to write benchmark input\n");
+		return false;
 	}
 
-	written = write(output_fd, buf + 1, toread - 1);
-	if (written != (ssize_t) toread - 1) {
-		fprintf(stderr, "write of packet data failed\n");
-		goto close_output;
+	return true;
+}
+
+static void command_benchmark(int count)
+{
+	char dir[] = "/tmp/btsnoop-XXXXXX";
+	struct timespec start, end;
+	char **paths;
+	char output[sizeof(dir) + 16];
+	int i, num = 0;
+
+	if (count < 1) {
+		fprintf(stderr, "invalid number of files\n");
+		return;
 	}
 
-skip_write:
-	len = read(input_fd[select_input],
-				&input_pkt[select_input], BTSNOOP_PKT_SIZE);
-	if (len < 0 || len != BTSNOOP_PKT_SIZE) {
-		close(input_fd[select_input]);
-		input_fd[select_input] = -1;
+	if (!mkdtemp(dir)) {
+		perror("failed to create benchmark directory");
+		return;
 	}
 
-	goto next_packet;
+	paths = calloc(count, sizeof(*paths));
+	if (!paths)
+		goto remove_dir;
 
-close_output:
-	close(output_fd);
+	for (i = 0; i < count; i++) {
+		if (asprintf(&paths[i], "%s/%d.btsnoop", dir, i) < 0)
+			goto remove_files;
 
-close_input:
-	for (i = 0; i < num_input; i++)
-		close(input_fd[i]);
+		num++;
+
+		if (!create_benchmark_input(paths[i], i + 1))
+			goto remove_files;
+	}
+
+	snprintf(output, sizeof(output), "%s/merged", dir);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	command_merge(output, count, paths);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	printf("Merged %d files with %d packets each in %lld ms\n", count,
+			BENCHMARK_PACKETS,
+			(long long) (end.tv_sec - start.tv_sec) * 1000 +
+			(end.tv_nsec - start.tv_nsec) / 1000000);
+
+	unlink(output);
+
+remove_files:
+	for (i = 0; i < num; i++) {
+		unlink(paths[i]);
+		free(paths[i]);
+	}
+
+	free(paths);
+
+remove_dir:
+	rmdir(dir);
 }
 
 static void command_extract_eir(const char *input)
@@ -505,19 +720,21 @@ static void usage(void)
 	printf("commands:\n"
 		"\t-m, --merge <output>   Merge multiple btsnoop files\n"
 		"\t-e, --extract <input>  Extract data from btsnoop file\n"
+		"\t-b, --benchmark <num>  Benchmark merging synthetic files\n"
 		"\t-h, --help             Show help options\n");
 }
 
 static const struct option main_options[] = {
 	{ "merge",   required_argument, NULL, 'm' },
 	{ "extract", required_argument, NULL, 'e' },
+	{ "benchmark", required_argument, NULL, 'b' },
 	{ "type",    required_argument, NULL, 't' },
 	{ "version", no_argument,       NULL, 'v' },
 	{ "help",    no_argument,       NULL, 'h' },
 	{ }
 };
 
-enum { INVALID, MERGE, EXTRACT };
+enum { INVALID, MERGE, EXTRACT, BENCHMARK };
 
 int main(int argc, char *argv[])
 {
@@ -525,11 +742,12 @@ int main(int argc, char *argv[])
 	const char *input_path = NULL;
 	const char *type = NULL;
 	unsigned short command = INVALID;
+	int count = 0;
 
 	for (;;) {
 		int opt;
 
-		opt = getopt_long(argc, argv, "m:e:t:vh", main_options, NULL);
+		opt = getopt_long(argc, argv, "m:e:b:t:vh", main_options, NULL);
 		if (opt < 0)
 			break;
 
@@ -542,6 +760,10 @@ int main(int argc, char *argv[])
 			command = EXTRACT;
 			input_path = optarg;
 			break;
+		case 'b':
+			command = BENCHMARK;
+			count = atoi(optarg);
+			break;
 		case 't':
 			type = optarg;
 			break;
@@ -587,6 +809,10 @@ int main(int argc, char *argv[])
 			fprintf(stderr, "extract type not supported\n");
 		break;
 
+	case BENCHMARK:
+		command_benchmark(count);
+		break;
+
 	default:
 		usage();
 		return EXIT_FAILURE;
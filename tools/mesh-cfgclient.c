@@ -2661,6 +2661,10 @@ int main(int argc, char *argv[])
 
 	status = bt_shell_run();
 
+	/* Write out any configuration change that is still pending */
+	if (!mesh_db_flush())
+		l_error("Failed to save mesh configuration");
+
 	l_dbus_client_destroy(client);
 	l_dbus_destroy(dbus);
 
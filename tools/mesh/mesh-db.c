@@ -38,10 +38,19 @@
 #define KEY_IDX_INVALID NET_IDX_INVALID
 #define DEFAULT_LOCATION 0x0000
 
+/* Seconds to wait for further changes before writing the configuration */
+#define SAVE_DELAY 1
+
 struct mesh_db {
 	json_object *jcfg;
 	char *cfg_fname;
 	uint8_t token[8];
+	struct l_hashmap *node_by_unicast;
+	struct l_hashmap *node_by_uuid;
+	struct l_hashmap *net_keys;
+	struct l_hashmap *app_keys;
+	struct l_timeout *save_timeout;
+	bool save_failed;
 };
 
 static struct mesh_db *cfg;
@@ -102,6 +111,8 @@ static bool save_config_file(const char *fname)
 
 	if (fwrite(str, sizeof(char), strlen(str), outfile) < strlen(str))
 		l_warn("Incomplete write of mesh configuration");
+	else if (fflush(outfile) || fsync(fileno(outfile)) < 0)
+		l_warn("Failed to sync mesh configuration");
 	else
 		result = true;
 
@@ -110,7 +121,7 @@ static bool save_config_file(const char *fname)
 	return result;
 }
 
-static bool save_config(void)
+static bool write_config(void)
 {
 	char *fname_tmp, *fname_bak, *fname_cfg;
 	bool result = false;
@@ -136,19 +147,183 @@ static bool save_config(void)
 	return result;
 }
 
+static void save_timeout(struct l_timeout *timeout, void *user_data)
+{
+	l_timeout_remove(cfg->save_timeout);
+	cfg->save_timeout = NULL;
+
+	if (write_config())
+		return;
+
+	l_error("Deferred write of %s failed", cfg->cfg_fname);
+	cfg->save_failed = true;
+}
+
+static bool save_config(void)
+{
+	/*
+	 * The change that scheduled a failed deferred write has already been
+	 * reported as saved, retry now so at least this change sees the
+	 * error.
+	 */
+	if (cfg->save_failed) {
+		l_timeout_remove(cfg->save_timeout);
+		cfg->save_timeout = NULL;
+		cfg->save_failed = !write_config();
+		return !cfg->save_failed;
+	}
+
+	if (cfg->save_timeout)
+		return true;
+
+	/* Coalesce bursts of changes into a single write */
+	cfg->save_timeout = l_timeout_create(SAVE_DELAY, save_timeout, NULL,
+									NULL);
+	if (!cfg->save_timeout)
+		return write_config();
+
+	return true;
+}
+
 static void release_config(void)
 {
+	l_timeout_remove(cfg->save_timeout);
+	l_hashmap_destroy(cfg->node_by_unicast, NULL);
+	l_hashmap_destroy(cfg->node_by_uuid, NULL);
+	l_hashmap_destroy(cfg->net_keys, NULL);
+	l_hashmap_destroy(cfg->app_keys, NULL);
 	l_free(cfg->cfg_fname);
 	json_object_put(cfg->jcfg);
 	l_free(cfg);
 	cfg = NULL;
 }
 
+static bool parse_node_unicast(json_object *jnode, uint16_t *unicast)
+{
+	json_object *jval;
+	const char *str;
+
+	if (!json_object_object_get_ex(jnode, "unicastAddress", &jval))
+		return false;
+
+	str = json_object_get_string(jval);
+
+	return sscanf(str, "%04hx", unicast) == 1;
+}
+
+static const char *parse_node_uuid(json_object *jnode)
+{
+	json_object *jval;
+	const char *str;
+
+	if (!json_object_object_get_ex(jnode, "UUID", &jval))
+		return NULL;
+
+	str = json_object_get_string(jval);
+	if (strlen(str) != 36)
+		return NULL;
+
+	return str;
+}
+
+static void index_node(json_object *jnode)
+{
+	uint16_t unicast;
+	const char *uuid;
+
+	/* Keep the first entry on duplicates, as a linear lookup would */
+	if (parse_node_unicast(jnode, &unicast) &&
+			!l_hashmap_lookup(cfg->node_by_unicast,
+						L_UINT_TO_PTR(unicast)))
+		l_hashmap_insert(cfg->node_by_unicast, L_UINT_TO_PTR(unicast),
+									jnode);
+
+	uuid = parse_node_uuid(jnode);
+	if (uuid && !l_hashmap_lookup(cfg->node_by_uuid, uuid))
+		l_hashmap_insert(cfg->node_by_uuid, uuid, jnode);
+}
+
+static void unindex_node(json_object *jnode)
+{
+	uint16_t unicast;
+	const char *uuid;
+
+	if (parse_node_unicast(jnode, &unicast) &&
+			l_hashmap_lookup(cfg->node_by_unicast,
+					L_UINT_TO_PTR(unicast)) == jnode)
+		l_hashmap_remove(cfg->node_by_unicast, L_UINT_TO_PTR(unicast));
+
+	uuid = parse_node_uuid(jnode);
+	if (uuid && l_hashmap_lookup(cfg->node_by_uuid, uuid) == jnode)
+		l_hashmap_remove(cfg->node_by_uuid, uuid);
+}
+
+static void index_key(struct l_hashmap *map, json_object *jkey)
+{
+	json_object *jval;
+	int idx;
+
+	if (!json_object_object_get_ex(jkey, "index", &jval))
+		return;
+
+	idx = json_object_get_int(jval);
+	if (idx < 0 || idx > 0xfff)
+		return;
+
+	if (!l_hashmap_lookup(map, L_UINT_TO_PTR(idx)))
+		l_hashmap_insert(map, L_UINT_TO_PTR(idx), jkey);
+}
+
+static void index_array(json_object *jcfg, const char *desc,
+						struct l_hashmap *map)
+{
+	json_object *jarray;
+	int i, sz;
+
+	if (!json_object_object_get_ex(jcfg, desc, &jarray))
+		return;
+
+	if (!jarray || json_object_get_type(jarray) != json_type_array)
+		return;
+
+	sz = json_object_array_length(jarray);
+
+	for (i = 0; i < sz; ++i) {
+		json_object *jentry = json_object_array_get_idx(jarray, i);
+
+		if (map)
+			index_key(map, jentry);
+		else
+			index_node(jentry);
+	}
+}
+
+/*
+ * The configuration is only ever changed through this file, so nodes and
+ * keys are indexed once and kept up to date instead of walking the JSON
+ * arrays on every lookup.
+ */
+static void build_index(void)
+{
+	cfg->node_by_unicast = l_hashmap_new();
+	cfg->node_by_uuid = l_hashmap_string_new();
+	cfg->net_keys = l_hashmap_new();
+	cfg->app_keys = l_hashmap_new();
+
+	index_array(cfg->jcfg, "nodes", NULL);
+	index_array(cfg->jcfg, "netKeys", cfg->net_keys);
+	index_array(cfg->jcfg, "appKeys", cfg->app_keys);
+}
+
 static json_object *get_node_by_unicast(json_object *jcfg, uint16_t unicast)
 {
 	json_object *jarray;
 	int i, sz;
 
+	if (cfg && jcfg == cfg->jcfg)
+		return l_hashmap_lookup(cfg->node_by_unicast,
+							L_UINT_TO_PTR(unicast));
+
 	if (!json_object_object_get_ex(jcfg, "nodes", &jarray))
 		return NULL;
 
@@ -306,6 +481,9 @@ static json_object *get_node_by_uuid(json_object *jcfg, uint8_t uuid[16])
 	if (!l_uuid_to_string(uuid, buf, sizeof(buf)))
 		return NULL;
 
+	if (cfg && jcfg == cfg->jcfg)
+		return l_hashmap_lookup(cfg->node_by_uuid, buf);
+
 	json_object_object_get_ex(jcfg, "nodes", &jarray);
 	if (!jarray || json_object_get_type(jarray) != json_type_array)
 		return NULL;
@@ -611,6 +789,9 @@ static bool add_app_key(json_object *jobj, uint16_t net_idx, uint16_t app_idx)
 	if (!jarray || json_object_get_type(jarray) != json_type_array)
 		return false;
 
+	if (l_hashmap_lookup(cfg->app_keys, L_UINT_TO_PTR(app_idx)))
+		return true;
+
 	jkey = json_object_new_object();
 
 	snprintf(buf, 12, "AppKey %4.4x", app_idx);
@@ -625,6 +806,7 @@ static bool add_app_key(json_object *jobj, uint16_t net_idx, uint16_t app_idx)
 		goto fail;
 
 	json_object_array_add(jarray, jkey);
+	index_key(cfg->app_keys, jkey);
 
 	return true;
 fail:
@@ -1312,6 +1494,36 @@ static void jarray_key_del(json_object *jarray, int16_t idx)
 	}
 }
 
+static void jarray_obj_del(json_object *jarray, json_object *jobj)
+{
+	int i, sz = json_object_array_length(jarray);
+
+	for (i = 0; i < sz; ++i) {
+		if (json_object_array_get_idx(jarray, i) == jobj) {
+			json_object_array_del_idx(jarray, i, 1);
+			return;
+		}
+	}
+}
+
+/* Deletes an indexed key without parsing the other entries */
+static bool delete_indexed_key(struct l_hashmap *map, const char *desc,
+								uint16_t idx)
+{
+	json_object *jarray, *jkey;
+
+	jkey = l_hashmap_remove(map, L_UINT_TO_PTR(idx));
+	if (!jkey)
+		return true;
+
+	if (!json_object_object_get_ex(cfg->jcfg, desc, &jarray))
+		return true;
+
+	jarray_obj_del(jarray, jkey);
+
+	return save_config();
+}
+
 static bool delete_key(json_object *jobj, const char *desc, uint16_t idx)
 {
 	json_object *jarray;
@@ -1490,7 +1702,7 @@ bool mesh_db_add_net_key(uint16_t net_idx)
 	if (!jarray || json_object_get_type(jarray) != json_type_array)
 		return false;
 
-	if (get_key_object(jarray, net_idx))
+	if (l_hashmap_lookup(cfg->net_keys, L_UINT_TO_PTR(net_idx)))
 		return true;
 
 	jkey = json_object_new_object();
@@ -1513,6 +1725,7 @@ bool mesh_db_add_net_key(uint16_t net_idx)
 		goto fail;
 
 	json_object_array_add(jarray, jkey);
+	index_key(cfg->net_keys, jkey);
 
 	return save_config();
 
@@ -1526,21 +1739,17 @@ bool mesh_db_del_net_key(uint16_t net_idx)
 	if (!cfg || !cfg->jcfg)
 		return false;
 
-	return delete_key(cfg->jcfg, "netKeys", net_idx);
+	return delete_indexed_key(cfg->net_keys, "netKeys", net_idx);
 }
 
 bool mesh_db_set_net_key_phase(uint16_t net_idx, uint8_t phase)
 {
-	json_object *jval, *jarray, *jkey;
+	json_object *jval, *jkey;
 
 	if (!cfg || !cfg->jcfg)
 		return false;
 
-	json_object_object_get_ex(cfg->jcfg, "netKeys", &jarray);
-	if (!jarray || json_object_get_type(jarray) != json_type_array)
-		return false;
-
-	jkey = get_key_object(jarray, net_idx);
+	jkey = l_hashmap_lookup(cfg->net_keys, L_UINT_TO_PTR(net_idx));
 	if (!jkey)
 		return false;
 
@@ -1569,7 +1778,7 @@ bool mesh_db_del_app_key(uint16_t app_idx)
 	if (!cfg || !cfg->jcfg)
 		return false;
 
-	return delete_key(cfg->jcfg, "appKeys", app_idx);
+	return delete_indexed_key(cfg->app_keys, "appKeys", app_idx);
 }
 
 bool mesh_db_add_group(struct mesh_group *grp)
@@ -1715,8 +1924,14 @@ bool mesh_db_reset_node(uint16_t original, uint16_t unicast, uint8_t num_els)
 		return false;
 	}
 
-	if (!write_uint16_hex(jnode, "unicastAddress", unicast))
+	unindex_node(jnode);
+
+	if (!write_uint16_hex(jnode, "unicastAddress", unicast)) {
+		index_node(jnode);
 		return false;
+	}
+
+	index_node(jnode);
 
 	json_object_object_del(jnode, "elements");
 	jelements = init_elements(num_els);
@@ -1786,6 +2001,7 @@ bool mesh_db_add_node(uint8_t uuid[16], uint8_t num_els, uint16_t unicast,
 		goto fail;
 
 	json_object_array_add(jnodes, jnode);
+	index_node(jnode);
 
 	return save_config();
 
@@ -1796,7 +2012,7 @@ fail:
 
 bool mesh_db_del_node(uint16_t unicast)
 {
-	json_object *jarray;
+	json_object *jarray, *jnode;
 	int i, sz;
 
 	if (!json_object_object_get_ex(cfg->jcfg, "nodes", &jarray))
@@ -1805,29 +2021,21 @@ bool mesh_db_del_node(uint16_t unicast)
 	if (!jarray || json_object_get_type(jarray) != json_type_array)
 		return false;
 
+	jnode = get_node_by_unicast(cfg->jcfg, unicast);
+	if (!jnode)
+		return true;
+
 	sz = json_object_array_length(jarray);
 
 	for (i = 0; i < sz; ++i) {
-		json_object *jentry, *jval;
-		uint16_t addr;
-		const char *str;
-
-		jentry = json_object_array_get_idx(jarray, i);
-		if (!json_object_object_get_ex(jentry, "unicastAddress",
-								&jval))
-			continue;
-
-		str = json_object_get_string(jval);
-		if (sscanf(str, "%04hx", &addr) != 1)
-			continue;
-
-		if (addr == unicast)
+		if (json_object_array_get_idx(jarray, i) == jnode)
 			break;
 	}
 
 	if (i == sz)
 		return true;
 
+	unindex_node(jnode);
 	json_object_array_del_idx(jarray, i, 1);
 
 	return save_config();
@@ -2329,6 +2537,7 @@ bool mesh_db_create(const char *fname, const uint8_t token[8],
 	cfg->jcfg = jcfg;
 	cfg->cfg_fname = l_strdup(fname);
 	memcpy(cfg->token, token, 8);
+	build_index();
 
 	if (!add_u8_8(jcfg, "token", token))
 		goto fail;
@@ -2376,7 +2585,7 @@ bool mesh_db_create(const char *fname, const uint8_t token[8],
 
 	write_int(jcfg, "ivIndex", 0);
 
-	if (!save_config())
+	if (!write_config())
 		goto fail;
 
 	return true;
@@ -2430,6 +2639,7 @@ bool mesh_db_load(const char *fname)
 
 	cfg->jcfg = jcfg;
 	cfg->cfg_fname = l_strdup(fname);
+	build_index();
 
 	if (!get_token(jcfg, cfg->token)) {
 		l_error("Configuration file missing token");
@@ -2450,6 +2660,19 @@ fail:
 	return false;
 }
 
+bool mesh_db_flush(void)
+{
+	if (!cfg || (!cfg->save_timeout && !cfg->save_failed))
+		return true;
+
+	l_timeout_remove(cfg->save_timeout);
+	cfg->save_timeout = NULL;
+
+	cfg->save_failed = !write_config();
+
+	return !cfg->save_failed;
+}
+
 bool mesh_db_set_device_key(void *expt_cfg, uint16_t unicast, uint8_t key[16])
 {
 	json_object *jnode;
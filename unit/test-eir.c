@@ -12,6 +12,7 @@
 #include <config.h>
 #endif
 
+#include <stdlib.h>
 #include <stdbool.h>
 
 #include <glib.h>
@@ -21,6 +22,7 @@
 #include "lib/sdp.h"
 #include "src/shared/tester.h"
 #include "src/shared/util.h"
+#include "src/shared/queue.h"
 #include "src/shared/ad.h"
 #include "src/eir.h"
 
@@ -588,6 +590,55 @@ static void test_ad(const struct test_data *test, struct eir_data *eir)
 	bt_ad_unref(ad);
 }
 
+static void test_ad_view(const struct test_data *test, struct eir_data *eir)
+{
+	struct bt_ad_view view;
+	GSList *list;
+
+	g_assert(bt_ad_view_init(&view, test->eir_data, test->eir_size));
+
+	g_assert_cmpint(bt_ad_view_get_flags(&view), ==, test->flags);
+	g_assert(bt_ad_view_has_flags(&view) == !!test->flags);
+
+	if (test->uuid) {
+		int i;
+
+		for (i = 0; test->uuid[i]; i++) {
+			bt_uuid_t uuid;
+
+			bt_string_to_uuid(&uuid, test->uuid[i]);
+			g_assert(bt_ad_view_has_service_uuid(&view, &uuid));
+		}
+	}
+
+	for (list = eir->msd_list; list; list = list->next) {
+		struct eir_msd *msd = list->data;
+		struct bt_ad_manufacturer_data adm;
+
+		adm.manufacturer_id = msd->company;
+		adm.data = msd->data;
+		adm.len = msd->data_len;
+
+		g_assert(bt_ad_view_has_manufacturer_data(&view, &adm));
+	}
+
+	g_assert(bt_ad_view_has_manufacturer_data(&view, NULL) ==
+							!!eir->msd_list);
+
+	for (list = eir->sd_list; list; list = list->next) {
+		struct eir_sd *sd = list->data;
+		struct bt_ad_service_data ads;
+
+		bt_string_to_uuid(&ads.uuid, sd->uuid);
+		ads.data = sd->data;
+		ads.len = sd->data_len;
+
+		g_assert(bt_ad_view_has_service_data(&view, &ads));
+	}
+
+	g_assert(bt_ad_view_has_service_data(&view, NULL) == !!eir->sd_list);
+}
+
 static void test_parsing(gconstpointer data)
 {
 	const struct test_data *test = data;
@@ -649,6 +700,7 @@ static void test_parsing(gconstpointer data)
 	}
 
 	test_ad(data, &eir);
+	test_ad_view(data, &eir);
 
 	eir_data_free(&eir);
 
@@ -692,6 +744,175 @@ static const struct test_data uri_beacon_test = {
 	.uuid = uri_beacon_uuid,
 };
 
+static const struct test_data *ad_tests[] = {
+	&macbookair_test,
+	&iphone5_test,
+	&ipadmini_test,
+	&gigaset_sl400h_test,
+	&gigaset_sl910_test,
+	&nokia_bh907_test,
+	&fuelband_test,
+	&bluesc_test,
+	&wahoo_scale_test,
+	&mio_alpha_test,
+	&cookoo_test,
+	&citizen_adv_test,
+	&citizen_scan_test,
+	&gigaset_gtag_test,
+	&uri_beacon_test,
+};
+
+static void add_element_patterns(struct queue *patterns,
+					const struct test_data *test)
+{
+	const uint8_t *data = test->eir_data;
+	size_t i = 0;
+
+	while (i + 1 < test->eir_size) {
+		uint8_t len = data[i];
+		uint8_t type = data[i + 1];
+		uint8_t offset = 0;
+
+		if (!len || i + len >= test->eir_size)
+			break;
+
+		/* Skip the UUID of service data as the pattern matching does */
+		if (type == BT_AD_SERVICE_DATA16)
+			offset = 2;
+		else if (type == BT_AD_SERVICE_DATA32)
+			offset = 4;
+		else if (type == BT_AD_SERVICE_DATA128)
+			offset = 16;
+
+		if (len - 1 > offset)
+			queue_push_tail(patterns, bt_ad_pattern_new(type, 0,
+					len - 1 - offset, &data[i + 2 + offset]));
+
+		i += len + 1;
+	}
+}
+
+static void test_pattern(const void *data)
+{
+	struct queue *patterns = queue_new();
+	struct bt_ad_pattern *pattern;
+	static const uint8_t none[] = { 0xde, 0xad, 0xbe, 0xef };
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(ad_tests); i++)
+		add_element_patterns(patterns, ad_tests[i]);
+
+	pattern = bt_ad_pattern_new(BT_AD_MANUFACTURER_DATA, 2, sizeof(none),
+									none);
+	queue_push_tail(patterns, pattern);
+
+	for (i = 0; i < ARRAY_SIZE(ad_tests); i++) {
+		const struct test_data *test = ad_tests[i];
+		const struct queue_entry *entry;
+		struct bt_ad_view view;
+		struct bt_ad *ad;
+
+		ad = bt_ad_new_with_data(test->eir_size, test->eir_data);
+		g_assert(ad);
+		g_assert(bt_ad_view_init(&view, test->eir_data,
+							test->eir_size));
+
+		for (entry = queue_get_entries(patterns); entry;
+							entry = entry->next) {
+			struct queue *single = queue_new();
+
+			queue_push_tail(single, entry->data);
+
+			g_assert(!bt_ad_pattern_match(ad, single) ==
+					!bt_ad_view_pattern_match(&view,
+								single));
+
+			queue_destroy(single, NULL);
+		}
+
+		g_assert(bt_ad_view_pattern_match(&view, patterns));
+
+		bt_ad_unref(ad);
+	}
+
+	queue_remove(patterns, pattern);
+	free(pattern);
+	queue_destroy(patterns, free);
+
+	tester_test_passed();
+}
+
+#define BENCHMARK_ROUNDS 10000
+
+/* Timing runs only make sense when asked for, e.g. with -p ad/pattern */
+static void benchmark_pre_setup(const void *data)
+{
+	if (tester_pre_setup_skip_by_default())
+		return;
+
+	tester_pre_setup_complete();
+}
+
+static void test_pattern_benchmark(const void *data)
+{
+	struct queue *patterns = queue_new();
+	static const uint8_t none[] = { 0xde, 0xad, 0xbe, 0xef };
+	unsigned int i, j, ad_matches = 0, view_matches = 0;
+	gint64 start, ad_time, view_time;
+
+	/* Patterns that never match force a scan of every element */
+	queue_push_tail(patterns, bt_ad_pattern_new(BT_AD_MANUFACTURER_DATA, 2,
+							sizeof(none), none));
+	queue_push_tail(patterns, bt_ad_pattern_new(BT_AD_SERVICE_DATA16, 0,
+							sizeof(none), none));
+
+	start = g_get_monotonic_time();
+
+	for (i = 0; i < BENCHMARK_ROUNDS; i++) {
+		for (j = 0; j < ARRAY_SIZE(ad_tests); j++) {
+			const struct test_data *test = ad_tests[j];
+			struct bt_ad *ad;
+
+			ad = bt_ad_new_with_data(test->eir_size,
+							test->eir_data);
+			if (bt_ad_pattern_match(ad, patterns))
+				ad_matches++;
+
+			bt_ad_unref(ad);
+		}
+	}
+
+	ad_time = g_get_monotonic_time() - start;
+	start = g_get_monotonic_time();
+
+	for (i = 0; i < BENCHMARK_ROUNDS; i++) {
+		for (j = 0; j < ARRAY_SIZE(ad_tests); j++) {
+			const struct test_data *test = ad_tests[j];
+			struct bt_ad_view view;
+
+			if (!bt_ad_view_init(&view, test->eir_data,
+							test->eir_size))
+				continue;
+
+			if (bt_ad_view_pattern_match(&view, patterns))
+				view_matches++;
+		}
+	}
+
+	view_time = g_get_monotonic_time() - start;
+
+	g_assert_cmpuint(ad_matches, ==, view_matches);
+
+	tester_debug("%u reports: bt_ad %" G_GINT64_FORMAT " us, "
+			"bt_ad_view %" G_GINT64_FORMAT " us",
+			BENCHMARK_ROUNDS * (unsigned int) ARRAY_SIZE(ad_tests),
+			ad_time, view_time);
+
+	queue_destroy(patterns, free);
+
+	tester_test_passed();
+}
+
 int main(int argc, char *argv[])
 {
 	tester_init(&argc, &argv);
@@ -718,5 +939,10 @@ int main(int argc, char *argv[])
 	tester_add("ad/g-tag", &gigaset_gtag_test, NULL, test_parsing, NULL);
 	tester_add("ad/uri-beacon", &uri_beacon_test, NULL, test_parsing, NULL);
 
+	tester_add("ad/pattern", NULL, NULL, test_pattern, NULL);
+	tester_add_full("ad/pattern/benchmark", NULL, benchmark_pre_setup,
+				NULL, test_pattern_benchmark, NULL, NULL, 0,
+				NULL, NULL);
+
 	return tester_run();
 }
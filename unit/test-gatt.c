@@ -2412,6 +2412,623 @@ static void test_hash_db(gconstpointer data)
 	context_quit(context);
 }
 
+#define LARGE_DB_SERVICES 256
+#define LARGE_DB_CHRCS 8
+
+/*
+ * Synthetic database large enough to require many discovery round trips,
+ * alternating 16 bit and 128 bit UUIDs across services and characteristics.
+ */
+static struct gatt_db *make_large_db(void)
+{
+	struct gatt_db *db = gatt_db_new();
+	unsigned int i, j;
+
+	for (i = 0; i < LARGE_DB_SERVICES; i++) {
+		struct gatt_db_attribute *svc;
+		bt_uuid_t uuid;
+
+		if (i % 2)
+			bt_string_to_uuid(&uuid,
+					"12345678-0000-1000-8000-00805f9b34fb");
+		else
+			bt_uuid16_create(&uuid, 0x1800 + i);
+
+		svc = gatt_db_add_service(db, &uuid, true,
+						1 + LARGE_DB_CHRCS * 2);
+		g_assert(svc);
+
+		for (j = 0; j < LARGE_DB_CHRCS; j++) {
+			if (j % 2)
+				bt_string_to_uuid(&uuid,
+					"87654321-0000-1000-8000-00805f9b34fb");
+			else
+				bt_uuid16_create(&uuid, 0x2a00 + j);
+
+			g_assert(gatt_db_service_add_characteristic(svc, &uuid,
+						BT_ATT_PERM_READ,
+						BT_GATT_CHRC_PROP_READ,
+						NULL, NULL, NULL));
+		}
+
+		gatt_db_service_set_active(svc, true);
+	}
+
+	return db;
+}
+
+struct large_db_context {
+	struct gatt_db *server_db;
+	struct gatt_db *client_db;
+	struct bt_att *server_att;
+	struct bt_att *client_att;
+	struct bt_gatt_server *server;
+	struct bt_gatt_client *client;
+	gint64 start;
+};
+
+static unsigned int large_db_count;
+
+static void count_service(struct gatt_db_attribute *attr, void *user_data)
+{
+	large_db_count++;
+}
+
+static gboolean large_db_quit(gpointer user_data)
+{
+	struct large_db_context *context = user_data;
+
+	bt_gatt_client_unref(context->client);
+	bt_gatt_server_unref(context->server);
+	bt_att_unref(context->client_att);
+	bt_att_unref(context->server_att);
+	gatt_db_unref(context->client_db);
+	gatt_db_unref(context->server_db);
+	g_free(context);
+
+	tester_test_passed();
+
+	return FALSE;
+}
+
+static void large_db_ready_cb(bool success, uint8_t att_ecode,
+							void *user_data)
+{
+	struct large_db_context *context = user_data;
+	gint64 elapsed = g_get_monotonic_time() - context->start;
+
+	g_assert(success);
+
+	large_db_count = 0;
+	gatt_db_foreach_service(context->client_db, NULL, count_service, NULL);
+	g_assert_cmpuint(large_db_count, ==, LARGE_DB_SERVICES);
+
+	gatt_db_foreach_service(context->client_db, NULL, match_services,
+							context->server_db);
+
+	tester_debug("Discovered %u services with %u characteristics in %"
+				G_GINT64_FORMAT " us", LARGE_DB_SERVICES,
+				LARGE_DB_SERVICES * LARGE_DB_CHRCS, elapsed);
+
+	g_idle_add(large_db_quit, context);
+}
+
+static void test_large_db_discovery(const void *data)
+{
+	struct large_db_context *context = g_new0(struct large_db_context, 1);
+	int err, sv[2];
+
+	err = socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv);
+	g_assert(err == 0);
+
+	context->server_db = make_large_db();
+	context->client_db = gatt_db_new();
+
+	context->server_att = bt_att_new(sv[0], false);
+	g_assert(context->server_att);
+	bt_att_set_close_on_unref(context->server_att, true);
+
+	context->client_att = bt_att_new(sv[1], false);
+	g_assert(context->client_att);
+	bt_att_set_close_on_unref(context->client_att, true);
+
+	context->server = bt_gatt_server_new(context->server_db,
+						context->server_att, 512, 0);
+	g_assert(context->server);
+
+	context->start = g_get_monotonic_time();
+
+	context->client = bt_gatt_client_new(context->client_db,
+						context->client_att, 512, 0);
+	g_assert(context->client);
+
+	bt_gatt_client_ready_register(context->client, large_db_ready_cb,
+								context, NULL);
+}
+
+#define READ_BATCH_CHRCS 32
+#define READ_BATCH_VALUE_LEN 20
+
+/*
+ * Database advertising EATT support, which implies Read Multiple Variable
+ * Length, with more values than fit in a single response.
+ */
+static struct gatt_db *make_read_batch_db(void)
+{
+	struct gatt_db *db = gatt_db_new();
+	struct gatt_db_attribute *svc;
+	uint8_t feat = BT_GATT_CHRC_SERVER_FEAT_EATT;
+	uint8_t value[READ_BATCH_VALUE_LEN];
+	bt_uuid_t uuid;
+	unsigned int i;
+
+	bt_uuid16_create(&uuid, 0x1801);
+	svc = gatt_db_add_service(db, &uuid, true, 5);
+	g_assert(svc);
+
+	bt_uuid16_create(&uuid, GATT_CHARAC_CLI_FEAT);
+	g_assert(gatt_db_service_add_characteristic(svc, &uuid,
+				BT_ATT_PERM_READ | BT_ATT_PERM_WRITE,
+				BT_GATT_CHRC_PROP_READ | BT_GATT_CHRC_PROP_WRITE,
+				NULL, NULL, NULL));
+
+	bt_uuid16_create(&uuid, GATT_CHARAC_SERVER_FEAT);
+	add_char_with_value(svc, 0, &uuid, BT_ATT_PERM_READ,
+					BT_GATT_CHRC_PROP_READ, &feat, 1);
+
+	gatt_db_service_set_active(svc, true);
+
+	bt_uuid16_create(&uuid, 0x1844);
+	svc = gatt_db_add_service(db, &uuid, true, 1 + READ_BATCH_CHRCS * 2);
+	g_assert(svc);
+
+	for (i = 0; i < READ_BATCH_CHRCS; i++) {
+		memset(value, i, sizeof(value));
+		bt_uuid16_create(&uuid, 0x2b7d + i);
+		add_char_with_value(svc, 0, &uuid, BT_ATT_PERM_READ,
+					BT_GATT_CHRC_PROP_READ, value,
+					sizeof(value));
+	}
+
+	gatt_db_service_set_active(svc, true);
+
+	return db;
+}
+
+struct read_batch_context {
+	struct gatt_db *server_db;
+	struct gatt_db *client_db;
+	struct bt_att *server_att;
+	struct bt_att *client_att;
+	struct bt_gatt_server *server;
+	struct bt_gatt_client *client;
+	uint16_t handles[READ_BATCH_CHRCS];
+	unsigned int num_handles;
+	unsigned int requests;
+	unsigned int completed;
+	unsigned int destroyed;
+	bool batch;
+	gint64 start;
+};
+
+static void read_batch_count(struct bt_att_chan *chan, uint8_t opcode,
+					const void *pdu, uint16_t length,
+					void *user_data)
+{
+	struct read_batch_context *context = user_data;
+
+	context->requests++;
+}
+
+static void read_batch_chrc(struct gatt_db_attribute *attr, void *user_data)
+{
+	struct read_batch_context *context = user_data;
+	uint16_t value_handle;
+
+	g_assert(gatt_db_attribute_get_char_data(attr, NULL, &value_handle,
+							NULL, NULL, NULL));
+	context->handles[context->num_handles++] = value_handle;
+}
+
+static void read_batch_service(struct gatt_db_attribute *attr,
+							void *user_data)
+{
+	gatt_db_service_foreach_char(attr, read_batch_chrc, user_data);
+}
+
+static gboolean read_batch_quit(gpointer user_data)
+{
+	struct read_batch_context *context = user_data;
+
+	bt_gatt_client_unref(context->client);
+	bt_gatt_server_unref(context->server);
+	bt_att_unref(context->client_att);
+	bt_att_unref(context->server_att);
+	gatt_db_unref(context->client_db);
+	gatt_db_unref(context->server_db);
+	g_free(context);
+
+	tester_test_passed();
+
+	return FALSE;
+}
+
+static void read_batch_start(struct read_batch_context *context);
+
+static void read_batch_value_cb(bool success, uint8_t att_ecode,
+					const uint8_t *value, uint16_t length,
+					void *user_data)
+{
+	struct read_batch_context *context = user_data;
+	gint64 elapsed;
+
+	g_assert(success);
+	g_assert_cmpuint(length, ==, READ_BATCH_VALUE_LEN);
+
+	/* Results are reported in the order the reads were issued */
+	g_assert_cmpuint(value[0], ==, context->completed);
+
+	if (++context->completed < context->num_handles)
+		return;
+
+	elapsed = g_get_monotonic_time() - context->start;
+
+	tester_debug("%s: %u values in %u requests, %" G_GINT64_FORMAT " us",
+				context->batch ? "batched" : "unbatched",
+				context->completed, context->requests,
+				elapsed);
+
+	if (!context->batch) {
+		g_assert_cmpuint(context->requests, ==, READ_BATCH_CHRCS);
+		context->batch = true;
+		read_batch_start(context);
+		return;
+	}
+
+	g_assert_cmpuint(context->requests, <, READ_BATCH_CHRCS);
+
+	g_idle_add(read_batch_quit, context);
+}
+
+static void read_batch_start(struct read_batch_context *context)
+{
+	unsigned int i;
+
+	context->requests = 0;
+	context->completed = 0;
+	context->start = g_get_monotonic_time();
+
+	if (context->batch)
+		bt_gatt_client_read_batch_begin(context->client);
+
+	for (i = 0; i < context->num_handles; i++)
+		g_assert(bt_gatt_client_read_value(context->client,
+						context->handles[i],
+						read_batch_value_cb, context,
+						NULL));
+
+	if (context->batch)
+		bt_gatt_client_read_batch_end(context->client);
+}
+
+static void read_batch_ready_cb(bool success, uint8_t att_ecode,
+							void *user_data)
+{
+	struct read_batch_context *context = user_data;
+	bt_uuid_t uuid;
+
+	g_assert(success);
+
+	bt_uuid16_create(&uuid, 0x1844);
+	gatt_db_foreach_service(context->client_db, &uuid, read_batch_service,
+								context);
+	g_assert_cmpuint(context->num_handles, ==, READ_BATCH_CHRCS);
+
+	read_batch_start(context);
+}
+
+static void test_read_batch(const void *data)
+{
+	struct read_batch_context *context;
+	int err, sv[2];
+
+	context = g_new0(struct read_batch_context, 1);
+
+	err = socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv);
+	g_assert(err == 0);
+
+	context->server_db = make_read_batch_db();
+	context->client_db = gatt_db_new();
+
+	context->server_att = bt_att_new(sv[0], false);
+	g_assert(context->server_att);
+	bt_att_set_close_on_unref(context->server_att, true);
+
+	context->client_att = bt_att_new(sv[1], false);
+	g_assert(context->client_att);
+	bt_att_set_close_on_unref(context->client_att, true);
+
+	context->server = bt_gatt_server_new(context->server_db,
+						context->server_att, 512, 0);
+	g_assert(context->server);
+
+	bt_att_register(context->server_att, BT_ATT_OP_READ_REQ,
+					read_batch_count, context, NULL);
+	bt_att_register(context->server_att, BT_ATT_OP_READ_MULT_VL_REQ,
+					read_batch_count, context, NULL);
+
+	context->client = bt_gatt_client_new(context->client_db,
+						context->client_att, 512, 0);
+	g_assert(context->client);
+
+	bt_gatt_client_ready_register(context->client, read_batch_ready_cb,
+								context, NULL);
+}
+
+/* Reads canceled while queued in a batch and while the batch is in flight */
+#define READ_BATCH_CANCEL_QUEUED 1
+#define READ_BATCH_CANCEL_SENT 3
+
+static void read_batch_cancel_destroy(void *user_data)
+{
+	struct read_batch_context *context = user_data;
+
+	context->destroyed++;
+}
+
+static void read_batch_cancel_value_cb(bool success, uint8_t att_ecode,
+					const uint8_t *value, uint16_t length,
+					void *user_data)
+{
+	struct read_batch_context *context = user_data;
+
+	g_assert(success);
+	g_assert_cmpuint(length, ==, READ_BATCH_VALUE_LEN);
+
+	/* Other values are not shifted into the slots of canceled reads */
+	g_assert_cmpuint(value[0], !=, READ_BATCH_CANCEL_QUEUED);
+	g_assert_cmpuint(value[0], !=, READ_BATCH_CANCEL_SENT);
+
+	if (++context->completed < context->num_handles - 2)
+		return;
+
+	g_idle_add(read_batch_quit, context);
+}
+
+static void read_batch_cancel_ready_cb(bool success, uint8_t att_ecode,
+							void *user_data)
+{
+	struct read_batch_context *context = user_data;
+	unsigned int ids[READ_BATCH_CHRCS];
+	unsigned int i;
+	bt_uuid_t uuid;
+
+	g_assert(success);
+
+	bt_uuid16_create(&uuid, 0x1844);
+	gatt_db_foreach_service(context->client_db, &uuid, read_batch_service,
+								context);
+	g_assert_cmpuint(context->num_handles, ==, READ_BATCH_CHRCS);
+
+	bt_gatt_client_read_batch_begin(context->client);
+
+	for (i = 0; i < context->num_handles; i++) {
+		ids[i] = bt_gatt_client_read_value(context->client,
+						context->handles[i],
+						read_batch_cancel_value_cb,
+						context,
+						read_batch_cancel_destroy);
+		g_assert(ids[i]);
+	}
+
+	/* The destroy callback runs before cancel returns */
+	g_assert(bt_gatt_client_cancel(context->client,
+					ids[READ_BATCH_CANCEL_QUEUED]));
+	g_assert_cmpuint(context->destroyed, ==, 1);
+
+	bt_gatt_client_read_batch_end(context->client);
+
+	g_assert(bt_gatt_client_cancel(context->client,
+					ids[READ_BATCH_CANCEL_SENT]));
+	g_assert_cmpuint(context->destroyed, ==, 2);
+}
+
+static void test_read_batch_cancel(const void *data)
+{
+	struct read_batch_context *context;
+	int err, sv[2];
+
+	context = g_new0(struct read_batch_context, 1);
+
+	err = socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv);
+	g_assert(err == 0);
+
+	context->server_db = make_read_batch_db();
+	context->client_db = gatt_db_new();
+
+	context->server_att = bt_att_new(sv[0], false);
+	g_assert(context->server_att);
+	bt_att_set_close_on_unref(context->server_att, true);
+
+	context->client_att = bt_att_new(sv[1], false);
+	g_assert(context->client_att);
+	bt_att_set_close_on_unref(context->client_att, true);
+
+	context->server = bt_gatt_server_new(context->server_db,
+						context->server_att, 512, 0);
+	g_assert(context->server);
+
+	context->client = bt_gatt_client_new(context->client_db,
+						context->client_att, 512, 0);
+	g_assert(context->client);
+
+	bt_gatt_client_ready_register(context->client,
+					read_batch_cancel_ready_cb, context,
+					NULL);
+}
+
+#define NOTIFY_BENCH_CHRCS 1024
+#define NOTIFY_BENCH_ELEMS 64
+#define NOTIFY_BENCH_VALUE_LEN 2
+#define NOTIFY_BENCH_PDUS 1000
+
+/* Number of registrations held by the client in each round */
+static const unsigned int notify_bench_regs[] = { 1, 32, NOTIFY_BENCH_CHRCS };
+
+struct notify_bench_context {
+	struct gatt_db *db;
+	struct bt_att *att;
+	struct bt_gatt_client *client;
+	int fd;
+	uint16_t handles[NOTIFY_BENCH_CHRCS];
+	unsigned int round;
+	unsigned int registered;
+	unsigned int received;
+	unsigned int pdus;
+	gint64 start;
+};
+
+static gboolean notify_bench_quit(gpointer user_data)
+{
+	struct notify_bench_context *context = user_data;
+
+	/* Drop the discovery request left unanswered by the peer */
+	bt_att_cancel_all(context->att);
+
+	bt_gatt_client_unref(context->client);
+	bt_att_unref(context->att);
+	gatt_db_unref(context->db);
+	close(context->fd);
+	g_free(context);
+
+	tester_test_passed();
+
+	return FALSE;
+}
+
+static void notify_bench_start(struct notify_bench_context *context);
+
+static void notify_bench_send(struct notify_bench_context *context)
+{
+	uint8_t pdu[1 + NOTIFY_BENCH_ELEMS * (4 + NOTIFY_BENCH_VALUE_LEN)];
+	uint8_t *ptr = pdu;
+	unsigned int i;
+	ssize_t len;
+
+	*ptr++ = BT_ATT_OP_HANDLE_NFY_MULT;
+
+	/* Spread the values over every characteristic registered so far */
+	for (i = 0; i < NOTIFY_BENCH_ELEMS; i++) {
+		put_le16(context->handles[i % context->registered], ptr);
+		put_le16(NOTIFY_BENCH_VALUE_LEN, ptr + 2);
+		memset(ptr + 4, i, NOTIFY_BENCH_VALUE_LEN);
+		ptr += 4 + NOTIFY_BENCH_VALUE_LEN;
+	}
+
+	len = write(context->fd, pdu, sizeof(pdu));
+	g_assert_cmpint(len, ==, sizeof(pdu));
+}
+
+static void notify_bench_cb(uint16_t value_handle, const uint8_t *value,
+					uint16_t length, void *user_data)
+{
+	struct notify_bench_context *context = user_data;
+	unsigned int elem = context->received++ % NOTIFY_BENCH_ELEMS;
+	gint64 elapsed;
+
+	g_assert_cmpuint(length, ==, NOTIFY_BENCH_VALUE_LEN);
+	g_assert_cmpuint(value[0], ==, elem);
+	g_assert_cmpuint(value_handle, ==,
+			context->handles[elem % context->registered]);
+
+	if (elem < NOTIFY_BENCH_ELEMS - 1)
+		return;
+
+	if (++context->pdus < NOTIFY_BENCH_PDUS) {
+		notify_bench_send(context);
+		return;
+	}
+
+	elapsed = g_get_monotonic_time() - context->start;
+
+	tester_debug("%u registrations: %u values in %" G_GINT64_FORMAT " us",
+				context->registered, context->received,
+				elapsed);
+
+	if (++context->round == G_N_ELEMENTS(notify_bench_regs)) {
+		g_idle_add(notify_bench_quit, context);
+		return;
+	}
+
+	notify_bench_start(context);
+}
+
+static void notify_bench_start(struct notify_bench_context *context)
+{
+	unsigned int regs = notify_bench_regs[context->round];
+
+	for (; context->registered < regs; context->registered++)
+		g_assert(bt_gatt_client_register_notify(context->client,
+				context->handles[context->registered],
+				NULL, notify_bench_cb, context, NULL));
+
+	context->received = 0;
+	context->pdus = 0;
+	context->start = g_get_monotonic_time();
+
+	notify_bench_send(context);
+}
+
+static void test_notify_benchmark(const void *data)
+{
+	struct notify_bench_context *context;
+	struct gatt_db_attribute *svc, *attr;
+	bt_uuid_t uuid;
+	unsigned int i;
+	int err, sv[2];
+
+	context = g_new0(struct notify_bench_context, 1);
+
+	err = socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv);
+	g_assert(err == 0);
+
+	context->db = gatt_db_new();
+
+	bt_uuid16_create(&uuid, 0x1844);
+	svc = gatt_db_add_service(context->db, &uuid, true,
+						1 + NOTIFY_BENCH_CHRCS * 2);
+	g_assert(svc);
+
+	for (i = 0; i < NOTIFY_BENCH_CHRCS; i++) {
+		bt_uuid16_create(&uuid, 0x2b7d + i);
+		attr = gatt_db_service_add_characteristic(svc, &uuid,
+						BT_ATT_PERM_READ,
+						BT_GATT_CHRC_PROP_NOTIFY,
+						NULL, NULL, NULL);
+		g_assert(attr);
+		context->handles[i] = gatt_db_attribute_get_handle(attr);
+	}
+
+	gatt_db_service_set_active(svc, true);
+
+	context->att = bt_att_new(sv[0], false);
+	g_assert(context->att);
+	bt_att_set_close_on_unref(context->att, true);
+	g_assert(bt_att_set_mtu(context->att, 512));
+
+	/*
+	 * The peer never answers the discovery started by the client, values
+	 * are written directly to the socket instead.
+	 */
+	context->client = bt_gatt_client_new(context->db, context->att,
+						BT_ATT_DEFAULT_LE_MTU, 0);
+	g_assert(context->client);
+
+	context->fd = sv[1];
+
+	notify_bench_start(context);
+}
+
 int main(int argc, char *argv[])
 {
 	struct gatt_db *service_db_1, *service_db_2, *service_db_3;
@@ -4559,5 +5176,15 @@ int main(int argc, char *argv[])
 			test_hash_db, ts_tail_db, NULL,
 			{});
 
+	tester_add("/robustness/large-db-discovery", NULL, NULL,
+					test_large_db_discovery, NULL);
+
+	tester_add("/robustness/read-batch", NULL, NULL, test_read_batch, NULL);
+	tester_add("/robustness/read-batch-cancel", NULL, NULL,
+					test_read_batch_cancel, NULL);
+
+	tester_add("/robustness/notify-benchmark", NULL, NULL,
+					test_notify_benchmark, NULL);
+
 	return tester_run();
 }
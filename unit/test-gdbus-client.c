@@ -21,6 +21,7 @@
 #define SERVICE_NAME "org.bluez.unit.test_gdbus_client"
 #define SERVICE_NAME1 "org.bluez.unit.test_gdbus_client1"
 #define SERVICE_PATH "/org/bluez/unit/test_gdbus_client"
+#define MANY_OBJECTS 5000
 
 struct context {
 	DBusConnection *dbus_conn;
@@ -904,6 +905,75 @@ static void client_ready(const void *data)
 						proxy_added, NULL, NULL, context);
 }
 
+struct many_objects {
+	unsigned int added;
+	gint64 start;
+};
+
+static void many_objects_ready(GDBusClient *client, void *user_data)
+{
+	struct context *context = user_data;
+	struct many_objects *objs = context->data;
+	unsigned int i;
+
+	tester_debug("%u objects ingested in %" G_GINT64_FORMAT " us",
+			objs->added, g_get_monotonic_time() - objs->start);
+
+	g_assert_cmpuint(objs->added, ==, MANY_OBJECTS);
+
+	for (i = 0; i < MANY_OBJECTS; i++) {
+		char path[64];
+
+		snprintf(path, sizeof(path), SERVICE_PATH "/obj%u", i);
+		g_dbus_unregister_interface(context->dbus_conn, path,
+								SERVICE_NAME);
+	}
+
+	g_dbus_client_unref(context->dbus_client);
+	destroy_context(context);
+}
+
+static void many_objects_added(GDBusProxy *proxy, void *user_data)
+{
+	struct context *context = user_data;
+	struct many_objects *objs = context->data;
+
+	objs->added++;
+}
+
+static void client_many_objects(const void *data)
+{
+	struct context *context = create_context();
+	struct many_objects *objs;
+	unsigned int i;
+
+	if (context == NULL)
+		return;
+
+	objs = g_new0(struct many_objects, 1);
+	context->data = objs;
+
+	for (i = 0; i < MANY_OBJECTS; i++) {
+		char path[64];
+
+		snprintf(path, sizeof(path), SERVICE_PATH "/obj%u", i);
+		g_dbus_register_interface(context->dbus_conn, path,
+					SERVICE_NAME, methods, signals,
+					properties, context, NULL);
+	}
+
+	objs->start = g_get_monotonic_time();
+
+	context->dbus_client = g_dbus_client_new(context->dbus_conn,
+						SERVICE_NAME, SERVICE_PATH);
+
+	g_dbus_client_set_ready_watch(context->dbus_client, many_objects_ready,
+								context);
+	g_dbus_client_set_proxy_handlers(context->dbus_client,
+					many_objects_added, NULL, NULL,
+					context);
+}
+
 int main(int argc, char *argv[])
 {
 	tester_init(&argc, &argv);
@@ -948,5 +1018,8 @@ int main(int argc, char *argv[])
 
 	tester_add("/gdbus/client_ready", NULL, NULL, client_ready, NULL);
 
+	tester_add("/gdbus/client_many_objects", NULL, NULL,
+					client_many_objects, NULL);
+
 	return tester_run();
 }